@@ -8323,6 +8323,7 @@ dump_mos_leaks(spa_t *spa)
 	mos_obj_refd(spa->spa_feat_for_read_obj);
 	mos_obj_refd(spa->spa_feat_for_write_obj);
 	mos_obj_refd(spa->spa_history);
+	mos_obj_refd(spa->spa_arc_warm_obj);
 	mos_obj_refd(spa->spa_errlog_last);
 	mos_obj_refd(spa->spa_errlog_scrub);
 
@@ -8599,6 +8600,8 @@ dump_zpool(spa_t *spa)
 		global_feature_count[SPA_FEATURE_REDACTION_LIST_SPILL] = 0;
 		global_feature_count[SPA_FEATURE_BOOKMARK_WRITTEN] = 0;
 		global_feature_count[SPA_FEATURE_LIVELIST] = 0;
+		global_feature_count[SPA_FEATURE_ARC_WARM] =
+		    (spa->spa_arc_warm_obj != 0);
 
 		(void) dmu_objset_find(spa_name(spa), dump_one_objset,
 		    NULL, DS_FIND_SNAPSHOTS | DS_FIND_CHILDREN);
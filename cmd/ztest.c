@@ -124,6 +124,7 @@
 #include <sys/dsl_userhold.h>
 #include <sys/abd.h>
 #include <sys/blake3.h>
+#include <sys/lz4_impl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -271,6 +272,7 @@ extern uint64_t zfs_deadman_synctime_ms;
 extern uint_t metaslab_preload_limit;
 extern int zfs_compressed_arc_enabled;
 extern int zfs_abd_scatter_enabled;
+extern uint_t zfs_arc_admit_threshold;
 extern uint_t dmu_object_alloc_chunk_shift;
 extern boolean_t zfs_force_some_double_word_sm_entries;
 extern unsigned long zfs_reconstruct_indirect_damage_fraction;
@@ -412,6 +414,7 @@ ztest_func_t ztest_dmu_read_write;
 ztest_func_t ztest_dmu_write_parallel;
 ztest_func_t ztest_dmu_object_alloc_free;
 ztest_func_t ztest_dmu_object_next_chunk;
+ztest_func_t ztest_dmu_sync_uneven;
 ztest_func_t ztest_dmu_commit_callbacks;
 ztest_func_t ztest_zap;
 ztest_func_t ztest_zap_parallel;
@@ -446,9 +449,12 @@ ztest_func_t ztest_trim;
 ztest_func_t ztest_blake3;
 ztest_func_t ztest_fletcher;
 ztest_func_t ztest_fletcher_incr;
+ztest_func_t ztest_lz4;
+ztest_func_t ztest_zstd_frames;
 ztest_func_t ztest_verify_dnode_bt;
 ztest_func_t ztest_pool_prefetch_ddt;
 ztest_func_t ztest_ddt_prune;
+ztest_func_t ztest_zio_fanout;
 
 static uint64_t zopt_always = 0ULL * NANOSEC;		/* all the time */
 static uint64_t zopt_incessant = 1ULL * NANOSEC / 10;	/* every 1/10 second */
@@ -467,6 +473,7 @@ static ztest_info_t ztest_info[] = {
 	ZTI_INIT(ztest_dmu_write_parallel, 10, &zopt_always),
 	ZTI_INIT(ztest_dmu_object_alloc_free, 1, &zopt_always),
 	ZTI_INIT(ztest_dmu_object_next_chunk, 1, &zopt_sometimes),
+	ZTI_INIT(ztest_dmu_sync_uneven, 1, &zopt_sometimes),
 	ZTI_INIT(ztest_dmu_commit_callbacks, 1, &zopt_always),
 	ZTI_INIT(ztest_zap, 30, &zopt_always),
 	ZTI_INIT(ztest_zap_parallel, 100, &zopt_always),
@@ -503,9 +510,12 @@ static ztest_info_t ztest_info[] = {
 	ZTI_INIT(ztest_blake3, 1, &zopt_rarely),
 	ZTI_INIT(ztest_fletcher, 1, &zopt_rarely),
 	ZTI_INIT(ztest_fletcher_incr, 1, &zopt_rarely),
+	ZTI_INIT(ztest_lz4, 1, &zopt_rarely),
+	ZTI_INIT(ztest_zstd_frames, 1, &zopt_rarely),
 	ZTI_INIT(ztest_verify_dnode_bt, 1, &zopt_sometimes),
 	ZTI_INIT(ztest_pool_prefetch_ddt, 1, &zopt_rarely),
 	ZTI_INIT(ztest_ddt_prune, 1, &zopt_rarely),
+	ZTI_INIT(ztest_zio_fanout, 1, &zopt_sometimes),
 };
 
 #define	ZTEST_FUNCS	(sizeof (ztest_info) / sizeof (ztest_info_t))
@@ -5040,6 +5050,93 @@ ztest_dmu_object_next_chunk(ztest_ds_t *zd, uint64_t id)
 	mutex_exit(&os->os_obj_lock);
 }
 
+#undef OD_ARRAY_SIZE
+#define	OD_ARRAY_SIZE	64
+
+/*
+ * Dirty the dnodes in one os_dirty_dnodes sublist heavily and the rest
+ * lightly in a single txg, then wait for it to sync and verify the data.
+ * The sync tasks of the lightly loaded sublists finish first and steal
+ * dnodes from the heavy one, possibly before dmu_objset_sync() has
+ * dispatched every task, which exercises the soa_count reference that
+ * decides when sync_meta_dnode_task() may run.
+ */
+void
+ztest_dmu_sync_uneven(ztest_ds_t *zd, uint64_t id)
+{
+	objset_t *os = zd->zd_os;
+	multilist_t *ml = &os->os_dirty_dnodes[0];
+	int size = sizeof (ztest_od_t) * OD_ARRAY_SIZE;
+	int nblocks = 8;
+	uint64_t word[8];
+	unsigned int sublist[OD_ARRAY_SIZE], heavy_idx;
+	boolean_t heavy[OD_ARRAY_SIZE];
+	ztest_od_t *od;
+	dmu_tx_t *tx;
+	dnode_t *dn;
+	uint64_t txg;
+
+	od = umem_alloc(size, UMEM_NOFAIL);
+	for (int b = 0; b < OD_ARRAY_SIZE; b++)
+		ztest_od_init(od + b, id, FTAG, b, DMU_OT_UINT64_OTHER,
+		    0, 0, 0);
+
+	if (ztest_object_init(zd, od, size, B_FALSE) != 0) {
+		zd->zd_od = NULL;
+		umem_free(od, size);
+		return;
+	}
+
+	/*
+	 * Every object in the sublist of a randomly chosen one gets
+	 * nblocks dirty blocks, all others a single one.
+	 */
+	for (int b = 0; b < OD_ARRAY_SIZE; b++) {
+		VERIFY0(dnode_hold(os, od[b].od_object, FTAG, &dn));
+		sublist[b] = ml->ml_index_func(ml, dn);
+		dnode_rele(dn, FTAG);
+	}
+	heavy_idx = sublist[ztest_random(OD_ARRAY_SIZE)];
+	for (int b = 0; b < OD_ARRAY_SIZE; b++)
+		heavy[b] = (sublist[b] == heavy_idx);
+
+	tx = dmu_tx_create(os);
+	for (int b = 0; b < OD_ARRAY_SIZE; b++) {
+		dmu_tx_hold_write(tx, od[b].od_object, 0,
+		    (heavy[b] ? nblocks : 1) * od[b].od_blocksize);
+	}
+	txg = ztest_tx_assign(tx, DMU_TX_WAIT, FTAG);
+	if (txg == 0) {
+		umem_free(od, size);
+		return;
+	}
+
+	for (int b = 0; b < OD_ARRAY_SIZE; b++) {
+		for (int i = 0; i < (heavy[b] ? nblocks : 1); i++) {
+			for (int w = 0; w < ARRAY_SIZE(word); w++)
+				word[w] = od[b].od_object ^ txg ^ i;
+			dmu_write(os, od[b].od_object,
+			    i * od[b].od_blocksize, sizeof (word), word, tx);
+		}
+	}
+	dmu_tx_commit(tx);
+	txg_wait_synced(dmu_objset_pool(os), txg);
+
+	for (int b = 0; b < OD_ARRAY_SIZE; b++) {
+		for (int i = 0; i < (heavy[b] ? nblocks : 1); i++) {
+			VERIFY0(dmu_read(os, od[b].od_object,
+			    i * od[b].od_blocksize, sizeof (word), word,
+			    DMU_READ_PREFETCH));
+			for (int w = 0; w < ARRAY_SIZE(word); w++) {
+				VERIFY3U(word[w], ==,
+				    od[b].od_object ^ txg ^ i);
+			}
+		}
+	}
+
+	umem_free(od, size);
+}
+
 #undef OD_ARRAY_SIZE
 #define	OD_ARRAY_SIZE	2
 
@@ -6227,7 +6324,8 @@ ztest_dsl_prop_get_set(ztest_ds_t *zd, uint64_t id)
 		ZFS_PROP_CHECKSUM,
 		ZFS_PROP_COMPRESSION,
 		ZFS_PROP_COPIES,
-		ZFS_PROP_DEDUP
+		ZFS_PROP_DEDUP,
+		ZFS_PROP_ZSTD_FRAMES
 	};
 
 	(void) pthread_rwlock_rdlock(&ztest_name_lock);
@@ -7046,6 +7144,133 @@ ztest_fletcher_incr(ztest_ds_t *zd, uint64_t id)
 	}
 }
 
+/*
+ * Verify that every lz4 decompression implementation reproduces the input
+ * of the compressor.  The data mixes literal runs with back references at
+ * short and long distances, so that all of the decoder's copy paths run,
+ * including copies longer than LZ4_FPU_CHUNK.
+ */
+void
+ztest_lz4(ztest_ds_t *zd, uint64_t id)
+{
+	(void) zd, (void) id;
+	const zfs_impl_t *lz4 = &zfs_lz4_ops;
+	hrtime_t end = gethrtime() + NANOSEC;
+
+	while (gethrtime() <= end) {
+		int run_count = 100;
+		uint32_t size = ztest_random_blocksize();
+		uint8_t *buf = umem_alloc(size, UMEM_NOFAIL);
+		abd_t *abd = abd_get_from_buf(buf, size);
+		abd_t *cabd = abd_alloc_linear(size, B_FALSE);
+		abd_t *dabd = abd_alloc_linear(size, B_FALSE);
+		size_t c_len;
+
+		for (uint32_t i = 0; i < size; ) {
+			/*
+			 * Now and then make a run long enough that the vector
+			 * decoders split its copy across FPU sections.
+			 */
+			uint32_t len = 1 +
+			    ztest_random(ztest_random(16) ? 64 : 4 * 65536);
+			uint32_t off = 1 +
+			    ztest_random(ztest_random(2) ? 16 : 4096);
+
+			len = MIN(len, size - i);
+
+			if (off > i || ztest_random(4) == 0) {
+				uint64_t x = ztest_random(UINT64_MAX) | 1;
+
+				for (; len > 0; len--, i++) {
+					x ^= x << 13;
+					x ^= x >> 7;
+					x ^= x << 17;
+					buf[i] = (uint8_t)x;
+				}
+			} else {
+				for (; len > 0; len--, i++)
+					buf[i] = buf[i - off];
+			}
+		}
+
+		c_len = zfs_lz4_compress(abd, cabd, size, size, 0);
+		if (c_len < size) {
+			VERIFY0(lz4->setname("cycle"));
+			while (run_count-- > 0) {
+				abd_zero(dabd, size);
+				VERIFY0(zfs_lz4_decompress(cabd, dabd, c_len,
+				    size, 0));
+				VERIFY0(abd_cmp_buf(dabd, buf, size));
+			}
+		}
+
+		abd_free(dabd);
+		abd_free(cabd);
+		abd_free(abd);
+		umem_free(buf, size);
+	}
+}
+
+/*
+ * A maximum size block compressed with zstd_frames=on is laid out as
+ * frames.  Reading it must report that with its level, so that compressing
+ * it again with that level, as the ARC does for the L2ARC, gives the same
+ * bytes.  Without the property the block stays a single frame.
+ */
+void
+ztest_zstd_frames(ztest_ds_t *zd, uint64_t id)
+{
+	(void) zd, (void) id;
+	const size_t size = SPA_MAXBLOCKSIZE;
+	const size_t seedlen = 64 * 1024;
+	uint8_t framed = zio_complevel_frames(ZIO_COMPRESS_ZSTD,
+	    ZIO_ZSTD_LEVEL_1);
+	abd_t *abd = abd_alloc_linear(size, B_FALSE);
+	abd_t *dabd = abd_alloc_linear(size, B_FALSE);
+	abd_t *cabd = NULL, *cabd2 = NULL;
+	uint8_t *buf = abd_to_buf(abd);
+	uint8_t level;
+	size_t c_len, c_len2;
+
+	VERIFY(ZIO_ZSTD_LEVEL_HAS_FRAMES(framed));
+
+	/* Compressible data that still differs between the frames */
+	for (size_t i = 0; i < seedlen; i++)
+		buf[i] = 'a' + ztest_random(16);
+	for (size_t i = seedlen; i < size; i += seedlen) {
+		memcpy(buf + i, buf + ztest_random(i / seedlen) * seedlen,
+		    seedlen);
+		buf[i + ztest_random(seedlen)] = (uint8_t)(i / seedlen);
+	}
+
+	c_len = zio_compress_data(ZIO_COMPRESS_ZSTD, abd, &cabd, size, size,
+	    framed);
+	VERIFY3U(c_len, <, size);
+	VERIFY0(zio_decompress_data(ZIO_COMPRESS_ZSTD, cabd, dabd, c_len, size,
+	    &level));
+	VERIFY3U(level, ==, framed);
+	VERIFY0(abd_cmp(abd, dabd));
+
+	c_len2 = zio_compress_data(ZIO_COMPRESS_ZSTD, abd, &cabd2, size, size,
+	    level);
+	VERIFY3U(c_len2, ==, c_len);
+	VERIFY0(memcmp(abd_to_buf(cabd), abd_to_buf(cabd2), c_len));
+
+	c_len2 = zio_compress_data(ZIO_COMPRESS_ZSTD, abd, &cabd2, size, size,
+	    ZIO_ZSTD_LEVEL_1);
+	VERIFY3U(c_len2, <, size);
+	abd_zero(dabd, size);
+	VERIFY0(zio_decompress_data(ZIO_COMPRESS_ZSTD, cabd2, dabd, c_len2,
+	    size, &level));
+	VERIFY3U(level, ==, ZIO_ZSTD_LEVEL_1);
+	VERIFY0(abd_cmp(abd, dabd));
+
+	abd_free(cabd2);
+	abd_free(cabd);
+	abd_free(dabd);
+	abd_free(abd);
+}
+
 void
 ztest_pool_prefetch_ddt(ztest_ds_t *zd, uint64_t id)
 {
@@ -7349,6 +7574,84 @@ ztest_ddt_prune(ztest_ds_t *zd, uint64_t id)
 	(void) ddt_prune_unique_entries(spa, ZPOOL_DDT_PRUNE_PERCENTAGE, pct);
 }
 
+typedef struct ztest_zio_fanout_arg {
+	zio_t		**zfa_leaves;
+	int		zfa_nleaves;
+	int		zfa_first;
+	int		zfa_stride;
+} ztest_zio_fanout_arg_t;
+
+static void
+ztest_zio_fanout_leaves(void *arg)
+{
+	ztest_zio_fanout_arg_t *zfa = arg;
+
+	for (int l = zfa->zfa_first; l < zfa->zfa_nleaves;
+	    l += zfa->zfa_stride)
+		zio_nowait(zfa->zfa_leaves[l]);
+}
+
+/*
+ * Build a wide two-level tree of null zios and complete the leaves from
+ * several threads at once while their parents are already waiting on them,
+ * which exercises the parent/child completion interlocks.  Each thread
+ * takes every nthreads'th leaf, so they all complete children of the same
+ * parent concurrently.  At high verbosity the time taken per child is
+ * reported, as a microbenchmark of zio_notify_parent() under contention;
+ * only nthreads tasks are dispatched, so that cost is not dominated by the
+ * taskq.
+ */
+void
+ztest_zio_fanout(ztest_ds_t *zd, uint64_t id)
+{
+	(void) zd, (void) id;
+
+	spa_t *spa = ztest_spa;
+	int width = ztest_random(8) + 1;
+	int fanout = ztest_random(8192) + 1;
+	int nleaves = width * fanout;
+	int nthreads = ztest_random(8) + 1;
+	zio_t **leaves = umem_alloc(nleaves * sizeof (zio_t *), UMEM_NOFAIL);
+	ztest_zio_fanout_arg_t *zfa = umem_alloc(nthreads * sizeof (*zfa),
+	    UMEM_NOFAIL);
+	taskq_t *tq = taskq_create("ztest_zio_fanout", nthreads, defclsyspri,
+	    nthreads, nthreads, TASKQ_PREPOPULATE);
+	zio_t *rio = zio_root(spa, NULL, NULL, ZIO_FLAG_CANFAIL);
+
+	for (int w = 0; w < width; w++) {
+		zio_t *pio = zio_null(rio, spa, NULL, NULL, NULL,
+		    ZIO_FLAG_CANFAIL);
+		for (int f = 0; f < fanout; f++) {
+			leaves[w * fanout + f] = zio_null(pio, spa, NULL,
+			    NULL, NULL, ZIO_FLAG_CANFAIL);
+		}
+		zio_nowait(pio);
+	}
+
+	hrtime_t start = gethrtime();
+	for (int t = 0; t < nthreads; t++) {
+		zfa[t].zfa_leaves = leaves;
+		zfa[t].zfa_nleaves = nleaves;
+		zfa[t].zfa_first = t;
+		zfa[t].zfa_stride = nthreads;
+		VERIFY3U(taskq_dispatch(tq, ztest_zio_fanout_leaves,
+		    &zfa[t], TQ_SLEEP), !=, TASKQID_INVALID);
+	}
+	VERIFY0(zio_wait(rio));
+	hrtime_t delta = gethrtime() - start;
+
+	if (ztest_opts.zo_verbose >= 6) {
+		(void) printf("zio fanout %d x %d, %d threads: "
+		    "%llu ns per child\n", width, fanout, nthreads,
+		    (u_longlong_t)(delta / nleaves));
+	}
+
+	taskq_wait(tq);
+	taskq_destroy(tq);
+	umem_free(zfa, nthreads * sizeof (*zfa));
+	umem_free(leaves, nleaves * sizeof (zio_t *));
+}
+
 /*
  * Verify pool integrity by running zdb.
  */
@@ -7553,6 +7856,12 @@ ztest_resume_thread(void *arg)
 		 */
 		if (ztest_random(10) == 0)
 			zfs_abd_scatter_enabled = ztest_random(2);
+
+		/*
+		 * Periodically turn the ARC admission filter on and off.
+		 */
+		if (ztest_random(10) == 0)
+			zfs_arc_admit_threshold = ztest_random(3);
 	}
 
 	thread_exit();
@@ -8972,6 +9281,31 @@ main(int argc, char **argv)
 	}
 	ASSERT3U(ztest_opts.zo_datasets, ==, ztest_shared_hdr->zh_ds_count);
 
+	/*
+	 * Process the frames of large zstd blocks (zstd_frames=on) serially
+	 * in half of the passes.  Blocks come out the same either way.
+	 */
+	if (ztest_random(2) == 0)
+		VERIFY0(handle_tunable_option("zstd_parallel=0", B_TRUE));
+
+	/*
+	 * The io_uring path for file vdevs is off by default; use it in
+	 * half of the passes so it stays covered.
+	 */
+	if (ztest_random(2) == 0) {
+		VERIFY0(handle_tunable_option("vdev_file_ring_entries=128",
+		    B_TRUE));
+	}
+
+	/*
+	 * File vdevs are non-rotating, so their queues are sharded, up to
+	 * the number of CPUs, in half of the passes.
+	 */
+	if (ztest_random(2) == 0) {
+		VERIFY0(handle_tunable_option("zfs_vdev_queue_shards=8",
+		    B_TRUE));
+	}
+
 	err = ztest_set_global_vars();
 	if (err != 0 && !fd_data_str) {
 		/* error message done by ztest_set_global_vars */
@@ -0,0 +1,31 @@
+dnl #
+dnl # Check for <linux/io_uring.h> - used by libzpool to submit file vdev
+dnl # I/O asynchronously.  The raw system calls are used, so liburing is
+dnl # not required.
+dnl #
+AC_DEFUN([ZFS_AC_CONFIG_USER_IO_URING], [
+	AC_MSG_CHECKING([for io_uring read and write operations])
+	AC_COMPILE_IFELSE([
+		AC_LANG_PROGRAM([[
+			#include <sys/syscall.h>
+			#include <linux/io_uring.h>
+		]], [[
+			struct io_uring_params p;
+			struct io_uring_probe probe;
+			int op = IORING_OP_READ + IORING_OP_WRITE +
+			    IORING_REGISTER_PROBE + IO_URING_OP_SUPPORTED;
+			int nr = __NR_io_uring_setup + __NR_io_uring_enter +
+			    __NR_io_uring_register;
+			(void) p.features;
+			(void) probe.last_op;
+			(void) op;
+			(void) nr;
+		]])
+	], [
+		AC_MSG_RESULT([yes])
+		AC_DEFINE([HAVE_IO_URING], [1],
+		    [io_uring read and write operations are available])
+	], [
+		AC_MSG_RESULT([no])
+	])
+])
@@ -110,6 +110,9 @@
 #define	blake3_param_set_args(var) \
     CTLTYPE_STRING, NULL, 0, blake3_param, "A"
 
+#define	lz4_param_set_args(var) \
+    CTLTYPE_STRING, NULL, 0, lz4_param, "A"
+
 #define	sha256_param_set_args(var) \
     CTLTYPE_STRING, NULL, 0, sha256_param, "A"
 
@@ -41,6 +41,7 @@ int	secpolicy_nfs(cred_t *cr);
 int	secpolicy_zfs(cred_t *crd);
 int	secpolicy_sys_config(cred_t *cr, int checkonly);
 int	secpolicy_zinject(cred_t *cr);
+int	secpolicy_fhopen(cred_t *cr);
 int	secpolicy_fs_unmount(cred_t *cr, struct mount *vfsp);
 int	secpolicy_basic_link(vnode_t *vp, cred_t *cr);
 int	secpolicy_vnode_owner(vnode_t *vp, cred_t *cr, uid_t owner);
@@ -43,6 +43,7 @@ int secpolicy_sys_config(const cred_t *, boolean_t);
 int secpolicy_vnode_access2(const cred_t *, struct inode *,
     uid_t, mode_t, mode_t);
 int secpolicy_vnode_any_access(const cred_t *, struct inode *, uid_t);
+int secpolicy_fhopen(const cred_t *);
 int secpolicy_vnode_chown(const cred_t *, uid_t);
 int secpolicy_vnode_create_gid(const cred_t *);
 int secpolicy_vnode_remove(const cred_t *);
@@ -93,6 +93,7 @@ typedef void arc_prune_func_t(uint64_t bytes, void *priv);
 
 /* Shared module parameters */
 extern uint_t zfs_arc_average_blocksize;
+extern uint_t zfs_arc_admit_threshold;
 extern int l2arc_exclude_special;
 
 /* generic arc_done_func_t's which you can use */
@@ -328,6 +329,7 @@ arc_prune_t *arc_add_prune_callback(arc_prune_func_t *func, void *priv);
 void arc_remove_prune_callback(arc_prune_t *p);
 void arc_freed(spa_t *spa, const blkptr_t *bp);
 int arc_cached(spa_t *spa, const blkptr_t *bp);
+boolean_t arc_admit(spa_t *spa, const blkptr_t *bp);
 
 void arc_flush(spa_t *spa, boolean_t retry);
 void arc_flush_async(spa_t *spa);
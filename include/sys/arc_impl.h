@@ -171,6 +171,7 @@ typedef struct l1arc_buf_hdr {
 	uint32_t		b_mfu_hits;
 	uint32_t		b_mfu_ghost_hits;
 	uint8_t			b_byteswap;
+	uint16_t		b_numa_node;	/* node of the data buffers */
 	arc_buf_t		*b_buf;
 
 	/* self protecting */
@@ -547,6 +548,12 @@ typedef struct arc_stats {
 	kstat_named_t arcstat_mfu_hits;
 	kstat_named_t arcstat_mfu_ghost_hits;
 	kstat_named_t arcstat_uncached_hits;
+	/*
+	 * Logical bytes of data blocks which were admitted into, or kept
+	 * out of, the ARC by the admission filter.
+	 */
+	kstat_named_t arcstat_admit_filter_admitted;
+	kstat_named_t arcstat_admit_filter_rejected;
 	kstat_named_t arcstat_deleted;
 	/*
 	 * Number of buffers that could not be evicted because the hash lock
@@ -932,6 +939,8 @@ typedef struct arc_sums {
 	wmsum_t arcstat_mfu_hits;
 	wmsum_t arcstat_mfu_ghost_hits;
 	wmsum_t arcstat_uncached_hits;
+	wmsum_t arcstat_admit_filter_admitted;
+	wmsum_t arcstat_admit_filter_rejected;
 	wmsum_t arcstat_deleted;
 	wmsum_t arcstat_mutex_miss;
 	wmsum_t arcstat_access_skip;
@@ -1073,6 +1082,9 @@ extern int64_t arc_available_memory(void);
 extern void arc_tuning_update(boolean_t);
 extern void arc_register_hotplug(void);
 extern void arc_unregister_hotplug(void);
+extern uint_t arc_numa_node(void);
+extern uint_t arc_numa_node_count(void);
+extern void arc_evict_numa_hint(uint_t node);
 
 extern int param_set_arc_u64(ZFS_MODULE_PARAM_ARGS);
 extern int param_set_arc_int(ZFS_MODULE_PARAM_ARGS);
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+#ifndef _SYS_ARC_WARM_H
+#define	_SYS_ARC_WARM_H
+
+#include <sys/spa.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define	ARC_WARM_MAGIC		0x6172637761726dULL	/* "arcwarm" */
+#define	ARC_WARM_VERSION	1
+
+/*
+ * The manifest is a DMU_OTN_UINT64_METADATA object in the MOS, referenced
+ * by the DMU_POOL_ARC_WARM entry of the pool directory.  It starts with an
+ * arc_warm_phys_t header followed by awp_count arc_warm_entry_t entries,
+ * both of which are arrays of uint64_t so that the generic byteswap
+ * applies.
+ */
+typedef struct arc_warm_phys {
+	uint64_t	awp_magic;
+	uint64_t	awp_version;
+	uint64_t	awp_txg;	/* txg the manifest was written in */
+	uint64_t	awp_count;	/* number of entries */
+} arc_warm_phys_t;
+
+/*
+ * Each entry is the logical bookmark of a block that was cached when the
+ * manifest was written.  The data is read back through the dbuf prefetch
+ * path so that it is found via, and checksummed against, its block pointer.
+ */
+typedef struct arc_warm_entry {
+	uint64_t	awe_objset;	/* dsl_dataset object number */
+	uint64_t	awe_object;
+	uint64_t	awe_blkid;
+	uint64_t	awe_prop;	/* level, size and flags, see below */
+} arc_warm_entry_t;
+
+#define	AWE_GET_LEVEL(awe)	BF64_GET((awe)->awe_prop, 0, 8)
+#define	AWE_SET_LEVEL(awe, x)	BF64_SET((awe)->awe_prop, 0, 8, x)
+
+/* The block was in the MFU state; those are restored first. */
+#define	AWE_GET_MFU(awe)	BF64_GET((awe)->awe_prop, 8, 1)
+#define	AWE_SET_MFU(awe, x)	BF64_SET((awe)->awe_prop, 8, 1, x)
+
+/* Logical size of the block when the manifest was written. */
+#define	AWE_GET_LSIZE(awe)	\
+	BF64_GET_SB((awe)->awe_prop, 16, 32, SPA_MINBLOCKSHIFT, 0)
+#define	AWE_SET_LSIZE(awe, x)	\
+	BF64_SET_SB((awe)->awe_prop, 16, 32, SPA_MINBLOCKSHIFT, 0, x)
+
+extern void spa_start_arc_warm_thread(spa_t *spa);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* _SYS_ARC_WARM_H */
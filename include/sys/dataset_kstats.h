@@ -59,11 +59,16 @@ typedef struct dataset_kstat_values {
 	 */
 	kstat_named_t dkv_nunlinked;
 	/*
-	 * Per dataset zil kstats
+	 * Per dataset zil kstats, last since they end with the optional
+	 * commit latency histogram.
 	 */
 	zil_kstat_values_t dkv_zil_stats;
 } dataset_kstat_values_t;
 
+_Static_assert(offsetof(dataset_kstat_values_t,
+    dkv_zil_stats.zil_commit_histo[ZIL_HISTO_BUCKETS]) ==
+    sizeof (dataset_kstat_values_t), "zil_commit_histo not at the end");
+
 typedef struct dataset_kstats {
 	dataset_sum_stats_t dk_sums;
 	zil_sums_t dk_zil_sums;
@@ -330,16 +330,17 @@ typedef struct dmu_buf_impl {
 } dmu_buf_impl_t;
 
 #define	DBUF_HASH_MUTEX(h, idx) \
-	(&(h)->hash_mutexes[(idx) & ((h)->hash_mutex_mask)])
+	(&(h)->hash_mutexes[(idx) & ((h)->hash_mutex_mask)].pm_lock)
 
 typedef struct dbuf_hash_table {
 	uint64_t hash_table_mask;
 	uint64_t hash_mutex_mask;
 	dmu_buf_impl_t **hash_table;
-	kmutex_t *hash_mutexes;
+	zfs_padded_mutex_t *hash_mutexes;
 } dbuf_hash_table_t;
 
 typedef void (*dbuf_prefetch_fn)(void *, uint64_t, uint64_t, boolean_t);
+typedef void (*dbuf_walk_fn)(dmu_buf_impl_t *, void *);
 
 extern kmem_cache_t *dbuf_dirty_kmem_cache;
 
@@ -363,6 +364,7 @@ int dbuf_prefetch_impl(struct dnode *dn, int64_t level, uint64_t blkid,
     void *arg);
 int dbuf_prefetch(struct dnode *dn, int64_t level, uint64_t blkid,
     zio_priority_t prio, arc_flags_t aflags);
+void dbuf_walk_cached(spa_t *spa, dbuf_walk_fn func, void *arg);
 
 void dbuf_add_ref(dmu_buf_impl_t *db, const void *tag);
 boolean_t dbuf_try_add_ref(dmu_buf_t *db, objset_t *os, uint64_t obj,
@@ -471,6 +473,10 @@ dbuf_find_dirty_eq(dmu_buf_impl_t *db, uint64_t txg)
 	(dbuf_is_metadata(_db) &&					\
 	((_db)->db_objset->os_primary_cache == ZFS_CACHE_METADATA))))
 
+#define	DBUF_IS_FILTERED(_db)						\
+	((_db)->db_objset->os_primary_cache == ZFS_CACHE_ALL &&		\
+	!dbuf_is_metadata(_db))
+
 boolean_t dbuf_is_l2cacheable(dmu_buf_impl_t *db, blkptr_t *db_bp);
 
 #ifdef ZFS_DEBUG
@@ -417,6 +417,7 @@ typedef struct dmu_buf {
 #define	DMU_POOL_TXG_LOG_TIME_MINUTES	"com.klarasystems:txg_log_time:minutes"
 #define	DMU_POOL_TXG_LOG_TIME_DAYS	"com.klarasystems:txg_log_time:days"
 #define	DMU_POOL_TXG_LOG_TIME_MONTHS	"com.klarasystems:txg_log_time:months"
+#define	DMU_POOL_ARC_WARM		"org.openzfs:arc_warm"
 
 /*
  * Allocate an object from this objset.  The range of object numbers
@@ -959,6 +960,8 @@ void dmu_prefetch(objset_t *os, uint64_t object, int64_t level, uint64_t offset,
 	uint64_t len, enum zio_priority pri);
 void dmu_prefetch_by_dnode(dnode_t *dn, int64_t level, uint64_t offset,
 	uint64_t len, enum zio_priority pri);
+uint64_t dmu_prefetch_by_dnode_limit(dnode_t *dn, int64_t level,
+	uint64_t offset, uint64_t len, uint64_t max, enum zio_priority pri);
 void dmu_prefetch_dnode(objset_t *os, uint64_t object, enum zio_priority pri);
 int dmu_prefetch_wait(objset_t *os, uint64_t object, uint64_t offset,
     uint64_t size);
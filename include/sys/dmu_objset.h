@@ -127,6 +127,7 @@ struct objset {
 	enum zio_checksum os_checksum;
 	enum zio_compress os_compress;
 	uint8_t os_complevel;
+	boolean_t os_zstd_frames;
 	uint8_t os_copies;
 	enum zio_checksum os_dedup_checksum;
 	boolean_t os_dedup_verify;
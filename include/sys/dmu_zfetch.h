@@ -39,11 +39,16 @@ extern "C" {
 
 struct dnode;				/* so we can reference dnode */
 
+#define	ZFETCH_HISTORY	4		/* unmatched accesses to remember */
+
 typedef struct zfetch {
 	kmutex_t	zf_lock;	/* protects zfetch structure */
 	list_t		zf_stream;	/* list of zstream_t's */
 	struct dnode	*zf_dnode;	/* dnode that owns this zfetch */
 	int		zf_numstreams;	/* number of zstream_t's */
+	uint_t		zf_history_next; /* next zf_history slot to use */
+	/* starts of recent accesses which did not continue a stream */
+	uint64_t	zf_history[ZFETCH_HISTORY];
 } zfetch_t;
 
 typedef struct zsrange {
@@ -51,7 +56,7 @@ typedef struct zsrange {
 	uint16_t	end;
 } zsrange_t;
 
-#define	ZFETCH_RANGES	9		/* Fits zstream_t into 128 bytes */
+#define	ZFETCH_RANGES	9		/* ranges tracked per stream */
 
 typedef struct zstream {
 	list_node_t	zs_node;	/* link for zf_stream */
@@ -66,6 +71,15 @@ typedef struct zstream {
 	uint64_t	zs_ipf_end;	/* data block to prefetch L1 up to */
 	boolean_t	zs_missed;	/* stream saw cache misses */
 	boolean_t	zs_more;	/* need more distant prefetch */
+	/*
+	 * Strided streams access zs_stride_nblks blocks every zs_stride
+	 * blocks, which is negative for streams reading backwards.  The
+	 * zs_pf_* fields then count accesses from zs_stride_base.  Zero
+	 * zs_stride means a sequential stream.
+	 */
+	int64_t		zs_stride;
+	uint64_t	zs_stride_base;	/* first block of access 0 */
+	uint64_t	zs_stride_nblks; /* blocks per access */
 	zfs_refcount_t	zs_callers;	/* number of pending callers */
 	/*
 	 * Number of stream references: dnode, callers and pending blocks.
@@ -464,6 +464,14 @@ void dnode_set_storage_type(dnode_t *dn, dmu_object_type_t type);
 	(((_level) > 0 || DMU_OT_IS_METADATA((_dn)->dn_type)) &&	\
 	(_dn)->dn_objset->os_primary_cache == ZFS_CACHE_METADATA))
 
+/*
+ * Data blocks of primarycache=all datasets go through the ARC admission
+ * filter, see arc_admit().
+ */
+#define	DNODE_LEVEL_IS_FILTERED(_dn, _level)				\
+	((_dn)->dn_objset->os_primary_cache == ZFS_CACHE_ALL &&		\
+	(_level) == 0 && !DMU_OT_IS_METADATA((_dn)->dn_type))
+
 /*
  * Used for dnodestats kstat.
  */
@@ -203,6 +203,7 @@ typedef enum {
 	ZFS_PROP_DEFAULTUSEROBJQUOTA,
 	ZFS_PROP_DEFAULTGROUPOBJQUOTA,
 	ZFS_PROP_DEFAULTPROJECTOBJQUOTA,
+	ZFS_PROP_ZSTD_FRAMES,
 	ZFS_NUM_PROPS
 } zfs_prop_t;
 
@@ -387,6 +388,7 @@ typedef enum {
 	VDEV_PROP_SLOW_IOS,
 	VDEV_PROP_SIT_OUT,
 	VDEV_PROP_AUTOSIT,
+	VDEV_PROP_QUEUE_BYPASS,
 	VDEV_NUM_PROPS
 } vdev_prop_t;
 
@@ -1636,6 +1638,28 @@ typedef struct zfs_rewrite_args {
 
 #define	ZFS_IOC_REWRITE		_IOW(0x83, 3, zfs_rewrite_args_t)
 
+/*
+ * A range of a file to prefetch.  The object number is that of a file in
+ * the same dataset as the file the ioctl is issued on, or 0 for that file
+ * itself.  Naming other files requires the privilege to open files by
+ * handle (CAP_DAC_READ_SEARCH on Linux), or fails with EPERM.  A length of
+ * 0 means up to the end of the file.
+ */
+typedef struct zfs_prefetch_range {
+	uint64_t	object;
+	uint64_t	off;
+	uint64_t	len;
+} zfs_prefetch_range_t;
+
+typedef struct zfs_prefetch_args {
+	uint64_t	ranges;		/* zfs_prefetch_range_t array */
+	uint64_t	count;		/* number of ranges */
+	uint64_t	flags;
+	uint64_t	arg;
+} zfs_prefetch_args_t;
+
+#define	ZFS_IOC_PREFETCH	_IOW(0x83, 4, zfs_prefetch_args_t)
+
 /*
  * ZFS-specific error codes used for returning descriptive errors
  * to the userland through zfs ioctls.
@@ -1894,6 +1918,16 @@ typedef enum {
  *		ZFS_EV_VDEV_PATH	DATA_TYPE_STRING	(optional)
  *		ZFS_EV_VDEV_GUID	DATA_TYPE_UINT64
  *
+ *	ESC_ZFS_ZIL_REPLAY
+ *
+ *		ZFS_EV_POOL_NAME	DATA_TYPE_STRING
+ *		ZFS_EV_POOL_GUID	DATA_TYPE_UINT64
+ *		ZFS_EV_ZIL_DSNAME	DATA_TYPE_STRING
+ *		ZFS_EV_ZIL_REPLAY_RECORDS	DATA_TYPE_UINT64
+ *		ZFS_EV_ZIL_REPLAY_BYTES	DATA_TYPE_UINT64
+ *		ZFS_EV_ZIL_REPLAY_TIME	DATA_TYPE_UINT64	(nanoseconds)
+ *		ZFS_EV_ZIL_REPLAY_ERROR	DATA_TYPE_INT32
+ *
  *	ESC_ZFS_HISTORY_EVENT
  *
  *		ZFS_EV_POOL_NAME	DATA_TYPE_STRING
@@ -1933,6 +1967,11 @@ typedef enum {
 #define	ZFS_EV_HIST_DSNAME	"history_dsname"
 #define	ZFS_EV_HIST_DSID	"history_dsid"
 #define	ZFS_EV_RESILVER_TYPE	"resilver_type"
+#define	ZFS_EV_ZIL_DSNAME	"zil_dsname"
+#define	ZFS_EV_ZIL_REPLAY_RECORDS	"zil_replay_records"
+#define	ZFS_EV_ZIL_REPLAY_BYTES	"zil_replay_bytes"
+#define	ZFS_EV_ZIL_REPLAY_TIME	"zil_replay_time"
+#define	ZFS_EV_ZIL_REPLAY_ERROR	"zil_replay_error"
 
 /*
  * We currently support block sizes from 512 bytes to 16MB.
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+#ifndef _SYS_LZ4_IMPL_H
+#define	_SYS_LZ4_IMPL_H
+
+#include <sys/types.h>
+#include <sys/zfs_impl.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Decode an LZ4 block of isize bytes from src into dst, which can hold
+ * osize bytes.  Returns the number of bytes decoded, or a negative value
+ * if the input is malformed.
+ */
+typedef int lz4_decompress_func_t(const char *src, char *dst, int isize,
+    int osize);
+typedef boolean_t lz4_will_work_f(void);
+
+typedef struct lz4_impl_ops {
+	lz4_decompress_func_t *decompress;
+	lz4_will_work_f *is_supported;
+	const char *name;
+} lz4_impl_ops_t;
+
+extern const lz4_impl_ops_t lz4_scalar_impl;
+#if defined(__x86_64) && defined(HAVE_SSE2)
+extern const lz4_impl_ops_t lz4_sse2_impl;
+#endif
+#if defined(__x86_64) && defined(HAVE_SSSE3)
+extern const lz4_impl_ops_t lz4_ssse3_impl;
+#endif
+#if defined(__x86_64) && defined(HAVE_AVX2)
+extern const lz4_impl_ops_t lz4_avx2_impl;
+#endif
+
+extern const lz4_impl_ops_t *lz4_impl_get_ops(void);
+
+/*
+ * Implementation selector, built from generic_impl.c.  It is not listed by
+ * zfs_impl_get_ops(), whose table is also built into libicp, which has no
+ * lz4 in userland.
+ */
+extern const zfs_impl_t zfs_lz4_ops;
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* _SYS_LZ4_IMPL_H */
@@ -935,11 +935,13 @@ typedef struct spa_history_list {
 typedef struct spa_stats {
 	spa_history_list_t	read_history;
 	spa_history_list_t	txg_history;
+	spa_history_list_t	txg_phases;
 	spa_history_kstat_t	tx_assign_histogram;
 	spa_history_list_t	mmp_history;
 	spa_history_kstat_t	state;		/* pool state */
 	spa_history_kstat_t	guid;		/* pool guid */
 	spa_history_kstat_t	iostats;
+	spa_history_kstat_t	arc_warm;	/* ARC warm-restart progress */
 } spa_stats_t;
 
 typedef enum txg_state {
@@ -951,6 +953,28 @@ typedef enum txg_state {
 	TXG_STATE_COMMITTED	= 5,
 } txg_state_t;
 
+/*
+ * Phases of a txg sync whose time is accounted (summed over all passes)
+ * in the txg history.  Keep spa_sync_phase_names[] in sync.
+ */
+typedef enum spa_sync_phase {
+	SPA_SYNC_PHASE_DATASETS,	/* dirty dataset dnodes and data */
+	SPA_SYNC_PHASE_USERSPACE,	/* user/group/project accounting */
+	SPA_SYNC_PHASE_MOS,		/* dsl_dirs and the MOS */
+	SPA_SYNC_PHASE_SYNCTASKS,	/* early and regular sync tasks */
+	SPA_SYNC_PHASE_FREES,		/* this txg's frees */
+	SPA_SYNC_PHASE_BRT,		/* brt_sync() */
+	SPA_SYNC_PHASE_DDT,		/* ddt_sync() */
+	SPA_SYNC_PHASE_SCAN,		/* scrub, resilver and errorscrub */
+	SPA_SYNC_PHASE_REMOVAL,		/* svr_sync(), device removal */
+	SPA_SYNC_PHASE_UPGRADES,	/* spa_sync_upgrades() */
+	SPA_SYNC_PHASE_FLUSH,		/* log spacemap metaslab flushing */
+	SPA_SYNC_PHASE_VDEVS,		/* vdev_sync(), i.e. metaslab_sync() */
+	SPA_SYNC_PHASE_DEFERRED_FREES,	/* spa_sync_deferred_frees() */
+	SPA_SYNC_PHASE_CONFIG,		/* vdev labels and uberblocks */
+	SPA_SYNC_PHASES
+} spa_sync_phase_t;
+
 typedef struct txg_stat {
 	vdev_stat_t		vs1;
 	vdev_stat_t		vs2;
@@ -988,6 +1012,18 @@ typedef struct spa_iostats {
 	kstat_named_t	direct_write_bytes;
 } spa_iostats_t;
 
+/* ARC warm-restart kstats */
+typedef struct spa_arc_warm_stats {
+	kstat_named_t	saves;
+	kstat_named_t	save_entries;
+	kstat_named_t	save_bytes;
+	kstat_named_t	save_txg;
+	kstat_named_t	restore_entries;
+	kstat_named_t	restore_processed;
+	kstat_named_t	restore_issued;
+	kstat_named_t	restore_skipped;
+} spa_arc_warm_stats_t;
+
 extern void spa_stats_init(spa_t *spa);
 extern void spa_stats_destroy(spa_t *spa);
 extern void spa_read_history_add(spa_t *spa, const zbookmark_phys_t *zb,
@@ -998,6 +1034,8 @@ extern int spa_txg_history_set(spa_t *spa,  uint64_t txg,
 extern txg_stat_t *spa_txg_history_init_io(spa_t *, uint64_t,
     struct dsl_pool *);
 extern void spa_txg_history_fini_io(spa_t *, txg_stat_t *);
+extern void spa_sync_phase_add(spa_t *spa, spa_sync_phase_t phase,
+    hrtime_t *start);
 extern void spa_tx_assign_add_nsecs(spa_t *spa, uint64_t nsecs);
 extern int spa_mmp_history_set_skip(spa_t *spa, uint64_t mmp_kstat_id);
 extern int spa_mmp_history_set(spa_t *spa, uint64_t mmp_kstat_id, int io_error,
@@ -1013,6 +1051,11 @@ extern void spa_iostats_read_add(spa_t *spa, uint64_t size, uint64_t iops,
     dmu_flags_t flags);
 extern void spa_iostats_write_add(spa_t *spa, uint64_t size, uint64_t iops,
     dmu_flags_t flags);
+extern void spa_arc_warm_stats_save(spa_t *spa, uint64_t entries,
+    uint64_t bytes, uint64_t txg);
+extern void spa_arc_warm_stats_restore(spa_t *spa, uint64_t entries);
+extern void spa_arc_warm_stats_restore_add(spa_t *spa, uint64_t processed,
+    uint64_t issued, uint64_t skipped);
 extern void spa_import_progress_add(spa_t *spa);
 extern void spa_import_progress_remove(uint64_t spa_guid);
 extern int spa_import_progress_set_mmp_check(uint64_t pool_guid,
@@ -1240,6 +1283,8 @@ extern void name_to_errphys(char *buf, zbookmark_err_phys_t *zep);
 /* vdev mirror */
 extern void vdev_mirror_stat_init(void);
 extern void vdev_mirror_stat_fini(void);
+extern void vdev_queue_stat_init(void);
+extern void vdev_queue_stat_fini(void);
 
 /* Initialization and termination */
 extern void spa_init(spa_mode_t mode);
@@ -216,6 +216,9 @@ typedef enum spa_config_source {
 	SPA_CONFIG_SRC_MOS		/* MOS, but not always from right txg */
 } spa_config_source_t;
 
+/* Per-dataset compression ratios kept for compression=adaptive */
+#define	SPA_COMPRESS_RATIO_BUCKETS	64
+
 struct spa {
 	/*
 	 * Fields protected by spa_namespace_lock.
@@ -366,6 +369,10 @@ struct spa {
 	uint64_t	spa_livelists_to_delete; /* set of livelists to free */
 	livelist_condense_entry_t	spa_to_condense; /* next to condense */
 
+	zthr_t		*spa_arc_warm_zthr;	/* ARC warm-restart */
+	boolean_t	spa_arc_warm_restore;	/* manifest not yet restored */
+	hrtime_t	spa_arc_warm_last_run;	/* last save or restore */
+
 	char		*spa_root;		/* alternate root directory */
 	uint64_t	spa_ena;		/* spa-wide ereport ENA */
 	int		spa_last_open_failed;	/* error if last open failed */
@@ -385,6 +392,7 @@ struct spa {
 	avl_tree_t	spa_errlist_healed;	/* list of healed blocks */
 	uint64_t	spa_deflate;		/* should we deflate? */
 	uint64_t	spa_history;		/* history object */
+	uint64_t	spa_arc_warm_obj;	/* ARC warm-restart manifest */
 	kmutex_t	spa_history_lock;	/* history lock */
 	vdev_t		*spa_pending_vdev;	/* pending vdev additions */
 	kmutex_t	spa_props_lock;		/* property lock */
@@ -440,6 +448,8 @@ struct spa {
 	taskqid_t	spa_deadman_tqid;	/* Task id */
 	uint64_t	spa_deadman_calls;	/* number of deadman calls */
 	hrtime_t	spa_sync_starttime;	/* starting time of spa_sync */
+	hrtime_t	spa_sync_phase_time[SPA_SYNC_PHASES]; /* this txg */
+	uint32_t	spa_sync_phase_count[SPA_SYNC_PHASES]; /* this txg */
 	uint64_t	spa_deadman_synctime;	/* deadman sync expiration */
 	uint64_t	spa_deadman_ziotime;	/* deadman zio expiration */
 	uint64_t	spa_all_vdev_zaps;	/* ZAP of per-vd ZAP obj #s */
@@ -471,6 +481,10 @@ struct spa {
 	int		spa_waiters;		/* number of waiting threads */
 	boolean_t	spa_waiters_cancel;	/* waiters should return */
 
+	/* compression=adaptive state, see zio_compress_adaptive() */
+	uint64_t	spa_compress_inflight ____cacheline_aligned;
+	uint64_t	spa_compress_ratio[SPA_COMPRESS_RATIO_BUCKETS];
+
 	char		*spa_compatibility;	/* compatibility file(s) */
 	uint64_t	spa_dedup_table_quota;	/* property DDT maximum size */
 	uint64_t	spa_dedup_dsize;	/* cached on-disk size of DDT */
@@ -489,6 +503,7 @@ struct spa {
 extern char *spa_config_path;
 extern const char *zfs_deadman_failmode;
 extern uint_t spa_slop_shift;
+extern uint_t spa_taskq_batch_threads(void);
 extern void spa_taskq_dispatch(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
     task_func_t *func, zio_t *zio, boolean_t cutinline);
 extern void spa_load_spares(spa_t *spa);
@@ -129,6 +129,7 @@ extern "C" {
 #define	ESC_ZFS_ERRORSCRUB_ABORT	"errorscrub_abort"
 #define	ESC_ZFS_ERRORSCRUB_RESUME	"errorscrub_resume"
 #define	ESC_ZFS_ERRORSCRUB_PAUSED	"errorscrub_paused"
+#define	ESC_ZFS_ZIL_REPLAY		"zil_replay"
 
 /*
  * datalink subclass definitions.
@@ -187,8 +187,9 @@ extern void vdev_queue_io_done(zio_t *zio);
 extern void vdev_queue_change_io_priority(zio_t *zio, zio_priority_t priority);
 
 extern uint32_t vdev_queue_length(vdev_t *vd);
-extern uint64_t vdev_queue_last_offset(vdev_t *vd);
+extern uint64_t vdev_queue_last_offset(vdev_t *vd, uint64_t offset);
 extern uint64_t vdev_queue_class_length(vdev_t *vq, zio_priority_t p);
+extern uint32_t vdev_queue_class_active(vdev_t *vd, zio_priority_t p);
 extern boolean_t vdev_queue_pool_busy(spa_t *spa);
 
 extern void vdev_config_dirty(vdev_t *vd);
@@ -34,13 +34,26 @@
 extern "C" {
 #endif
 
+#ifndef _KERNEL
+typedef struct vdev_file_ring vdev_file_ring_t;
+#endif
+
 typedef struct vdev_file {
 	zfs_file_t	*vf_file;
+#ifndef _KERNEL
+	vdev_file_ring_t *vf_ring;
+#endif
 } vdev_file_t;
 
 extern void vdev_file_init(void);
 extern void vdev_file_fini(void);
 
+#ifndef _KERNEL
+extern vdev_file_ring_t *vdev_file_ring_create(zfs_file_t *fp, uint_t entries);
+extern void vdev_file_ring_destroy(vdev_file_ring_t *vr);
+extern void vdev_file_ring_io(vdev_file_ring_t *vr, zio_t *zio);
+#endif
+
 #ifdef	__cplusplus
 }
 #endif
@@ -153,8 +153,30 @@ struct vdev_queue {
 	hrtime_t	vq_io_delta_ts;
 	zio_t		vq_io_search; /* used as local for stack reduction */
 	kmutex_t	vq_lock;
+	hrtime_t	vq_lock_ts;	/* vq_lock acquired at, if timed */
+	uint_t		vq_nshards;	/* Number of queue shards. */
+	struct vdev_queue *vq_shards;	/* Shards 1 .. vq_nshards - 1. */
+	uint_t		vq_shard;	/* Index of this shard. */
+	boolean_t	vq_spill_held;	/* Spill slot taken for next I/O. */
+	/* Active I/Os holding a spill slot, per class. */
+	uint32_t	vq_cspill[ZIO_PRIORITY_NUM_QUEUEABLE];
+	/* Shard 0 only: spill slots in use, and shards waiting for one. */
+	uint32_t	vq_spill[ZIO_PRIORITY_NUM_QUEUEABLE];
+	uint64_t	vq_spill_wait;
 };
 
+/*
+ * The queue of a non-rotating leaf vdev may be split into independent shards,
+ * each with its own lock, queued and active I/Os, and a share of the class
+ * limits.  Shard 0 is the vdev's own vdev_queue_t.
+ */
+static inline vdev_queue_t *
+vdev_queue_shard(vdev_queue_t *vq, uint_t s)
+{
+	ASSERT3U(s, <, MAX(vq->vq_nshards, 1));
+	return (s == 0 ? vq : &vq->vq_shards[s - 1]);
+}
+
 typedef enum vdev_alloc_bias {
 	VDEV_BIAS_NONE,
 	VDEV_BIAS_LOG,		/* dedicated to ZIL data (SLOG) */
@@ -280,6 +302,7 @@ struct vdev {
 	uint64_t	vdev_removing;	/* device is being removed?	*/
 	uint64_t	vdev_failfast;	/* device failfast setting	*/
 	boolean_t	vdev_autosit;	/* automatic sitout management	*/
+	boolean_t	vdev_queue_bypass; /* sync I/O skips the queue	*/
 	boolean_t	vdev_rz_expanding; /* raidz is being expanded?	*/
 	boolean_t	vdev_ishole;	/* is a hole in the namespace	*/
 	uint64_t	vdev_top_zap;
@@ -782,6 +782,18 @@ extern int kmem_cache_reap_active(void);
 
 #endif  /* _KERNEL || _STANDALONE */
 
+/*
+ * A kmutex_t padded out to its own cache line, for arrays of hash
+ * table locks which are taken by many CPUs at once.  Without the
+ * padding, CPUs working on unrelated buckets bounce the same lines.
+ */
+#define	ZFS_MUTEX_PAD	64
+
+typedef union zfs_padded_mutex {
+	kmutex_t	pm_lock;
+	uint8_t		pm_pad[P2ROUNDUP(sizeof (kmutex_t), ZFS_MUTEX_PAD)];
+} zfs_padded_mutex_t;
+
 #ifdef __cplusplus
 };
 #endif
@@ -27,6 +27,7 @@
 #ifndef	_SYS_FS_ZFS_VNOPS_H
 #define	_SYS_FS_ZFS_VNOPS_H
 
+#include <sys/fs/zfs.h>
 #include <sys/zfs_vnops_os.h>
 
 extern int zfs_bclone_enabled;
@@ -41,6 +42,10 @@ extern int zfs_clone_range(znode_t *, uint64_t *, znode_t *, uint64_t *,
 extern int zfs_clone_range_replay(znode_t *, uint64_t, uint64_t, uint64_t,
     const blkptr_t *, size_t);
 extern int zfs_rewrite(znode_t *, uint64_t, uint64_t, uint64_t, uint64_t);
+extern uint64_t zfs_prefetch(znode_t *, uint64_t, uint64_t, uint64_t);
+extern int zfs_prefetch_ranges(znode_t *, const zfs_prefetch_args_t *, int,
+    cred_t *);
+extern uint64_t zfs_prefetch_hint_max;
 
 extern int zfs_getsecattr(znode_t *, vsecattr_t *, int, cred_t *);
 extern int zfs_setsecattr(znode_t *, vsecattr_t *, int, cred_t *);
@@ -472,6 +472,14 @@ typedef struct itx {
 	uint8_t		itx_lr_data[];	/* type-specific part of lr_xx_t */
 } itx_t;
 
+/*
+ * Number of log2 microsecond buckets in each ZIL latency histogram.  The
+ * first bucket counts anything faster than 2^ZIL_HISTO_MIN_SHIFT us (16us),
+ * and the last (2^19us, ~0.5s) collects everything slower.
+ */
+#define	ZIL_HISTO_BUCKETS	16
+#define	ZIL_HISTO_MIN_SHIFT	4
+
 /*
  * Used for zil kstat.
  */
@@ -488,6 +496,15 @@ typedef struct zil_stats {
 	 */
 	kstat_named_t zil_commit_writer_count;
 
+	/*
+	 * Number of times a committing thread found "zl_issuer_lock" held
+	 * by another writer and had to block for it, and the total time
+	 * (in nanoseconds) spent blocked.  High values relative to
+	 * zil_commit_writer_count indicate commit convoys on this ZIL.
+	 */
+	kstat_named_t zil_commit_issuer_contended_count;
+	kstat_named_t zil_commit_issuer_wait_time;
+
 	/*
 	 * Number of times a ZIL commit failed and the ZIL was forced to fall
 	 * back to txg_wait_synced(). The separate counts are for different
@@ -544,11 +561,39 @@ typedef struct zil_stats {
 	kstat_named_t zil_itx_metaslab_slog_bytes;
 	kstat_named_t zil_itx_metaslab_slog_write;
 	kstat_named_t zil_itx_metaslab_slog_alloc;
+
+	/*
+	 * Log records applied by zil_replay(), the bytes of log they
+	 * covered (including out-of-line write data), and the total time
+	 * spent replaying, in nanoseconds.  zil_replay_prefetch_count is
+	 * the number of out-of-line (WR_INDIRECT) write blocks prefetched
+	 * ahead of being replayed.
+	 */
+	kstat_named_t zil_replay_count;
+	kstat_named_t zil_replay_bytes;
+	kstat_named_t zil_replay_time;
+	kstat_named_t zil_replay_prefetch_count;
+
+	/*
+	 * Latency histogram of end to end zil_commit() calls.  Each bucket
+	 * counts calls which took less than its upper bound, carried in
+	 * the entry name (e.g. "zil_commit_histo_1024us"), and at least
+	 * half that; the first and last buckets are open ended.  The lwb
+	 * write and flush histograms depend on the log devices rather than
+	 * the dataset, so they are only in the global "zil" kstat.
+	 *
+	 * Datasets only have this histogram with zil_dataset_histo set.
+	 * Otherwise their kstats leave these entries out, so they must stay
+	 * at the end of zil_kstat_values_t and of dataset_kstat_values_t.
+	 */
+	kstat_named_t zil_commit_histo[ZIL_HISTO_BUCKETS];
 } zil_kstat_values_t;
 
 typedef struct zil_sums {
 	wmsum_t zil_commit_count;
 	wmsum_t zil_commit_writer_count;
+	wmsum_t zil_commit_issuer_contended_count;
+	wmsum_t zil_commit_issuer_wait_time;
 	wmsum_t zil_commit_error_count;
 	wmsum_t zil_commit_stall_count;
 	wmsum_t zil_commit_suspend_count;
@@ -568,6 +613,11 @@ typedef struct zil_sums {
 	wmsum_t zil_itx_metaslab_slog_bytes;
 	wmsum_t zil_itx_metaslab_slog_write;
 	wmsum_t zil_itx_metaslab_slog_alloc;
+	wmsum_t zil_replay_count;
+	wmsum_t zil_replay_bytes;
+	wmsum_t zil_replay_time;
+	wmsum_t zil_replay_prefetch_count;
+	wmsum_t *zil_commit_histo;	/* ZIL_HISTO_BUCKETS, or NULL */
 } zil_sums_t;
 
 #define	ZIL_STAT_INCR(zil, stat, val) \
@@ -581,6 +631,14 @@ typedef struct zil_sums {
 #define	ZIL_STAT_BUMP(zil, stat) \
     ZIL_STAT_INCR(zil, stat, 1);
 
+#define	ZIL_STAT_HISTO(zil, histo, delta) \
+	do { \
+		int bucket = zil_histo_bucket(delta); \
+		wmsum_add(&(zil_sums_global.histo[bucket]), 1); \
+		if ((zil)->zl_sums && (zil)->zl_sums->histo) \
+			wmsum_add(&((zil)->zl_sums->histo[bucket]), 1); \
+	} while (0)
+
 /*
  * Flags for zil_commit_flags(). zil_commit() is a shortcut for
  * zil_commit_flags(ZIL_COMMIT_FAILMODE), which is the most common use.
@@ -663,10 +721,14 @@ extern uint64_t	zil_max_log_data(zilog_t *zilog, size_t hdrsize);
 extern itx_wr_state_t zil_write_state(zilog_t *zilog, uint64_t size,
     uint32_t blocksize, boolean_t o_direct, boolean_t commit);
 
-extern void zil_sums_init(zil_sums_t *zs);
+extern int zil_dataset_histo;
+
+extern void zil_sums_init(zil_sums_t *zs, boolean_t histo);
 extern void zil_sums_fini(zil_sums_t *zs);
+extern void zil_kstat_values_init(zil_kstat_values_t *zs);
 extern void zil_kstat_values_update(zil_kstat_values_t *zs,
     zil_sums_t *zil_sums);
+extern int zil_histo_bucket(hrtime_t delta);
 
 extern int zil_replay_disable;
 extern uint_t zfs_immediate_write_sz;
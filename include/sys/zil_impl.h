@@ -122,6 +122,7 @@ typedef struct lwb {
 	zio_t		*lwb_write_zio;	/* zio for the lwb buffer */
 	zio_t		*lwb_root_zio;	/* root zio for lwb write and flushes */
 	hrtime_t	lwb_issued_timestamp; /* when was the lwb issued? */
+	hrtime_t	lwb_flush_timestamp; /* when were flushes issued? */
 	uint64_t	lwb_issued_txg;	/* the txg when the write is issued */
 	uint64_t	lwb_alloc_txg;	/* the txg when lwb_blk is allocated */
 	uint64_t	lwb_max_txg;	/* highest txg in this lwb */
@@ -154,6 +155,7 @@ typedef struct zil_commit_waiter {
 	kmutex_t	zcw_lock;	/* protects fields of this struct */
 	list_node_t	zcw_node;	/* linkage in lwb_t:lwb_waiter list */
 	lwb_t		*zcw_lwb;	/* back pointer to lwb when linked */
+	int		zcw_nused;	/* lwb_nused of zcw_lwb when linked */
 	boolean_t	zcw_done;	/* B_TRUE when "done", else B_FALSE */
 	int		zcw_error;	/* result to return from zil_commit() */
 } zil_commit_waiter_t;
@@ -202,6 +204,7 @@ struct zilog {
 	zil_get_data_t	*zl_get_data;	/* callback to get object content */
 	lwb_t		*zl_last_lwb_opened; /* most recent lwb opened */
 	hrtime_t	zl_last_lwb_latency; /* zio latency of last lwb done */
+	hrtime_t	zl_commit_delay; /* adaptive lwb batching delay */
 	uint64_t	zl_lr_seq;	/* on-disk log record sequence number */
 	uint64_t	zl_commit_lr_seq; /* last committed on-disk lr seq */
 	uint64_t	zl_destroy_txg;	/* txg of last zil_destroy() */
@@ -490,6 +490,13 @@ struct zio {
 	blkptr_t	io_bp_copy;
 	list_t		io_parent_list;
 	list_t		io_child_list;
+	/*
+	 * Link to the parent this zio was created with.  This grows every
+	 * zio by 40 bytes (a zio_link_t less io_stall), but saves a 48 byte
+	 * zio_link_cache allocation for each zio that has a parent, which
+	 * is all but the roots, so zio memory shrinks overall.
+	 */
+	zio_link_t	io_parent_link;
 	zio_t		*io_logical;
 	zio_transform_t *io_transform_stack;
 
@@ -516,6 +523,7 @@ struct zio {
 	metaslab_class_t *io_metaslab_class;	/* dva throttle class */
 
 	enum zio_qstate	io_queue_state;	/* vdev queue state */
+	uint8_t		io_queue_shard;	/* vdev queue shard */
 	union {
 		list_node_t l;
 		avl_node_t a;
@@ -541,7 +549,6 @@ struct zio {
 	int		io_error;
 	int		io_child_error[ZIO_CHILD_TYPES];
 	uint64_t	io_children[ZIO_CHILD_TYPES][ZIO_WAIT_TYPES];
-	uint64_t	*io_stall;
 	zio_t		*io_gang_leader;
 	zio_gang_node_t	*io_gang_tree;
 	void		*io_executor;
@@ -681,6 +688,12 @@ extern enum zio_compress zio_compress_select(spa_t *spa,
     enum zio_compress child, enum zio_compress parent);
 extern uint8_t zio_complevel_select(spa_t *spa, enum zio_compress compress,
     uint8_t child, uint8_t parent);
+extern uint8_t zio_complevel_frames(enum zio_compress compress,
+    uint8_t level);
+extern enum zio_compress zio_compress_adaptive(spa_t *spa, uint64_t objset,
+    uint8_t *level);
+extern void zio_compress_adaptive_done(spa_t *spa, uint64_t objset,
+    uint64_t lsize, uint64_t psize);
 
 extern void zio_suspend(spa_t *spa, zio_t *zio, zio_suspend_reason_t);
 extern int zio_resume(spa_t *spa);
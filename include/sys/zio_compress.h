@@ -116,10 +116,23 @@ enum zio_zstd_levels {
 	ZIO_ZSTD_LEVEL_FAST_500,
 	ZIO_ZSTD_LEVEL_FAST_1000,
 #define	ZIO_ZSTD_LEVEL_FAST_MAX	ZIO_ZSTD_LEVEL_FAST_1000
-	ZIO_ZSTD_LEVEL_AUTO = 251, /* Reserved for future use */
+	ZIO_ZSTD_LEVEL_AUTO = 251, /* compression=adaptive */
 	ZIO_ZSTD_LEVEL_LEVELS
 };
 
+/*
+ * A positive zstd level may be combined with ZIO_ZSTD_LEVEL_FRAMES, which
+ * asks for large blocks to be written as a series of independent frames
+ * (zstd_frames=on).  The flag is not stored in the zstd header of a block.
+ * Reading a block sets it again if the block is made of frames, so that
+ * the ARC recompresses the block into the same layout.
+ */
+#define	ZIO_ZSTD_LEVEL_FRAMES	0x80
+#define	ZIO_ZSTD_LEVEL_HAS_FRAMES(level)			\
+	(((level) & ZIO_ZSTD_LEVEL_FRAMES) &&			\
+	((level) & ~ZIO_ZSTD_LEVEL_FRAMES) >= ZIO_ZSTD_LEVEL_MIN &&	\
+	((level) & ~ZIO_ZSTD_LEVEL_FRAMES) <= ZIO_ZSTD_LEVEL_MAX)
+
 /* Forward Declaration to avoid visibility problems */
 struct zio_prop;
 
@@ -152,6 +165,12 @@ extern zio_compress_info_t zio_compress_table[ZIO_COMPRESS_FUNCTIONS];
 extern void lz4_init(void);
 extern void lz4_fini(void);
 
+/*
+ * Adaptive compression (compression=adaptive) init & free
+ */
+extern void zio_compress_init(void);
+extern void zio_compress_fini(void);
+
 /*
  * Compression routines.
  */
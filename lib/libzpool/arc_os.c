@@ -86,3 +86,19 @@ void
 arc_unregister_hotplug(void)
 {
 }
+
+/*
+ * ARC buffers are not tracked per memory domain here; everything is
+ * accounted to a single node.
+ */
+uint_t
+arc_numa_node(void)
+{
+	return (0);
+}
+
+uint_t
+arc_numa_node_count(void)
+{
+	return (1);
+}
@@ -0,0 +1,552 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Asynchronous I/O for file vdevs in userspace.
+ *
+ * Without this, every read and write of a file vdev is a synchronous
+ * pread/pwrite on a vdev_file_taskq thread, so ztest and zdb can have no
+ * more I/O outstanding than there are taskq threads.  Instead, each open
+ * file vdev gets an io_uring and a completion thread.  vdev_file_ring_io()
+ * queues a submission entry and returns; entries queued while another
+ * thread is already inside io_uring_enter() are submitted together by that
+ * thread on its next pass, so submissions are batched under load.  The
+ * completion thread reaps completions and hands the zios back to the zio
+ * pipeline.  The io_uring system calls are used directly, so liburing is
+ * not required.
+ *
+ * The ring is only an accelerator: vdev_file_ring_create() returns NULL if
+ * io_uring is not available, not permitted, or too old to support the
+ * read and write operations (before Linux 5.6), and the caller falls back
+ * to the taskq.
+ */
+
+#include <sys/zfs_context.h>
+#include <sys/spa.h>
+#include <sys/vdev_file.h>
+#include <sys/vdev_impl.h>
+#include <sys/zio.h>
+#include <sys/abd.h>
+#include <sys/zfs_file.h>
+
+#ifdef HAVE_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+typedef struct vdev_file_req {
+	zio_t		*vfr_zio;
+	void		*vfr_buf;
+	size_t		vfr_done;	/* bytes transferred */
+	int		vfr_error;
+	uint_t		vfr_parts;	/* outstanding submission entries */
+} vdev_file_req_t;
+
+struct vdev_file_ring {
+	zfs_file_t	*vr_file;
+	int		vr_fd;
+
+	kmutex_t	vr_lock;
+	kcondvar_t	vr_cv;
+	uint_t		vr_entries;	/* submission queue size */
+	uint_t		vr_inflight;	/* entries queued or in progress */
+	uint_t		vr_unsubmitted;	/* entries not yet passed to kernel */
+	boolean_t	vr_submitting;	/* a thread is in io_uring_enter() */
+	boolean_t	vr_exiting;
+	boolean_t	vr_thread_exited;
+
+	/* submission queue */
+	void		*vr_sq_ptr;
+	size_t		vr_sq_size;
+	uint32_t	*vr_sq_head;
+	uint32_t	*vr_sq_tail;
+	uint32_t	vr_sq_mask;
+	uint32_t	*vr_sq_array;
+	struct io_uring_sqe *vr_sqes;
+	size_t		vr_sqes_size;
+
+	/* completion queue */
+	void		*vr_cq_ptr;
+	size_t		vr_cq_size;
+	uint32_t	*vr_cq_head;
+	uint32_t	*vr_cq_tail;
+	uint32_t	vr_cq_mask;
+	struct io_uring_cqe *vr_cqes;
+};
+
+static int
+vdev_file_ring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return (syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int
+vdev_file_ring_enter(int fd, unsigned to_submit, unsigned min_complete,
+    unsigned flags)
+{
+	return (syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+	    flags, NULL, 0));
+}
+
+static int
+vdev_file_ring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+	return (syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+/*
+ * io_uring_setup() succeeds from Linux 5.1, but IORING_OP_READ and
+ * IORING_OP_WRITE only exist from 5.6; older kernels fail every such entry
+ * with -EINVAL, which the completion thread treats as a bug.  Ask the
+ * kernel which operations it supports.  IORING_REGISTER_PROBE itself was
+ * added in 5.6, so its failure also means the ring cannot be used.
+ */
+static boolean_t
+vdev_file_ring_probe(int fd)
+{
+	static const uint8_t ops[] =
+	    { IORING_OP_NOP, IORING_OP_READ, IORING_OP_WRITE };
+	size_t size = sizeof (struct io_uring_probe) +
+	    IORING_OP_LAST * sizeof (struct io_uring_probe_op);
+	struct io_uring_probe *probe = kmem_zalloc(size, KM_SLEEP);
+	boolean_t ok = B_FALSE;
+
+	if (vdev_file_ring_register(fd, IORING_REGISTER_PROBE, probe,
+	    IORING_OP_LAST) == 0) {
+		ok = B_TRUE;
+		for (int i = 0; i < ARRAY_SIZE(ops); i++) {
+			if (ops[i] > probe->last_op ||
+			    !(probe->ops[ops[i]].flags &
+			    IO_URING_OP_SUPPORTED))
+				ok = B_FALSE;
+		}
+	}
+	kmem_free(probe, size);
+	return (ok);
+}
+
+static void
+vdev_file_ring_unmap(vdev_file_ring_t *vr)
+{
+	if (vr->vr_sqes != NULL)
+		(void) munmap(vr->vr_sqes, vr->vr_sqes_size);
+	if (vr->vr_cq_ptr != NULL && vr->vr_cq_ptr != vr->vr_sq_ptr)
+		(void) munmap(vr->vr_cq_ptr, vr->vr_cq_size);
+	if (vr->vr_sq_ptr != NULL)
+		(void) munmap(vr->vr_sq_ptr, vr->vr_sq_size);
+}
+
+/*
+ * Finish a request whose submission entries have all completed.  A short
+ * transfer is completed synchronously, as the taskq path would have.
+ */
+static void
+vdev_file_ring_req_done(vdev_file_ring_t *vr, vdev_file_req_t *vfr)
+{
+	zio_t *zio = vfr->vfr_zio;
+	ssize_t resid = 0;
+	int err = vfr->vfr_error;
+
+	if (err == 0 && vfr->vfr_done < zio->io_size) {
+		char *buf = (char *)vfr->vfr_buf + vfr->vfr_done;
+		size_t size = zio->io_size - vfr->vfr_done;
+		loff_t off = zio->io_offset + vfr->vfr_done;
+
+		if (zio->io_type == ZIO_TYPE_READ) {
+			err = zfs_file_pread(vr->vr_file, buf, size, off,
+			    &resid);
+		} else {
+			err = zfs_file_pwrite(vr->vr_file, buf, size, off,
+			    zio->io_vd->vdev_ashift, &resid);
+		}
+	}
+
+	if (zio->io_type == ZIO_TYPE_READ)
+		abd_return_buf_copy(zio->io_abd, vfr->vfr_buf, zio->io_size);
+	else
+		abd_return_buf(zio->io_abd, vfr->vfr_buf, zio->io_size);
+
+	zio->io_error = err;
+	if (resid != 0 && zio->io_error == 0)
+		zio->io_error = SET_ERROR(ENOSPC);
+
+	kmem_free(vfr, sizeof (vdev_file_req_t));
+	zio_delay_interrupt(zio);
+}
+
+static void
+vdev_file_ring_thread(void *arg)
+{
+	vdev_file_ring_t *vr = arg;
+
+	for (;;) {
+		uint32_t head = *vr->vr_cq_head;
+		uint32_t tail = __atomic_load_n(vr->vr_cq_tail,
+		    __ATOMIC_ACQUIRE);
+		uint_t reaped = 0;
+
+		if (head == tail) {
+			if (vdev_file_ring_enter(vr->vr_fd, 0, 1,
+			    IORING_ENTER_GETEVENTS) < 0) {
+				VERIFY(errno == EINTR || errno == EAGAIN ||
+				    errno == EBUSY);
+			}
+			continue;
+		}
+
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe =
+			    &vr->vr_cqes[head & vr->vr_cq_mask];
+			vdev_file_req_t *vfr =
+			    (vdev_file_req_t *)(uintptr_t)cqe->user_data;
+			int res = cqe->res;
+
+			reaped++;
+
+			/* A NOP without a request asks us to exit. */
+			if (vfr == NULL)
+				continue;
+
+			if (res == -EINVAL) {
+				/*
+				 * As in zfs_file_pread() and zfs_file_pwrite(),
+				 * this most likely is an O_DIRECT alignment
+				 * issue, so abort() to catch the offender.
+				 */
+				abort();
+			}
+
+			/*
+			 * The second half of a split write is cancelled when
+			 * the first half fails or is short; the first half's
+			 * result is what is reported.
+			 */
+			if (res >= 0)
+				vfr->vfr_done += res;
+			else if (res != -ECANCELED && vfr->vfr_error == 0)
+				vfr->vfr_error = -res;
+
+			if (--vfr->vfr_parts == 0)
+				vdev_file_ring_req_done(vr, vfr);
+		}
+		__atomic_store_n(vr->vr_cq_head, head, __ATOMIC_RELEASE);
+
+		mutex_enter(&vr->vr_lock);
+		ASSERT3U(vr->vr_inflight, >=, reaped);
+		vr->vr_inflight -= reaped;
+		cv_broadcast(&vr->vr_cv);
+		if (vr->vr_exiting && vr->vr_inflight == 0) {
+			vr->vr_thread_exited = B_TRUE;
+			cv_broadcast(&vr->vr_cv);
+			mutex_exit(&vr->vr_lock);
+			thread_exit();
+		}
+		mutex_exit(&vr->vr_lock);
+	}
+}
+
+/*
+ * Return the next free submission entry, cleared, for the caller to fill
+ * in under vr_lock.  The caller must have reserved it in vr_inflight.
+ */
+static struct io_uring_sqe *
+vdev_file_ring_get_sqe(vdev_file_ring_t *vr)
+{
+	uint32_t tail = *vr->vr_sq_tail + vr->vr_unsubmitted;
+	uint32_t idx = tail & vr->vr_sq_mask;
+	struct io_uring_sqe *sqe = &vr->vr_sqes[idx];
+
+	ASSERT(MUTEX_HELD(&vr->vr_lock));
+	memset(sqe, 0, sizeof (*sqe));
+	vr->vr_sq_array[idx] = idx;
+	vr->vr_unsubmitted++;
+	return (sqe);
+}
+
+/*
+ * Pass the queued submission entries to the kernel, unless another thread
+ * is already doing so, in which case it will pick them up on its next pass.
+ */
+static void
+vdev_file_ring_submit(vdev_file_ring_t *vr)
+{
+	ASSERT(MUTEX_HELD(&vr->vr_lock));
+
+	if (vr->vr_submitting)
+		return;
+
+	vr->vr_submitting = B_TRUE;
+	while (vr->vr_unsubmitted != 0) {
+		uint32_t tail = *vr->vr_sq_tail + vr->vr_unsubmitted;
+		uint_t delay = 0;
+
+		vr->vr_unsubmitted = 0;
+		__atomic_store_n(vr->vr_sq_tail, tail, __ATOMIC_RELEASE);
+
+		/*
+		 * The kernel advances the submission queue head as it
+		 * consumes entries, so that, not the return value, says what
+		 * is left.  A call that consumes nothing (returns 0, or fails
+		 * with EAGAIN or EBUSY while completions are backed up) is
+		 * retried after an increasing delay rather than in a loop.
+		 */
+		mutex_exit(&vr->vr_lock);
+		for (;;) {
+			uint_t n = tail - __atomic_load_n(vr->vr_sq_head,
+			    __ATOMIC_ACQUIRE);
+			int rc;
+
+			if (n == 0)
+				break;
+			rc = vdev_file_ring_enter(vr->vr_fd, n, 0, 0);
+			if (rc > 0) {
+				delay = 0;
+				continue;
+			}
+			if (rc < 0) {
+				VERIFY(errno == EINTR || errno == EAGAIN ||
+				    errno == EBUSY);
+				if (errno == EINTR)
+					continue;
+			}
+			delay = MIN(MAX(delay * 2, 1), 1000);
+			(void) usleep(delay);
+		}
+		mutex_enter(&vr->vr_lock);
+	}
+	vr->vr_submitting = B_FALSE;
+	cv_broadcast(&vr->vr_cv);
+}
+
+void
+vdev_file_ring_io(vdev_file_ring_t *vr, zio_t *zio)
+{
+	vdev_file_req_t *vfr = kmem_zalloc(sizeof (*vfr), KM_SLEEP);
+	struct io_uring_sqe *sqe;
+	size_t split = 0;
+
+	ASSERT(zio->io_type == ZIO_TYPE_READ || zio->io_type == ZIO_TYPE_WRITE);
+
+	vfr->vfr_zio = zio;
+	vfr->vfr_parts = 1;
+	if (zio->io_type == ZIO_TYPE_READ) {
+		vfr->vfr_buf = abd_borrow_buf(zio->io_abd, zio->io_size);
+	} else {
+		/*
+		 * Like zfs_file_pwrite(), split writes in two at a random
+		 * sector so that ztest can be killed between the halves.
+		 */
+		int sectors = zio->io_size >> zio->io_vd->vdev_ashift;
+
+		vfr->vfr_buf = abd_borrow_buf_copy(zio->io_abd, zio->io_size);
+		if (sectors > 1 && vr->vr_entries > 1) {
+			split = (size_t)(rand() % sectors) <<
+			    zio->io_vd->vdev_ashift;
+		}
+		if (split != 0)
+			vfr->vfr_parts = 2;
+	}
+
+	mutex_enter(&vr->vr_lock);
+	while (vr->vr_inflight + vfr->vfr_parts > vr->vr_entries)
+		cv_wait(&vr->vr_cv, &vr->vr_lock);
+	vr->vr_inflight += vfr->vfr_parts;
+
+	if (zio->io_type == ZIO_TYPE_READ) {
+		sqe = vdev_file_ring_get_sqe(vr);
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = vr->vr_file->f_fd;
+		sqe->addr = (uintptr_t)vfr->vfr_buf;
+		sqe->len = zio->io_size;
+		sqe->off = zio->io_offset;
+		sqe->user_data = (uintptr_t)vfr;
+	} else {
+		if (split != 0) {
+			sqe = vdev_file_ring_get_sqe(vr);
+			sqe->opcode = IORING_OP_WRITE;
+			sqe->flags = IOSQE_IO_LINK;
+			sqe->fd = vr->vr_file->f_fd;
+			sqe->addr = (uintptr_t)vfr->vfr_buf;
+			sqe->len = split;
+			sqe->off = zio->io_offset;
+			sqe->user_data = (uintptr_t)vfr;
+		}
+		sqe = vdev_file_ring_get_sqe(vr);
+		sqe->opcode = IORING_OP_WRITE;
+		sqe->fd = vr->vr_file->f_fd;
+		sqe->addr = (uintptr_t)vfr->vfr_buf + split;
+		sqe->len = zio->io_size - split;
+		sqe->off = zio->io_offset + split;
+		sqe->user_data = (uintptr_t)vfr;
+	}
+
+	vdev_file_ring_submit(vr);
+	mutex_exit(&vr->vr_lock);
+}
+
+vdev_file_ring_t *
+vdev_file_ring_create(zfs_file_t *fp, uint_t entries)
+{
+	struct io_uring_params p = { 0 };
+	vdev_file_ring_t *vr;
+	void *ptr;
+	int fd;
+
+	/* The dump file is written by zfs_file_pread(), so keep using it. */
+	if (fp->f_dump_fd != -1)
+		return (NULL);
+
+	fd = vdev_file_ring_setup(MIN(entries, 4096), &p);
+	if (fd < 0) {
+		zfs_dbgmsg("vdev_file_ring_create: io_uring_setup failed "
+		    "[error=%d], using synchronous I/O", errno);
+		return (NULL);
+	}
+	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	if (!vdev_file_ring_probe(fd)) {
+		zfs_dbgmsg("vdev_file_ring_create: io_uring lacks read and "
+		    "write operations, using synchronous I/O");
+		(void) close(fd);
+		return (NULL);
+	}
+
+	vr = kmem_zalloc(sizeof (vdev_file_ring_t), KM_SLEEP);
+	vr->vr_file = fp;
+	vr->vr_fd = fd;
+	vr->vr_entries = p.sq_entries;
+
+	vr->vr_sq_size = p.sq_off.array + p.sq_entries * sizeof (uint32_t);
+	vr->vr_cq_size = p.cq_off.cqes +
+	    p.cq_entries * sizeof (struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		vr->vr_sq_size = vr->vr_cq_size =
+		    MAX(vr->vr_sq_size, vr->vr_cq_size);
+	}
+
+	ptr = mmap(NULL, vr->vr_sq_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	vr->vr_sq_ptr = ptr;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ptr = vr->vr_sq_ptr;
+	} else {
+		ptr = mmap(NULL, vr->vr_cq_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (ptr == MAP_FAILED)
+			goto fail;
+	}
+	vr->vr_cq_ptr = ptr;
+
+	vr->vr_sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+	ptr = mmap(NULL, vr->vr_sqes_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (ptr == MAP_FAILED)
+		goto fail;
+	vr->vr_sqes = ptr;
+
+	vr->vr_sq_head = (uint32_t *)((char *)vr->vr_sq_ptr + p.sq_off.head);
+	vr->vr_sq_tail = (uint32_t *)((char *)vr->vr_sq_ptr + p.sq_off.tail);
+	vr->vr_sq_mask =
+	    *(uint32_t *)((char *)vr->vr_sq_ptr + p.sq_off.ring_mask);
+	vr->vr_sq_array = (uint32_t *)((char *)vr->vr_sq_ptr + p.sq_off.array);
+	vr->vr_cq_head = (uint32_t *)((char *)vr->vr_cq_ptr + p.cq_off.head);
+	vr->vr_cq_tail = (uint32_t *)((char *)vr->vr_cq_ptr + p.cq_off.tail);
+	vr->vr_cq_mask =
+	    *(uint32_t *)((char *)vr->vr_cq_ptr + p.cq_off.ring_mask);
+	vr->vr_cqes = (struct io_uring_cqe *)((char *)vr->vr_cq_ptr +
+	    p.cq_off.cqes);
+
+	mutex_init(&vr->vr_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&vr->vr_cv, NULL, CV_DEFAULT, NULL);
+
+	(void) thread_create_named("z_vdev_file_ring", NULL, 0,
+	    vdev_file_ring_thread, vr, 0, &p0, TS_RUN, minclsyspri);
+
+	return (vr);
+
+fail:
+	zfs_dbgmsg("vdev_file_ring_create: mmap failed [error=%d], "
+	    "using synchronous I/O", errno);
+	vdev_file_ring_unmap(vr);
+	(void) close(fd);
+	kmem_free(vr, sizeof (vdev_file_ring_t));
+	return (NULL);
+}
+
+void
+vdev_file_ring_destroy(vdev_file_ring_t *vr)
+{
+	struct io_uring_sqe *sqe;
+
+	/*
+	 * Wait for outstanding I/O and for the last submitter to let go of
+	 * the ring, as its I/O may complete before it returns.  Then queue a
+	 * NOP without a request to wake the completion thread and have it
+	 * exit.
+	 */
+	mutex_enter(&vr->vr_lock);
+	while (vr->vr_inflight != 0 || vr->vr_submitting)
+		cv_wait(&vr->vr_cv, &vr->vr_lock);
+	vr->vr_exiting = B_TRUE;
+	vr->vr_inflight++;
+	sqe = vdev_file_ring_get_sqe(vr);
+	sqe->opcode = IORING_OP_NOP;
+	vdev_file_ring_submit(vr);
+	while (!vr->vr_thread_exited)
+		cv_wait(&vr->vr_cv, &vr->vr_lock);
+	mutex_exit(&vr->vr_lock);
+
+	vdev_file_ring_unmap(vr);
+	(void) close(vr->vr_fd);
+	cv_destroy(&vr->vr_cv);
+	mutex_destroy(&vr->vr_lock);
+	kmem_free(vr, sizeof (vdev_file_ring_t));
+}
+
+#else /* !HAVE_IO_URING */
+
+vdev_file_ring_t *
+vdev_file_ring_create(zfs_file_t *fp, uint_t entries)
+{
+	(void) fp, (void) entries;
+	return (NULL);
+}
+
+void
+vdev_file_ring_destroy(vdev_file_ring_t *vr)
+{
+	(void) vr;
+	panic("vdev_file_ring_destroy: no rings without io_uring");
+}
+
+void
+vdev_file_ring_io(vdev_file_ring_t *vr, zio_t *zio)
+{
+	(void) vr, (void) zio;
+	panic("vdev_file_ring_io: no rings without io_uring");
+}
+
+#endif /* HAVE_IO_URING */
@@ -49,6 +49,9 @@
 #if CAN_USE_GCM_ASM >= 2
 #define	IMPL_AVX2	(UINT32_MAX-3)
 #endif
+#if CAN_USE_GCM_ASM >= 3
+#define	IMPL_AVX512	(UINT32_MAX-4)
+#endif
 #endif
 #define	GCM_IMPL_READ(i) (*(volatile uint32_t *) &(i))
 static uint32_t icp_gcm_impl = IMPL_FASTEST;
@@ -67,6 +70,8 @@ extern boolean_t ASMABI atomic_toggle_boolean_nv(volatile boolean_t *);
 
 static inline boolean_t gcm_avx_will_work(void);
 static inline boolean_t gcm_avx2_will_work(void);
+static inline boolean_t gcm_avx512_will_work(void);
+static inline boolean_t gcm_impl_will_work(gcm_impl impl);
 static inline void gcm_use_impl(gcm_impl impl);
 static inline gcm_impl gcm_toggle_impl(void);
 
@@ -77,6 +82,20 @@ static int gcm_encrypt_final_avx(gcm_ctx_t *, crypto_data_t *, size_t);
 static int gcm_decrypt_final_avx(gcm_ctx_t *, crypto_data_t *, size_t);
 static int gcm_init_avx(gcm_ctx_t *, const uint8_t *, size_t, const uint8_t *,
     size_t, size_t);
+static void gcm_benchmark(void);
+
+/*
+ * The avx implementation "fastest" stands for.  Until gcm_benchmark() has
+ * measured them, prefer the widest one; gcm_use_impl() falls back to the
+ * narrower ones if it won't work.
+ */
+#if CAN_USE_GCM_ASM >= 3
+static gcm_impl gcm_fastest_avx_impl = GCM_IMPL_AVX512;
+#elif CAN_USE_GCM_ASM >= 2
+static gcm_impl gcm_fastest_avx_impl = GCM_IMPL_AVX2;
+#else
+static gcm_impl gcm_fastest_avx_impl = GCM_IMPL_AVX;
+#endif
 #endif /* ifdef CAN_USE_GCM_ASM */
 
 /*
@@ -665,7 +684,7 @@ gcm_init_ctx(gcm_ctx_t *gcm_ctx, char *param,
 
 		cmn_err_once(CE_WARN,
 		    "ICP: Can't use the aes generic or cycle implementations "
-		    "in combination with the gcm avx or avx2-vaes "
+		    "in combination with the gcm avx, avx2-vaes or avx512-vaes "
 		    "implementation!");
 		cmn_err_once(CE_WARN,
 		    "ICP: Falling back to a compatible implementation, "
@@ -756,6 +775,9 @@ gcm_impl_get_ops(void)
 	case IMPL_AVX:
 #if CAN_USE_GCM_ASM >= 2
 	case IMPL_AVX2:
+#endif
+#if CAN_USE_GCM_ASM >= 3
+	case IMPL_AVX512:
 #endif
 		/*
 		 * Make sure that we return a valid implementation while
@@ -815,24 +837,19 @@ gcm_impl_init(void)
 
 #ifdef CAN_USE_GCM_ASM
 	/*
-	 * Use the avx implementation if it's available and the implementation
-	 * hasn't changed from its default value of fastest on module load.
+	 * Use the fastest avx implementation if one is available and the
+	 * implementation hasn't changed from its default value of fastest on
+	 * module load.
 	 */
-#if CAN_USE_GCM_ASM >= 2
-	if (gcm_avx2_will_work()) {
-		if (GCM_IMPL_READ(user_sel_impl) == IMPL_FASTEST) {
-			gcm_use_impl(GCM_IMPL_AVX2);
-		}
-	} else
-#endif
 	if (gcm_avx_will_work()) {
 #ifdef HAVE_MOVBE
 		if (zfs_movbe_available() == B_TRUE) {
 			atomic_swap_32(&gcm_avx_can_use_movbe, B_TRUE);
 		}
 #endif
+		gcm_benchmark();
 		if (GCM_IMPL_READ(user_sel_impl) == IMPL_FASTEST) {
-			gcm_use_impl(GCM_IMPL_AVX);
+			gcm_use_impl(gcm_fastest_avx_impl);
 		}
 	}
 #endif
@@ -850,9 +867,34 @@ static const struct {
 #ifdef CAN_USE_GCM_ASM
 		{ "avx",	IMPL_AVX },
 		{ "avx2-vaes",	IMPL_AVX2 },
+#if CAN_USE_GCM_ASM >= 3
+		{ "avx512-vaes",	IMPL_AVX512 },
+#endif
 #endif
 };
 
+#ifdef CAN_USE_GCM_ASM
+/* Whether the avx implementation selected by an option will work. */
+static boolean_t
+gcm_impl_opt_will_work(uint32_t sel)
+{
+	switch (sel) {
+#if CAN_USE_GCM_ASM >= 3
+	case IMPL_AVX512:
+		return (gcm_avx512_will_work());
+#endif
+#if CAN_USE_GCM_ASM >= 2
+	case IMPL_AVX2:
+		return (gcm_avx2_will_work());
+#endif
+	case IMPL_AVX:
+		return (gcm_avx_will_work());
+	default:
+		return (B_TRUE);
+	}
+}
+#endif
+
 /*
  * Function sets desired gcm implementation.
  *
@@ -885,14 +927,8 @@ gcm_impl_set(const char *val)
 	/* Check mandatory options */
 	for (i = 0; i < ARRAY_SIZE(gcm_impl_opts); i++) {
 #ifdef CAN_USE_GCM_ASM
-#if CAN_USE_GCM_ASM >= 2
 		/* Ignore avx implementation if it won't work. */
-		if (gcm_impl_opts[i].sel == IMPL_AVX2 &&
-		    !gcm_avx2_will_work()) {
-			continue;
-		}
-#endif
-		if (gcm_impl_opts[i].sel == IMPL_AVX && !gcm_avx_will_work()) {
+		if (!gcm_impl_opt_will_work(gcm_impl_opts[i].sel)) {
 			continue;
 		}
 #endif
@@ -919,14 +955,17 @@ gcm_impl_set(const char *val)
 	 * Use the avx implementation if available and the requested one is
 	 * avx or fastest.
 	 */
+	if (impl == IMPL_FASTEST) {
+		gcm_use_impl(gcm_fastest_avx_impl);
+#if CAN_USE_GCM_ASM >= 3
+	} else if (impl == IMPL_AVX512) {
+		gcm_use_impl(GCM_IMPL_AVX512);
+#endif
 #if CAN_USE_GCM_ASM >= 2
-	if (gcm_avx2_will_work() == B_TRUE &&
-	    (impl == IMPL_AVX2 || impl == IMPL_FASTEST)) {
+	} else if (impl == IMPL_AVX2) {
 		gcm_use_impl(GCM_IMPL_AVX2);
-	} else
 #endif
-	if (gcm_avx_will_work() == B_TRUE &&
-	    (impl == IMPL_AVX || impl == IMPL_FASTEST)) {
+	} else if (impl == IMPL_AVX) {
 		gcm_use_impl(GCM_IMPL_AVX);
 	} else {
 		gcm_use_impl(GCM_IMPL_GENERIC);
@@ -962,13 +1001,7 @@ icp_gcm_impl_get(char *buffer, zfs_kernel_param_t *kp)
 	for (i = 0; i < ARRAY_SIZE(gcm_impl_opts); i++) {
 #ifdef CAN_USE_GCM_ASM
 		/* Ignore avx implementation if it won't work. */
-#if CAN_USE_GCM_ASM >= 2
-		if (gcm_impl_opts[i].sel == IMPL_AVX2 &&
-		    !gcm_avx2_will_work()) {
-			continue;
-		}
-#endif
-		if (gcm_impl_opts[i].sel == IMPL_AVX && !gcm_avx_will_work()) {
+		if (!gcm_impl_opt_will_work(gcm_impl_opts[i].sel)) {
 			continue;
 		}
 #endif
@@ -1041,15 +1074,29 @@ extern void ASMABI gcm_init_htab_avx(uint64_t *Htable, const uint64_t H[2]);
 extern void ASMABI gcm_init_vpclmulqdq_avx2(uint128_t Htable[16],
     const uint64_t H[2]);
 #endif
+#if CAN_USE_GCM_ASM >= 3
+extern void ASMABI gcm_init_vpclmulqdq_avx512(uint128_t Htable[16],
+    const uint64_t H[2]);
+#endif
 extern void ASMABI gcm_ghash_avx(uint64_t ghash[2], const uint64_t *Htable,
     const uint8_t *in, size_t len);
 #if CAN_USE_GCM_ASM >= 2
 extern void ASMABI gcm_ghash_vpclmulqdq_avx2(uint64_t ghash[2],
     const uint64_t *Htable, const uint8_t *in, size_t len);
 #endif
+#if CAN_USE_GCM_ASM >= 3
+extern void ASMABI gcm_ghash_vpclmulqdq_avx512(uint64_t ghash[2],
+    const uint64_t *Htable, const uint8_t *in, size_t len);
+#endif
 static inline void GHASH_AVX(gcm_ctx_t *ctx, const uint8_t *in, size_t len)
 {
 	switch (ctx->impl) {
+#if CAN_USE_GCM_ASM >= 3
+		case GCM_IMPL_AVX512:
+			gcm_ghash_vpclmulqdq_avx512(ctx->gcm_ghash,
+			    (const uint64_t *)ctx->gcm_Htable, in, len);
+			break;
+#endif
 #if CAN_USE_GCM_ASM >= 2
 		case GCM_IMPL_AVX2:
 			gcm_ghash_vpclmulqdq_avx2(ctx->gcm_ghash,
@@ -1076,6 +1123,11 @@ extern void ASMABI aes_gcm_enc_update_vaes_avx2(const uint8_t *in,
     uint8_t *out, size_t len, const void *key, const uint8_t ivec[16],
     const uint128_t Htable[16], uint8_t Xi[16]);
 #endif
+#if CAN_USE_GCM_ASM >= 3
+extern void ASMABI aes_gcm_enc_update_vaes_avx512(const uint8_t *in,
+    uint8_t *out, size_t len, const void *key, const uint8_t ivec[16],
+    const uint128_t Htable[16], uint8_t Xi[16]);
+#endif
 
 typedef size_t ASMABI aesni_gcm_decrypt_impl(const uint8_t *, uint8_t *,
     size_t, const void *, uint64_t *, const uint64_t *Htable, uint64_t *);
@@ -1086,6 +1138,20 @@ extern void ASMABI aes_gcm_dec_update_vaes_avx2(const uint8_t *in,
     uint8_t *out, size_t len, const void *key, const uint8_t ivec[16],
     const uint128_t Htable[16], uint8_t Xi[16]);
 #endif
+#if CAN_USE_GCM_ASM >= 3
+extern void ASMABI aes_gcm_dec_update_vaes_avx512(const uint8_t *in,
+    uint8_t *out, size_t len, const void *key, const uint8_t ivec[16],
+    const uint128_t Htable[16], uint8_t Xi[16]);
+#endif
+
+static inline boolean_t
+gcm_avx512_will_work(void)
+{
+	return (kfpu_allowed() &&
+	    zfs_avx512f_available() && zfs_avx512bw_available() &&
+	    zfs_avx512vl_available() && zfs_vaes_available() &&
+	    zfs_vpclmulqdq_available());
+}
 
 static inline boolean_t
 gcm_avx2_will_work(void)
@@ -1108,6 +1174,15 @@ static inline void
 gcm_use_impl(gcm_impl impl)
 {
 	switch (impl) {
+#if CAN_USE_GCM_ASM >= 3
+		case GCM_IMPL_AVX512:
+			if (gcm_avx512_will_work() == B_TRUE) {
+				atomic_swap_32(&gcm_impl_used, impl);
+				return;
+			}
+
+			zfs_fallthrough;
+#endif
 #if CAN_USE_GCM_ASM >= 2
 		case GCM_IMPL_AVX2:
 			if (gcm_avx2_will_work() == B_TRUE) {
@@ -1135,6 +1210,10 @@ static inline boolean_t
 gcm_impl_will_work(gcm_impl impl)
 {
 	switch (impl) {
+#if CAN_USE_GCM_ASM >= 3
+		case GCM_IMPL_AVX512:
+			return (gcm_avx512_will_work());
+#endif
 #if CAN_USE_GCM_ASM >= 2
 		case GCM_IMPL_AVX2:
 			return (gcm_avx2_will_work());
@@ -1225,6 +1304,38 @@ static size_t aesni_gcm_encrypt_avx2(const uint8_t *in, uint8_t *out,
 }
 #endif /* if CAN_USE_GCM_ASM >= 2 */
 
+#if CAN_USE_GCM_ASM >= 3
+static size_t aesni_gcm_encrypt_avx512(const uint8_t *in, uint8_t *out,
+    size_t len, const void *key, uint64_t *iv, const uint64_t *Htable,
+    uint64_t *Xip)
+{
+	uint8_t *ivec = (uint8_t *)iv;
+	len &= kSizeTWithoutLower4Bits;
+	aes_gcm_enc_update_vaes_avx512(in, out, len, key, ivec,
+	    (const uint128_t *)Htable, (uint8_t *)Xip);
+	CRYPTO_store_u32_be(&ivec[12],
+	    CRYPTO_load_u32_be(&ivec[12]) + len / 16);
+	return (len);
+}
+#endif /* if CAN_USE_GCM_ASM >= 3 */
+
+static inline aesni_gcm_encrypt_impl *
+gcm_encrypt_blocks_avx(gcm_impl impl)
+{
+	switch (impl) {
+#if CAN_USE_GCM_ASM >= 3
+		case GCM_IMPL_AVX512:
+			return (aesni_gcm_encrypt_avx512);
+#endif
+#if CAN_USE_GCM_ASM >= 2
+		case GCM_IMPL_AVX2:
+			return (aesni_gcm_encrypt_avx2);
+#endif
+		default:
+			return (aesni_gcm_encrypt_avx);
+	}
+}
+
 /*
  * Encrypt multiple blocks of data in GCM mode.
  * This is done in gcm_avx_chunk_size chunks, utilizing AVX assembler routines
@@ -1240,11 +1351,7 @@ gcm_mode_encrypt_contiguous_blocks_avx(gcm_ctx_t *ctx, char *data,
 	uint8_t *datap = (uint8_t *)data;
 	size_t chunk_size = (size_t)GCM_CHUNK_SIZE_READ;
 	aesni_gcm_encrypt_impl *encrypt_blocks =
-#if CAN_USE_GCM_ASM >= 2
-	    ctx->impl == GCM_IMPL_AVX2 ?
-	    aesni_gcm_encrypt_avx2 :
-#endif
-	    aesni_gcm_encrypt_avx;
+	    gcm_encrypt_blocks_avx(ctx->impl);
 	const aes_key_t *key = ((aes_key_t *)ctx->gcm_keysched);
 	uint64_t *ghash = ctx->gcm_ghash;
 	uint64_t *htable = ctx->gcm_Htable;
@@ -1472,6 +1579,21 @@ static size_t aesni_gcm_decrypt_avx2(const uint8_t *in, uint8_t *out,
 }
 #endif /* if CAN_USE_GCM_ASM >= 2 */
 
+#if CAN_USE_GCM_ASM >= 3
+static size_t aesni_gcm_decrypt_avx512(const uint8_t *in, uint8_t *out,
+    size_t len, const void *key, uint64_t *iv, const uint64_t *Htable,
+    uint64_t *Xip)
+{
+	uint8_t *ivec = (uint8_t *)iv;
+	len &= kSizeTWithoutLower4Bits;
+	aes_gcm_dec_update_vaes_avx512(in, out, len, key, ivec,
+	    (const uint128_t *)Htable, (uint8_t *)Xip);
+	CRYPTO_store_u32_be(&ivec[12],
+	    CRYPTO_load_u32_be(&ivec[12]) + len / 16);
+	return (len);
+}
+#endif /* if CAN_USE_GCM_ASM >= 3 */
+
 /*
  * Finalize decryption: We just have accumulated crypto text, so now we
  * decrypt it here inplace.
@@ -1486,6 +1608,10 @@ gcm_decrypt_final_avx(gcm_ctx_t *ctx, crypto_data_t *out, size_t block_size)
 
 	size_t chunk_size = (size_t)GCM_CHUNK_SIZE_READ;
 	aesni_gcm_decrypt_impl *decrypt_blocks =
+#if CAN_USE_GCM_ASM >= 3
+	    ctx->impl == GCM_IMPL_AVX512 ?
+	    aesni_gcm_decrypt_avx512 :
+#endif
 #if CAN_USE_GCM_ASM >= 2
 	    ctx->impl == GCM_IMPL_AVX2 ?
 	    aesni_gcm_decrypt_avx2 :
@@ -1590,6 +1716,52 @@ gcm_decrypt_final_avx(gcm_ctx_t *ctx, crypto_data_t *out, size_t block_size)
 	return (CRYPTO_SUCCESS);
 }
 
+/* Size of the Htable of the avx implementation impl. */
+static inline size_t
+gcm_htab_len_avx(gcm_impl impl)
+{
+	switch (impl) {
+#if CAN_USE_GCM_ASM >= 3
+		case GCM_IMPL_AVX512:
+			/* H^16 ... H^1 */
+			return (16 * sizeof (uint128_t));
+#endif
+#if CAN_USE_GCM_ASM >= 2
+		case GCM_IMPL_AVX2:
+			/*
+			 * BoringSSL's API specifies uint128_t[16] for htab;
+			 * but only uint128_t[12] are used.
+			 * See https://github.com/google/boringssl/blob/
+			 * 813840dd094f9e9c1b00a7368aa25e656554221f1/crypto/
+			 * fipsmodule/modes/asm/aes-gcm-avx2-x86_64.pl#L198-L200
+			 */
+			return (2 * 8 * sizeof (uint128_t));
+#endif
+		default:
+			return (2 * 6 * sizeof (uint128_t));
+	}
+}
+
+/* Compute the Htable of the avx implementation impl from H. Needs the FPU. */
+static inline void
+gcm_init_htable_avx(gcm_impl impl, uint64_t *Htable, const uint64_t H[2])
+{
+	switch (impl) {
+#if CAN_USE_GCM_ASM >= 3
+		case GCM_IMPL_AVX512:
+			gcm_init_vpclmulqdq_avx512((uint128_t *)Htable, H);
+			break;
+#endif
+#if CAN_USE_GCM_ASM >= 2
+		case GCM_IMPL_AVX2:
+			gcm_init_vpclmulqdq_avx2((uint128_t *)Htable, H);
+			break;
+#endif
+		default:
+			gcm_init_htab_avx(Htable, H);
+	}
+}
+
 /*
  * Initialize the GCM params H, Htabtle and the counter block. Save the
  * initial counter block.
@@ -1610,24 +1782,8 @@ gcm_init_avx(gcm_ctx_t *ctx, const uint8_t *iv, size_t iv_len,
 	ASSERT3S(((aes_key_t *)ctx->gcm_keysched)->ops->needs_byteswap, ==,
 	    B_FALSE);
 
-	size_t htab_len = 0;
-#if CAN_USE_GCM_ASM >= 2
-	if (ctx->impl == GCM_IMPL_AVX2) {
-		/*
-		 * BoringSSL's API specifies uint128_t[16] for htab; but only
-		 * uint128_t[12] are used.
-		 * See https://github.com/google/boringssl/blob/
-		 * 813840dd094f9e9c1b00a7368aa25e656554221f1/crypto/fipsmodule/
-		 * modes/asm/aes-gcm-avx2-x86_64.pl#L198-L200
-		 */
-		htab_len = (2 * 8 * sizeof (uint128_t));
-	} else
-#endif /* CAN_USE_GCM_ASM >= 2 */
-	{
-		htab_len = (2 * 6 * sizeof (uint128_t));
-	}
-
-	ctx->gcm_Htable = kmem_alloc(htab_len, KM_SLEEP);
+	ctx->gcm_htab_len = gcm_htab_len_avx(ctx->impl);
+	ctx->gcm_Htable = kmem_alloc(ctx->gcm_htab_len, KM_SLEEP);
 	if (ctx->gcm_Htable == NULL) {
 		return (CRYPTO_HOST_MEMORY);
 	}
@@ -1638,14 +1794,7 @@ gcm_init_avx(gcm_ctx_t *ctx, const uint8_t *iv, size_t iv_len,
 	aes_encrypt_intel(keysched, aes_rounds,
 	    (const uint32_t *)H, (uint32_t *)H);
 
-#if CAN_USE_GCM_ASM >= 2
-	if (ctx->impl == GCM_IMPL_AVX2) {
-		gcm_init_vpclmulqdq_avx2((uint128_t *)ctx->gcm_Htable, H);
-	} else
-#endif /* if CAN_USE_GCM_ASM >= 2 */
-	{
-		gcm_init_htab_avx(ctx->gcm_Htable, H);
-	}
+	gcm_init_htable_avx(ctx->impl, ctx->gcm_Htable, H);
 
 	if (iv_len == 12) {
 		memcpy(cb, iv, 12);
@@ -1704,6 +1853,202 @@ gcm_init_avx(gcm_ctx_t *ctx, const uint8_t *iv, size_t iv_len,
 	return (CRYPTO_SUCCESS);
 }
 
+/*
+ * Throughput of the avx implementations, measured by gcm_benchmark() on
+ * module load and reported by the gcm_bench kstat in MiB/s.  The "fastest"
+ * implementation is the one with the best 16k result, the size closest to
+ * the chunks the bulk encryption routines are handed.
+ */
+typedef struct {
+	const char *name;
+	gcm_impl impl;
+	uint64_t bs1k;
+	uint64_t bs4k;
+	uint64_t bs16k;
+	uint64_t bs64k;
+} gcm_bench_stat_t;
+
+#define	GCM_BENCH_MAX_SIZE	(64 * 1024)
+
+static gcm_bench_stat_t gcm_bench_stat[GCM_IMPL_MAX];
+static int gcm_bench_cnt = 0;
+static kstat_t *gcm_bench_kstat = NULL;
+
+static int
+gcm_bench_kstat_headers(char *buf, size_t size)
+{
+	ssize_t off = 0;
+
+	off += kmem_scnprintf(buf + off, size, "%-16s", "implementation");
+	off += kmem_scnprintf(buf + off, size - off, "%8s", "1k");
+	off += kmem_scnprintf(buf + off, size - off, "%8s", "4k");
+	off += kmem_scnprintf(buf + off, size - off, "%8s", "16k");
+	(void) kmem_scnprintf(buf + off, size - off, "%8s\n", "64k");
+
+	return (0);
+}
+
+static int
+gcm_bench_kstat_data(char *buf, size_t size, void *data)
+{
+	gcm_bench_stat_t *gs = (gcm_bench_stat_t *)data;
+	ssize_t off = 0;
+
+	off += kmem_scnprintf(buf + off, size - off, "%-16s", gs->name);
+	off += kmem_scnprintf(buf + off, size - off, "%8llu",
+	    (u_longlong_t)gs->bs1k);
+	off += kmem_scnprintf(buf + off, size - off, "%8llu",
+	    (u_longlong_t)gs->bs4k);
+	off += kmem_scnprintf(buf + off, size - off, "%8llu",
+	    (u_longlong_t)gs->bs16k);
+	(void) kmem_scnprintf(buf + off, size - off, "%8llu\n",
+	    (u_longlong_t)gs->bs64k);
+
+	return (0);
+}
+
+static void *
+gcm_bench_kstat_addr(kstat_t *ksp, loff_t n)
+{
+	if (n < gcm_bench_cnt)
+		ksp->ks_private = (void *)(gcm_bench_stat + n);
+	else
+		ksp->ks_private = NULL;
+
+	return (ksp->ks_private);
+}
+
+/*
+ * Encrypt size bytes with the bulk routine of impl for at least a
+ * millisecond, taking the FPU per call like the real code path does, and
+ * return the throughput in MiB/s.  The avx routine finds the Htable through
+ * the context, so ctx is set up as gcm_init_avx() would.
+ */
+static uint64_t
+gcm_bench_run(gcm_ctx_t *ctx, gcm_impl impl, const uint8_t *pt, uint8_t *ct,
+    size_t size)
+{
+	aesni_gcm_encrypt_impl *encrypt_blocks = gcm_encrypt_blocks_avx(impl);
+	const aes_key_t *key = (aes_key_t *)ctx->gcm_keysched;
+	uint64_t htable[2 * 16] = { 0 };
+	uint64_t run_bw, run_time_ns, bytes = 0;
+	uint32_t l, loops = (uint32_t)(GCM_BENCH_MAX_SIZE / size);
+	hrtime_t start;
+
+	ASSERT3U(gcm_htab_len_avx(impl), <=, sizeof (htable));
+
+	ctx->impl = impl;
+	ctx->gcm_Htable = htable;
+	kfpu_begin();
+	gcm_init_htable_avx(impl, htable, ctx->gcm_H);
+	clear_fpu_regs();
+	kfpu_end();
+
+	kpreempt_disable();
+	start = gethrtime();
+	do {
+		for (l = 0; l < loops; l++) {
+			kfpu_begin();
+			bytes += encrypt_blocks(pt, ct, size, key, ctx->gcm_cb,
+			    htable, ctx->gcm_ghash);
+			clear_fpu_regs();
+			kfpu_end();
+		}
+
+		run_time_ns = gethrtime() - start;
+	} while (run_time_ns < MSEC2NSEC(1));
+	kpreempt_enable();
+
+	ctx->gcm_Htable = NULL;
+
+	run_bw = bytes * NANOSEC;
+	run_bw /= run_time_ns; /* B/s */
+	return (run_bw / 1024 / 1024); /* MiB/s */
+}
+
+/*
+ * Measure the avx implementations which will work on this machine, make
+ * the fastest one what "fastest" selects and install the gcm_bench kstat.
+ * Wider vectors don't pay off everywhere, e.g. where AVX-512 lowers the
+ * clock, so this is measured rather than assumed.
+ */
+static void
+gcm_benchmark(void)
+{
+	static const gcm_bench_stat_t candidates[] = {
+		{ "avx",		GCM_IMPL_AVX },
+#if CAN_USE_GCM_ASM >= 2
+		{ "avx2-vaes",		GCM_IMPL_AVX2 },
+#endif
+#if CAN_USE_GCM_ASM >= 3
+		{ "avx512-vaes",	GCM_IMPL_AVX512 },
+#endif
+	};
+	static const uint8_t key_bytes[32] = { 0 };
+	gcm_bench_stat_t *gs;
+	gcm_ctx_t *ctx;
+	aes_key_t *key;
+	uint8_t *pt, *ct;
+	uint64_t max = 0;
+	size_t key_size;
+	int i;
+
+	key = aes_alloc_keysched(&key_size, KM_SLEEP);
+	aes_init_keysched(key_bytes, 256, key);
+	/* The avx code can't use key schedules which need byte swapping. */
+	if (key->ops->needs_byteswap) {
+		kmem_free(key, key_size);
+		return;
+	}
+
+	/* Any H will do for timing. */
+	ctx = kmem_zalloc(sizeof (gcm_ctx_t), KM_SLEEP);
+	ctx->gcm_keysched = key;
+	ctx->gcm_H[0] = 0x66e94bd4ef8a2c3bULL;
+	ctx->gcm_H[1] = 0x884cfa59ca342b2eULL;
+
+	pt = vmem_zalloc(GCM_BENCH_MAX_SIZE, KM_SLEEP);
+	ct = vmem_alloc(GCM_BENCH_MAX_SIZE, KM_SLEEP);
+
+	gcm_bench_cnt = 0;
+	for (i = 0; i < ARRAY_SIZE(candidates); i++) {
+		if (!gcm_impl_will_work(candidates[i].impl))
+			continue;
+
+		gs = &gcm_bench_stat[gcm_bench_cnt++];
+		*gs = candidates[i];
+		gs->bs1k = gcm_bench_run(ctx, gs->impl, pt, ct, 1 << 10);
+		gs->bs4k = gcm_bench_run(ctx, gs->impl, pt, ct, 1 << 12);
+		gs->bs16k = gcm_bench_run(ctx, gs->impl, pt, ct, 1 << 14);
+		gs->bs64k = gcm_bench_run(ctx, gs->impl, pt, ct, 1 << 16);
+		if (gs->bs16k > max) {
+			max = gs->bs16k;
+			gcm_fastest_avx_impl = gs->impl;
+		}
+	}
+
+	vmem_free(ct, GCM_BENCH_MAX_SIZE);
+	vmem_free(pt, GCM_BENCH_MAX_SIZE);
+	kmem_free(ctx, sizeof (gcm_ctx_t));
+	kmem_free(key, key_size);
+
+	if (gcm_bench_kstat != NULL || gcm_bench_cnt == 0)
+		return;
+
+	gcm_bench_kstat = kstat_create("zfs", 0, "gcm_bench", "misc",
+	    KSTAT_TYPE_RAW, 0, KSTAT_FLAG_VIRTUAL);
+
+	if (gcm_bench_kstat != NULL) {
+		gcm_bench_kstat->ks_data = NULL;
+		gcm_bench_kstat->ks_ndata = UINT32_MAX;
+		kstat_set_raw_ops(gcm_bench_kstat,
+		    gcm_bench_kstat_headers,
+		    gcm_bench_kstat_data,
+		    gcm_bench_kstat_addr);
+		kstat_install(gcm_bench_kstat);
+	}
+}
+
 #if defined(_KERNEL)
 static int
 icp_gcm_avx_set_chunk_size(const char *buf, zfs_kernel_param_t *kp)
@@ -1734,3 +2079,17 @@ MODULE_PARM_DESC(icp_gcm_avx_chunk_size,
 
 #endif /* defined(__KERNEL) */
 #endif /* ifdef CAN_USE_GCM_ASM */
+
+/*
+ * Tear down what gcm_impl_init() set up.
+ */
+void
+gcm_impl_fini(void)
+{
+#ifdef CAN_USE_GCM_ASM
+	if (gcm_bench_kstat != NULL) {
+		kstat_delete(gcm_bench_kstat);
+		gcm_bench_kstat = NULL;
+	}
+#endif
+}
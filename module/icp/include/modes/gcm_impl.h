@@ -64,6 +64,11 @@ extern const gcm_impl_ops_t gcm_pclmulqdq_impl;
  */
 void gcm_impl_init(void);
 
+/*
+ * Releases what gcm_impl_init() set up
+ */
+void gcm_impl_fini(void);
+
 /*
  * Returns optimal allowed GCM implementation
  */
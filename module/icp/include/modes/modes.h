@@ -38,11 +38,17 @@ extern "C" {
 /*
  * Does the build chain support all instructions needed for the GCM assembler
  * routines. AVX support should imply AES-NI and PCLMULQDQ, but make sure
- * anyhow.
+ * anyhow.  CAN_USE_GCM_ASM is 2 if the AVX2 VAES routines can be built too,
+ * and 3 if the AVX-512 VAES routines can also be built.
  */
 #if defined(__x86_64__) && defined(HAVE_AVX) && \
     defined(HAVE_AES) && defined(HAVE_PCLMULQDQ)
+#if defined(HAVE_VAES) && defined(HAVE_VPCLMULQDQ) && \
+    defined(HAVE_AVX512F) && defined(HAVE_AVX512BW) && defined(HAVE_AVX512VL)
+#define	CAN_USE_GCM_ASM 3
+#else
 #define	CAN_USE_GCM_ASM (HAVE_VAES && HAVE_VPCLMULQDQ ? 2 : 1)
+#endif
 extern boolean_t gcm_avx_can_use_movbe;
 #endif
 
@@ -134,6 +140,7 @@ typedef enum gcm_impl {
 	GCM_IMPL_GENERIC = 0,
 	GCM_IMPL_AVX,
 	GCM_IMPL_AVX2,
+	GCM_IMPL_AVX512,
 	GCM_IMPL_MAX,
 } gcm_impl;
 #endif
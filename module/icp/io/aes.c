@@ -112,6 +112,8 @@ aes_mod_fini(void)
 		aes_prov_handle = 0;
 	}
 
+	gcm_impl_fini();
+
 	return (0);
 }
 
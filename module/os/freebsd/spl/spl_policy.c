@@ -66,6 +66,13 @@ secpolicy_zinject(cred_t *cr)
 	return (priv_check_cred(cr, PRIV_ZFS_INJECT));
 }
 
+int
+secpolicy_fhopen(cred_t *cr)
+{
+
+	return (priv_check_cred(cr, PRIV_VFS_FHOPEN));
+}
+
 int
 secpolicy_fs_unmount(cred_t *cr, struct mount *vfsp __unused)
 {
@@ -407,6 +407,17 @@ zfs_ioctl(vnode_t *vp, ulong_t com, intptr_t data, int flag, cred_t *cred,
 		VOP_UNLOCK(vp);
 		return (error);
 	}
+	case ZFS_IOC_PREFETCH: {
+		zfs_prefetch_args_t *args = (zfs_prefetch_args_t *)data;
+		if ((flag & FREAD) == 0)
+			return (SET_ERROR(EBADF));
+		error = vn_lock(vp, LK_SHARED);
+		if (error)
+			return (error);
+		error = zfs_prefetch_ranges(VTOZ(vp), args, 0, cred);
+		VOP_UNLOCK(vp);
+		return (error);
+	}
 	}
 	return (SET_ERROR(ENOTTY));
 }
@@ -216,6 +216,13 @@ arc_shrinker_scan(struct shrinker *shrink, struct shrink_control *sc)
 	 */
 	arc_no_grow = B_TRUE;
 
+	/*
+	 * Reclaim runs on the node which is short of memory, either in its
+	 * kswapd thread or in the allocating task.  Ask the eviction code to
+	 * start with the sublists holding buffers allocated on that node.
+	 */
+	arc_evict_numa_hint(numa_node_id());
+
 	/*
 	 * Evict the requested number of pages by reducing arc_c and waiting
 	 * for the requested amount of data to be evicted.  To avoid deadlock
@@ -456,6 +463,22 @@ arc_unregister_hotplug(void)
 #endif
 }
 
+/*
+ * The kernel allocators back ABD pages and zio buffers with memory from
+ * the node of the allocating CPU, so that is the node a new buffer lives on.
+ */
+uint_t
+arc_numa_node(void)
+{
+	return (numa_node_id());
+}
+
+uint_t
+arc_numa_node_count(void)
+{
+	return (nr_node_ids);
+}
+
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, shrinker_limit, INT, ZMOD_RW,
 	"Limit on number of pages that ARC shrinker can reclaim at once");
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, shrinker_seeks, INT, ZMOD_RD,
@@ -147,6 +147,17 @@ secpolicy_vnode_any_access(const cred_t *cr, struct inode *ip, uid_t owner)
 	return (EPERM);
 }
 
+/*
+ * Determine if the subject can look up files by object number rather than
+ * by path, bypassing the search permission of the directories leading to
+ * them.  Equivalent to what open_by_handle_at(2) requires.
+ */
+int
+secpolicy_fhopen(const cred_t *cr)
+{
+	return (priv_policy_ns(cr, CAP_DAC_READ_SEARCH, EPERM, NULL));
+}
+
 /*
  * Determine if subject can chown owner of a file.
  */
@@ -710,11 +710,17 @@ zpl_fadvise(struct file *filp, loff_t offset, loff_t len, int advice)
 			error = generic_fadvise(filp, offset, len, advice);
 #endif
 		/*
-		 * Pass on the caller's size directly, but note that
-		 * dmu_prefetch_max will effectively cap it.  If there
-		 * really is a larger sequential access pattern, perhaps
-		 * dmu_zfetch will detect it.
+		 * A sequential hint passes on the caller's size directly,
+		 * but note that dmu_prefetch_max will effectively cap it.
+		 * If there really is a larger sequential access pattern,
+		 * perhaps dmu_zfetch will detect it.  An explicit request
+		 * for the range is honored up to zfs_prefetch_hint_max.
 		 */
+		if (advice == POSIX_FADV_WILLNEED) {
+			(void) zfs_prefetch(zp, offset, len,
+			    zfs_prefetch_hint_max);
+			break;
+		}
 		if (len == 0)
 			len = i_size_read(ip) - offset;
 
@@ -1017,6 +1023,30 @@ zpl_ioctl_rewrite(struct file *filp, void __user *arg)
 	return (err);
 }
 
+static int
+zpl_ioctl_prefetch(struct file *filp, void __user *arg)
+{
+	struct inode *ip = file_inode(filp);
+	zfs_prefetch_args_t args;
+	fstrans_cookie_t cookie;
+	cred_t *cr = CRED();
+	int err;
+
+	if (copy_from_user(&args, arg, sizeof (args)))
+		return (-EFAULT);
+
+	if (unlikely(!(filp->f_mode & FMODE_READ)))
+		return (-EBADF);
+
+	crhold(cr);
+	cookie = spl_fstrans_mark();
+	err = -zfs_prefetch_ranges(ITOZ(ip), &args, 0, cr);
+	spl_fstrans_unmark(cookie);
+	crfree(cr);
+
+	return (err);
+}
+
 static long
 zpl_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
@@ -1037,6 +1067,8 @@ zpl_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		return (zpl_ioctl_setdosflags(filp, (void *)arg));
 	case ZFS_IOC_REWRITE:
 		return (zpl_ioctl_rewrite(filp, (void *)arg));
+	case ZFS_IOC_PREFETCH:
+		return (zpl_ioctl_prefetch(filp, (void *)arg));
 	default:
 		return (-ENOTTY);
 	}
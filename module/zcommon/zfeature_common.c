@@ -810,6 +810,25 @@ zpool_feature_init(void)
 		    ZFEATURE_TYPE_BOOLEAN, physical_rewrite_deps, sfeatures);
 	}
 
+	{
+		static const spa_feature_t compress_adaptive_deps[] = {
+			SPA_FEATURE_EXTENSIBLE_DATASET,
+			SPA_FEATURE_ZSTD_COMPRESS,
+			SPA_FEATURE_NONE
+		};
+		zfeature_register(SPA_FEATURE_COMPRESS_ADAPTIVE,
+		    "org.openzfs:compress_adaptive", "compress_adaptive",
+		    "Support for compression=adaptive.",
+		    ZFEATURE_FLAG_READONLY_COMPAT | ZFEATURE_FLAG_PER_DATASET,
+		    ZFEATURE_TYPE_BOOLEAN, compress_adaptive_deps, sfeatures);
+	}
+
+	zfeature_register(SPA_FEATURE_ARC_WARM,
+	    "org.openzfs:arc_warm", "arc_warm",
+	    "Support for saving the ARC warm-restart manifest.",
+	    ZFEATURE_FLAG_READONLY_COMPAT, ZFEATURE_TYPE_BOOLEAN, NULL,
+	    sfeatures);
+
 	zfs_mod_list_supported_free(sfeatures);
 }
 
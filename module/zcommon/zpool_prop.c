@@ -476,6 +476,9 @@ vdev_prop_init(void)
 	zprop_register_index(VDEV_PROP_AUTOSIT, "autosit", 0,
 	    PROP_DEFAULT, ZFS_TYPE_VDEV, "on | off", "AUTOSIT", boolean_table,
 	    sfeatures);
+	zprop_register_index(VDEV_PROP_QUEUE_BYPASS, "queue_bypass", 0,
+	    PROP_DEFAULT, ZFS_TYPE_VDEV, "on | off", "QBYPASS", boolean_table,
+	    sfeatures);
 
 	/* default index properties */
 	zprop_register_index(VDEV_PROP_FAILFAST, "failfast", B_TRUE,
@@ -98,7 +98,12 @@
  *
  * buf_hash_find() returns the appropriate mutex (held) when it
  * locates the requested buffer in the hash table.  It returns
- * NULL for the mutex if the buffer was not in the table.
+ * NULL for the mutex if the buffer was not in the table.  Lookups
+ * which hash to an empty bucket return without taking the mutex.
+ * Hits always take it: the caller goes on to update the header's ARC
+ * state and attach a buffer to it, both of which the mutex protects, so
+ * walking the chain without it (e.g. under an epoch like dbuf_find())
+ * would only move the lock acquisition, not remove it.
  *
  * buf_hash_remove() expects the appropriate hash mutex to be
  * already held before it is invoked.
@@ -470,6 +475,12 @@ static uint_t zfs_arc_lotsfree_percent = 10;
  */
 static int zfs_arc_prune_task_threads = 1;
 
+/*
+ * Minimum recent access count for a data block read from disk to be
+ * admitted into the ARC, or 0 to admit everything.  See arc_admit().
+ */
+uint_t zfs_arc_admit_threshold = 0;
+
 /* Used by spa_export/spa_destroy to flush the arc asynchronously */
 static taskq_t *arc_flush_taskq;
 
@@ -485,6 +496,56 @@ static taskq_t *arc_flush_taskq;
  */
 static uint_t zfs_arc_evict_threads = 0;
 
+/*
+ * Partition the sublists of each ARC state between the NUMA nodes, so that
+ * reclaim on a node which is short of memory evicts buffers allocated on
+ * that node first.  See arc_state_multilist_index_func().
+ */
+static int zfs_arc_numa = 1;
+
+/*
+ * Number of nodes the sublists are partitioned between, and the node
+ * (or -1 for none) whose sublists the next eviction pass starts with.
+ */
+static uint_t arc_numa_nodes = 1;
+static int arc_evict_numa_node = -1;
+
+/*
+ * Per-node statistics, exported through the "arcstats_numa" kstat.
+ */
+typedef enum arc_numa_stat {
+	ARC_NUMA_HITS_LOCAL,
+	ARC_NUMA_HITS_REMOTE,
+	ARC_NUMA_EVICT_BYTES,
+	ARC_NUMA_RECLAIMS,
+	ARC_NUMA_NSTATS
+} arc_numa_stat_t;
+
+static const char *const arc_numa_stat_names[ARC_NUMA_NSTATS] = {
+	"hits_local",
+	"hits_remote",
+	"evict_bytes",
+	"reclaims",
+};
+
+static wmsum_t *arc_numa_sums;
+static kstat_t *arc_numa_ksp;
+
+#define	ARC_NUMA_SUM(node, stat)	\
+	(&arc_numa_sums[(node) * ARC_NUMA_NSTATS + (stat)])
+
+/*
+ * Return the node whose memory new ARC buffers are allocated from, folded
+ * into the range of nodes the sublists are partitioned between.
+ */
+static inline uint_t
+arc_numa_node_current(void)
+{
+	if (arc_numa_nodes < 2)
+		return (0);
+	return (arc_numa_node() % arc_numa_nodes);
+}
+
 /* The 7 states: */
 static arc_state_t ARC_anon;
 /*  */ arc_state_t ARC_mru;
@@ -515,6 +576,8 @@ arc_stats_t arc_stats = {
 	{ "mfu_hits",			KSTAT_DATA_UINT64 },
 	{ "mfu_ghost_hits",		KSTAT_DATA_UINT64 },
 	{ "uncached_hits",		KSTAT_DATA_UINT64 },
+	{ "admit_filter_admitted",	KSTAT_DATA_UINT64 },
+	{ "admit_filter_rejected",	KSTAT_DATA_UINT64 },
 	{ "deleted",			KSTAT_DATA_UINT64 },
 	{ "mutex_miss",			KSTAT_DATA_UINT64 },
 	{ "access_skip",		KSTAT_DATA_UINT64 },
@@ -776,18 +839,29 @@ taskq_t *arc_prune_taskq;
  * Hash table routines
  */
 
-#define	BUF_LOCKS 2048
+/*
+ * The hash lock array is sized from the hash table (one lock per
+ * 2^BUF_LOCKS_SHIFT buckets), clamped between BUF_LOCKS_MIN and
+ * BUF_LOCKS_MAX locks.  Each lock is padded out to its own cache line
+ * so that CPUs hitting unrelated buckets do not bounce a shared line.
+ */
+#define	BUF_LOCKS_SHIFT	10
+#define	BUF_LOCKS_MIN	(1ULL << 11)
+#define	BUF_LOCKS_MAX	(1ULL << 16)
+
 typedef struct buf_hash_table {
 	uint64_t ht_mask;
 	arc_buf_hdr_t **ht_table;
-	kmutex_t ht_locks[BUF_LOCKS] ____cacheline_aligned;
+	uint64_t ht_lock_mask;
+	zfs_padded_mutex_t *ht_locks;
 } buf_hash_table_t;
 
 static buf_hash_table_t buf_hash_table;
 
 #define	BUF_HASH_INDEX(spa, dva, birth) \
 	(buf_hash(spa, dva, birth) & buf_hash_table.ht_mask)
-#define	BUF_HASH_LOCK(idx)	(&buf_hash_table.ht_locks[idx & (BUF_LOCKS-1)])
+#define	BUF_HASH_LOCK(idx)	\
+	(&buf_hash_table.ht_locks[(idx) & buf_hash_table.ht_lock_mask].pm_lock)
 #define	HDR_LOCK(hdr) \
 	(BUF_HASH_LOCK(BUF_HASH_INDEX(hdr->b_spa, &hdr->b_dva, hdr->b_birth)))
 
@@ -1057,6 +1131,19 @@ buf_hash_find(uint64_t spa, const blkptr_t *bp, kmutex_t **lockp)
 	kmutex_t *hash_lock = BUF_HASH_LOCK(idx);
 	arc_buf_hdr_t *hdr;
 
+	/*
+	 * Lookups of uncached blocks (including arc_freed() of blocks that
+	 * were never read) usually land in an empty bucket.  Detect that
+	 * without taking the hash lock so misses do not dirty the lock's
+	 * cache line.  Only the bucket head pointer is read; no header is
+	 * dereferenced.  A racing insert is harmless: callers which go on
+	 * to add a header recheck under the lock in buf_hash_insert().
+	 */
+	if (atomic_load_ptr(&buf_hash_table.ht_table[idx]) == NULL) {
+		*lockp = NULL;
+		return (NULL);
+	}
+
 	mutex_enter(hash_lock);
 	for (hdr = buf_hash_table.ht_table[idx]; hdr != NULL;
 	    hdr = hdr->b_hash_next) {
@@ -1165,8 +1252,10 @@ buf_fini(void)
 	kmem_free(buf_hash_table.ht_table,
 	    (buf_hash_table.ht_mask + 1) * sizeof (void *));
 #endif
-	for (int i = 0; i < BUF_LOCKS; i++)
+	for (uint64_t i = 0; i <= buf_hash_table.ht_lock_mask; i++)
 		mutex_destroy(BUF_HASH_LOCK(i));
+	vmem_free(buf_hash_table.ht_locks,
+	    (buf_hash_table.ht_lock_mask + 1) * sizeof (zfs_padded_mutex_t));
 	kmem_cache_destroy(hdr_full_cache);
 	kmem_cache_destroy(hdr_l2only_cache);
 	kmem_cache_destroy(buf_cache);
@@ -1262,6 +1351,7 @@ buf_init(void)
 {
 	uint64_t *ct = NULL;
 	uint64_t hsize = 1ULL << 12;
+	uint64_t lsize;
 	int i, j;
 
 	/*
@@ -1303,8 +1393,13 @@ retry:
 		for (ct = zfs_crc64_table + i, *ct = i, j = 8; j > 0; j--)
 			*ct = (*ct >> 1) ^ (-(*ct & 1) & ZFS_CRC64_POLY);
 
-	for (i = 0; i < BUF_LOCKS; i++)
-		mutex_init(BUF_HASH_LOCK(i), NULL, MUTEX_DEFAULT, NULL);
+	lsize = MIN(MAX(hsize >> BUF_LOCKS_SHIFT, BUF_LOCKS_MIN),
+	    BUF_LOCKS_MAX);
+	buf_hash_table.ht_lock_mask = lsize - 1;
+	buf_hash_table.ht_locks = vmem_zalloc(lsize *
+	    sizeof (zfs_padded_mutex_t), KM_SLEEP);
+	for (uint64_t l = 0; l < lsize; l++)
+		mutex_init(BUF_HASH_LOCK(l), NULL, MUTEX_DEFAULT, NULL);
 }
 
 #define	ARC_MINTIME	(hz>>4) /* 62 ms */
@@ -3199,6 +3294,15 @@ arc_hdr_alloc_abd(arc_buf_hdr_t *hdr, int alloc_flags)
 	ASSERT(!HDR_SHARED_DATA(hdr) || alloc_rdata);
 	IMPLY(alloc_rdata, HDR_PROTECTED(hdr));
 
+	/*
+	 * The data is allocated on the current node.  A header which is
+	 * still on a state list (e.g. a ghost being read back in) keeps its
+	 * node until it is moved, since the node selects its sublist.
+	 */
+	if (hdr->b_l1hdr.b_pabd == NULL && !HDR_HAS_RABD(hdr) &&
+	    !multilist_link_active(&hdr->b_l1hdr.b_arc_node))
+		hdr->b_l1hdr.b_numa_node = arc_numa_node_current();
+
 	if (alloc_rdata) {
 		size = HDR_GET_PSIZE(hdr);
 		ASSERT0P(hdr->b_crypt_hdr.b_rabd);
@@ -3310,6 +3414,7 @@ arc_hdr_alloc(uint64_t spa, int32_t psize, int32_t lsize,
 	hdr->b_l1hdr.b_mfu_hits = 0;
 	hdr->b_l1hdr.b_mfu_ghost_hits = 0;
 	hdr->b_l1hdr.b_buf = NULL;
+	hdr->b_l1hdr.b_numa_node = arc_numa_node_current();
 
 	ASSERT(zfs_refcount_is_zero(&hdr->b_l1hdr.b_refcnt));
 
@@ -3349,6 +3454,7 @@ arc_hdr_realloc(arc_buf_hdr_t *hdr, kmem_cache_t *old, kmem_cache_t *new)
 		 * l2c_only even though it's about to change.
 		 */
 		nhdr->b_l1hdr.b_state = arc_l2c_only;
+		nhdr->b_l1hdr.b_numa_node = arc_numa_node_current();
 
 		/* Verify previous threads set to NULL before freeing */
 		ASSERT0P(nhdr->b_l1hdr.b_pabd);
@@ -3859,6 +3965,8 @@ arc_evict_hdr(arc_buf_hdr_t *hdr, uint64_t *real_evicted)
 
 	bytes_evicted += arc_hdr_size(hdr);
 	*real_evicted += arc_hdr_size(hdr);
+	wmsum_add(ARC_NUMA_SUM(hdr->b_l1hdr.b_numa_node, ARC_NUMA_EVICT_BYTES),
+	    arc_hdr_size(hdr));
 
 	/*
 	 * If this hdr is being evicted and has a compressed buffer then we
@@ -4113,6 +4221,38 @@ arc_evict_thread_init(void)
 	}
 }
 
+/*
+ * Called by the platform reclaim code with the node which is short of
+ * memory, so that the following eviction starts with the buffers
+ * allocated on that node.
+ */
+void
+arc_evict_numa_hint(uint_t node)
+{
+	if (arc_numa_nodes < 2)
+		return;
+
+	node %= arc_numa_nodes;
+	arc_evict_numa_node = node;
+	wmsum_add(ARC_NUMA_SUM(node, ARC_NUMA_RECLAIMS), 1);
+}
+
+/*
+ * Pick the sublist an eviction pass starts with.  Without a node hint this
+ * is a random sublist, to balance eviction across all sublists.  With one
+ * it is the first sublist of the hinted node, so its buffers go first.
+ */
+static int
+arc_evict_start_index(multilist_t *ml)
+{
+	int node = arc_evict_numa_node;
+
+	if (node < 0 || arc_numa_nodes < 2)
+		return (multilist_get_random_index(ml));
+
+	return (node * multilist_get_num_sublists(ml) / arc_numa_nodes);
+}
+
 /*
  * The minimum number of bytes we can evict at once is a block size.
  * So, SPA_MAXBLOCKSIZE is a reasonable minimal value per an eviction task.
@@ -4197,7 +4337,7 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 	 */
 	uint64_t scan_evicted = 0;
 	int sublists_left = num_sublists;
-	int sublist_idx = multilist_get_random_index(ml);
+	int sublist_idx = arc_evict_start_index(ml);
 
 	/*
 	 * While we haven't hit our target number of bytes to evict, or
@@ -4303,7 +4443,7 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 		 */
 		if (sublists_left == 0) {
 			sublists_left = num_sublists;
-			sublist_idx = multilist_get_random_index(ml);
+			sublist_idx = arc_evict_start_index(ml);
 			scan_evicted = 0;
 
 			/*
@@ -4571,6 +4711,13 @@ arc_evict(void)
 	    gsfm;
 	(void) arc_evict_impl(arc_mfu_ghost, ARC_BUFC_METADATA, e);
 
+	/*
+	 * The node hint only applies to the reclaim which set it.  This may
+	 * race with a new hint being set, in which case that reclaim simply
+	 * gets the default eviction order.
+	 */
+	arc_evict_numa_node = -1;
+
 	return (total_evicted);
 }
 
@@ -5364,6 +5511,12 @@ arc_access(arc_buf_hdr_t *hdr, arc_flags_t arc_flags, boolean_t hit)
 	if (arc_flags & ARC_FLAG_L2CACHE)
 		arc_hdr_set_flags(hdr, ARC_FLAG_L2CACHE);
 
+	if (hit) {
+		uint_t node = arc_numa_node_current();
+		wmsum_add(ARC_NUMA_SUM(node, node == hdr->b_l1hdr.b_numa_node ?
+		    ARC_NUMA_HITS_LOCAL : ARC_NUMA_HITS_REMOTE), 1);
+	}
+
 	clock_t now = ddi_get_lbolt();
 	if (hdr->b_l1hdr.b_state == arc_anon) {
 		arc_state_t	*new_state;
@@ -5828,6 +5981,143 @@ arc_cached(spa_t *spa, const blkptr_t *bp)
 	return (flags);
 }
 
+/*
+ * ARC admission filter
+ *
+ * When zfs_arc_admit_threshold is set, data blocks of primarycache=all
+ * datasets are only admitted into the MRU/MFU states once they have been
+ * accessed at least zfs_arc_admit_threshold times recently.  Blocks which
+ * fail the filter are read with ARC_FLAG_UNCACHED: they are served from
+ * the uncached state and dropped when their last reference goes away,
+ * instead of pushing the existing working set out of the cache.  This
+ * keeps large single pass scans (backups, tar, zfs send of cold data)
+ * from flushing the ARC.
+ *
+ * Recent access frequency is estimated with a count-min sketch of
+ * ARC_ADMIT_DEPTH rows of saturating one byte counters, sized from the
+ * buf hash table.  Every (ARC_ADMIT_WINDOW << arc_admit_shift) recorded
+ * accesses all counters are halved, so old accesses are forgotten.  A
+ * block which still has a header in the ARC, including in the ghost
+ * states, is admitted without consulting the sketch.
+ */
+#define	ARC_ADMIT_DEPTH		4
+#define	ARC_ADMIT_MAX		15
+#define	ARC_ADMIT_MIN_SHIFT	12
+#define	ARC_ADMIT_WINDOW	16
+#define	ARC_ADMIT_SIZE		((uint64_t)ARC_ADMIT_DEPTH << arc_admit_shift)
+
+static uint8_t *arc_admit_sketch;
+static uint_t arc_admit_shift;
+static uint64_t arc_admit_samples;
+
+static void
+arc_admit_init(void)
+{
+	arc_admit_shift = MAX(highbit64(buf_hash_table.ht_mask + 1) - 5,
+	    ARC_ADMIT_MIN_SHIFT);
+	arc_admit_sketch = vmem_zalloc(ARC_ADMIT_SIZE, KM_SLEEP);
+}
+
+static void
+arc_admit_fini(void)
+{
+	vmem_free(arc_admit_sketch, ARC_ADMIT_SIZE);
+	arc_admit_sketch = NULL;
+}
+
+static void
+arc_admit_age(void *arg)
+{
+	(void) arg;
+
+	for (uint64_t i = 0; i < ARC_ADMIT_SIZE; i++)
+		arc_admit_sketch[i] >>= 1;
+}
+
+/*
+ * Record an access of the block with hash value hv in the sketch and
+ * return its estimated recent access count.  The counters are updated
+ * without synchronization; a lost update only makes the estimate a
+ * little lower, which is acceptable for an admission heuristic.
+ */
+static uint_t
+arc_admit_record(uint64_t hv)
+{
+	uint64_t mask = (1ULL << arc_admit_shift) - 1;
+	uint64_t h2 = (hv >> 32) | 1;
+	uint8_t *ctr[ARC_ADMIT_DEPTH];
+	uint_t est = ARC_ADMIT_MAX;
+
+	for (int i = 0; i < ARC_ADMIT_DEPTH; i++) {
+		ctr[i] = &arc_admit_sketch[((uint64_t)i << arc_admit_shift) +
+		    ((hv + i * h2) & mask)];
+		est = MIN(est, *ctr[i]);
+	}
+
+	/* Conservative update: only raise the counters at the minimum. */
+	if (est < ARC_ADMIT_MAX) {
+		for (int i = 0; i < ARC_ADMIT_DEPTH; i++) {
+			if (*ctr[i] == est)
+				*ctr[i] = est + 1;
+		}
+		est++;
+	}
+
+	uint64_t window = (uint64_t)ARC_ADMIT_WINDOW << arc_admit_shift;
+	if ((atomic_inc_64_nv(&arc_admit_samples) & (window - 1)) == 0) {
+		(void) taskq_dispatch(arc_prune_taskq, arc_admit_age, NULL,
+		    TQ_NOSLEEP);
+	}
+
+	return (est);
+}
+
+/*
+ * Decide whether a data block about to be read from disk should be
+ * cached.  Returns B_FALSE when the caller should read it with
+ * ARC_FLAG_UNCACHED.
+ */
+boolean_t
+arc_admit(spa_t *spa, const blkptr_t *bp)
+{
+	uint_t threshold = zfs_arc_admit_threshold;
+	uint64_t guid, size;
+	arc_buf_hdr_t *hdr;
+	kmutex_t *hash_lock;
+
+	if (threshold == 0 || BP_IS_EMBEDDED(bp))
+		return (B_TRUE);
+
+	guid = spa_load_guid(spa);
+	size = BP_GET_LSIZE(bp);
+
+	/*
+	 * Blocks in the uncached state were already turned away (typically
+	 * by a prefetch that is now being demand read) and stay that way.
+	 * Blocks cached or remembered by a ghost list are admitted.
+	 */
+	hdr = buf_hash_find(guid, bp, &hash_lock);
+	if (hdr != NULL) {
+		arc_state_t *state = HDR_HAS_L1HDR(hdr) ?
+		    hdr->b_l1hdr.b_state : arc_l2c_only;
+		mutex_exit(hash_lock);
+		if (state == arc_uncached)
+			return (B_FALSE);
+		if (GHOST_STATE(state))
+			ARCSTAT_INCR(arcstat_admit_filter_admitted, size);
+		return (B_TRUE);
+	}
+
+	if (arc_admit_record(buf_hash(guid, BP_IDENTITY(bp),
+	    BP_GET_PHYSICAL_BIRTH(bp))) >= threshold) {
+		ARCSTAT_INCR(arcstat_admit_filter_admitted, size);
+		return (B_TRUE);
+	}
+
+	ARCSTAT_INCR(arcstat_admit_filter_rejected, size);
+	return (B_FALSE);
+}
+
 /*
  * "Read" the block at the specified DVA (in bp) via the
  * cache.  If the block is found in the cache, invoke the provided
@@ -7280,6 +7570,10 @@ arc_kstat_update(kstat_t *ksp, int rw)
 	    wmsum_value(&arc_sums.arcstat_mfu_ghost_hits);
 	as->arcstat_uncached_hits.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_uncached_hits);
+	as->arcstat_admit_filter_admitted.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_admit_filter_admitted);
+	as->arcstat_admit_filter_rejected.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_admit_filter_rejected);
 	as->arcstat_deleted.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_deleted);
 	as->arcstat_mutex_miss.value.ui64 =
@@ -7493,17 +7787,78 @@ arc_kstat_update(kstat_t *ksp, int rw)
 	return (0);
 }
 
+static int
+arc_numa_kstat_update(kstat_t *ksp, int rw)
+{
+	kstat_named_t *kn = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (SET_ERROR(EACCES));
+
+	for (int i = 0; i < arc_numa_nodes * ARC_NUMA_NSTATS; i++)
+		kn[i].value.ui64 = wmsum_value(&arc_numa_sums[i]);
+
+	return (0);
+}
+
+static void
+arc_numa_kstat_init(void)
+{
+	uint_t n = arc_numa_nodes * ARC_NUMA_NSTATS;
+
+	arc_numa_ksp = kstat_create("zfs", 0, "arcstats_numa", "misc",
+	    KSTAT_TYPE_NAMED, 0, KSTAT_FLAG_VIRTUAL);
+	if (arc_numa_ksp == NULL)
+		return;
+
+	kstat_named_t *kn = kmem_zalloc(sizeof (kstat_named_t) * n, KM_SLEEP);
+	for (uint_t i = 0; i < n; i++) {
+		kn[i].data_type = KSTAT_DATA_UINT64;
+		(void) snprintf(kn[i].name, KSTAT_STRLEN, "node%u_%s",
+		    i / ARC_NUMA_NSTATS,
+		    arc_numa_stat_names[i % ARC_NUMA_NSTATS]);
+	}
+	arc_numa_ksp->ks_data = kn;
+	arc_numa_ksp->ks_ndata = n;
+	arc_numa_ksp->ks_data_size = sizeof (kstat_named_t) * n;
+	arc_numa_ksp->ks_update = arc_numa_kstat_update;
+	kstat_install(arc_numa_ksp);
+}
+
+static void
+arc_numa_kstat_fini(void)
+{
+	if (arc_numa_ksp == NULL)
+		return;
+
+	kstat_named_t *kn = arc_numa_ksp->ks_data;
+
+	kstat_delete(arc_numa_ksp);
+	arc_numa_ksp = NULL;
+	kmem_free(kn, sizeof (kstat_named_t) * arc_numa_nodes *
+	    ARC_NUMA_NSTATS);
+}
+
 /*
  * This function *must* return indices evenly distributed between all
  * sublists of the multilist. This is needed due to how the ARC eviction
  * code is laid out; arc_evict_state() assumes ARC buffers are evenly
  * distributed between all sublists and uses this assumption when
  * deciding which sublist to evict from and how much to evict from it.
+ *
+ * On NUMA systems the sublists are split into arc_numa_nodes contiguous
+ * ranges, one per node, and a header is placed in the range of the node
+ * its data was allocated on.  The distribution is then only even within
+ * each range, which is what lets arc_evict_start_index() evict the buffers
+ * of a single node first.  Since b_numa_node selects the sublist, it must
+ * not change while the header is on a list.
  */
 static unsigned int
 arc_state_multilist_index_func(multilist_t *ml, void *obj)
 {
 	arc_buf_hdr_t *hdr = obj;
+	unsigned int num_sublists = multilist_get_num_sublists(ml);
+	unsigned int hash;
 
 	/*
 	 * We rely on b_dva to generate evenly distributed index
@@ -7525,8 +7880,15 @@ arc_state_multilist_index_func(multilist_t *ml, void *obj)
 	 * would not be evenly distributed. In this context full 64bit
 	 * division would be a waste of time, so limit it to 32 bits.
 	 */
-	return ((unsigned int)buf_hash(hdr->b_spa, &hdr->b_dva, hdr->b_birth) %
-	    multilist_get_num_sublists(ml));
+	hash = (unsigned int)buf_hash(hdr->b_spa, &hdr->b_dva, hdr->b_birth);
+	if (arc_numa_nodes > 1) {
+		uint_t node = hdr->b_l1hdr.b_numa_node;
+		unsigned int lo = node * num_sublists / arc_numa_nodes;
+		unsigned int hi = (node + 1) * num_sublists / arc_numa_nodes;
+
+		return (lo + hash % (hi - lo));
+	}
+	return (hash % num_sublists);
 }
 
 static unsigned int
@@ -7663,6 +8025,19 @@ arc_state_init(void)
 	 */
 	arc_state_evict_marker_count = num_sublists;
 
+	/*
+	 * Each node needs at least one sublist of its own; nodes beyond
+	 * that share sublists (see arc_numa_node_current()).
+	 */
+	arc_numa_nodes = 1;
+	if (zfs_arc_numa)
+		arc_numa_nodes = MAX(MIN(arc_numa_node_count(),
+		    num_sublists), 1);
+	arc_numa_sums = kmem_zalloc(sizeof (wmsum_t) * arc_numa_nodes *
+	    ARC_NUMA_NSTATS, KM_SLEEP);
+	for (int i = 0; i < arc_numa_nodes * ARC_NUMA_NSTATS; i++)
+		wmsum_init(&arc_numa_sums[i], 0);
+
 	zfs_refcount_create(&arc_anon->arcs_esize[ARC_BUFC_METADATA]);
 	zfs_refcount_create(&arc_anon->arcs_esize[ARC_BUFC_DATA]);
 	zfs_refcount_create(&arc_mru->arcs_esize[ARC_BUFC_METADATA]);
@@ -7718,6 +8093,8 @@ arc_state_init(void)
 	wmsum_init(&arc_sums.arcstat_mfu_hits, 0);
 	wmsum_init(&arc_sums.arcstat_mfu_ghost_hits, 0);
 	wmsum_init(&arc_sums.arcstat_uncached_hits, 0);
+	wmsum_init(&arc_sums.arcstat_admit_filter_admitted, 0);
+	wmsum_init(&arc_sums.arcstat_admit_filter_rejected, 0);
 	wmsum_init(&arc_sums.arcstat_deleted, 0);
 	wmsum_init(&arc_sums.arcstat_mutex_miss, 0);
 	wmsum_init(&arc_sums.arcstat_access_skip, 0);
@@ -7809,6 +8186,12 @@ arc_state_init(void)
 static void
 arc_state_fini(void)
 {
+	for (int i = 0; i < arc_numa_nodes * ARC_NUMA_NSTATS; i++)
+		wmsum_fini(&arc_numa_sums[i]);
+	kmem_free(arc_numa_sums, sizeof (wmsum_t) * arc_numa_nodes *
+	    ARC_NUMA_NSTATS);
+	arc_numa_sums = NULL;
+
 	zfs_refcount_destroy(&arc_anon->arcs_esize[ARC_BUFC_METADATA]);
 	zfs_refcount_destroy(&arc_anon->arcs_esize[ARC_BUFC_DATA]);
 	zfs_refcount_destroy(&arc_mru->arcs_esize[ARC_BUFC_METADATA]);
@@ -7877,6 +8260,8 @@ arc_state_fini(void)
 	wmsum_fini(&arc_sums.arcstat_mfu_hits);
 	wmsum_fini(&arc_sums.arcstat_mfu_ghost_hits);
 	wmsum_fini(&arc_sums.arcstat_uncached_hits);
+	wmsum_fini(&arc_sums.arcstat_admit_filter_admitted);
+	wmsum_fini(&arc_sums.arcstat_admit_filter_rejected);
 	wmsum_fini(&arc_sums.arcstat_deleted);
 	wmsum_fini(&arc_sums.arcstat_mutex_miss);
 	wmsum_fini(&arc_sums.arcstat_access_skip);
@@ -8042,6 +8427,7 @@ arc_init(void)
 	arc_state_init();
 
 	buf_init();
+	arc_admit_init();
 
 	list_create(&arc_prune_list, sizeof (arc_prune_t),
 	    offsetof(arc_prune_t, p_node));
@@ -8067,6 +8453,8 @@ arc_init(void)
 		kstat_install(arc_ksp);
 	}
 
+	arc_numa_kstat_init();
+
 	arc_state_evict_markers =
 	    arc_state_alloc_markers(arc_state_evict_marker_count);
 	arc_evict_zthr = zthr_create_timer("arc_evict",
@@ -8134,9 +8522,11 @@ arc_fini(void)
 		kstat_delete(arc_ksp);
 		arc_ksp = NULL;
 	}
+	arc_numa_kstat_fini();
 
 	taskq_wait(arc_prune_taskq);
 	taskq_destroy(arc_prune_taskq);
+	arc_admit_fini();
 
 	list_destroy(&arc_async_flush_list);
 	mutex_destroy(&arc_async_flush_lock);
@@ -11212,6 +11602,9 @@ ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, pc_percent, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, average_blocksize, UINT, ZMOD_RD,
 	"Target average block size");
 
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, admit_threshold, UINT, ZMOD_RW,
+	"Recent accesses before a data block is cached, 0 to disable");
+
 ZFS_MODULE_PARAM(zfs, zfs_, compressed_arc_enabled, INT, ZMOD_RW,
 	"Disable compressed ARC buffers");
 
@@ -11294,3 +11687,6 @@ ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, prune_task_threads, INT, ZMOD_RW,
 
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, evict_threads, UINT, ZMOD_RD,
 	"Number of threads to use for ARC eviction.");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, numa, INT, ZMOD_RD,
+	"Partition ARC sublists and eviction by NUMA node");
@@ -0,0 +1,610 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * ARC warm restart
+ *
+ * The L2ARC can rebuild its contents from the log blocks it writes to the
+ * cache devices, but the ARC itself always starts out cold after a reboot
+ * or a pool import.  For large working sets it can take a long time for
+ * demand reads to bring the cache back to its steady state.
+ *
+ * To shorten this, a per-pool zthr periodically writes a manifest of the
+ * blocks cached in the pool to a MOS object, and reads it back in the
+ * background after the pool is imported, prefetching every block it lists.
+ *
+ * ARC headers are only identified by their DVA and birth txg, which is not
+ * enough to reissue a read safely: the checksum, compression and
+ * encryption parameters live in the block pointer, and the block may have
+ * been freed and reallocated since the manifest was written.  Instead, the
+ * manifest records the logical bookmark (dataset, object, level and blkid)
+ * of every cached dbuf.  Restoring walks the indirect block tree through
+ * dbuf_prefetch_impl(), so every block is found via its current block
+ * pointer and verified like any other read; entries that no longer exist
+ * are silently skipped.
+ *
+ * Only blocks that still have a dbuf when the manifest is written can be
+ * recorded: those that are held, and those kept in the dbuf caches after
+ * their last hold was released.  Once a dbuf is evicted from the dbuf
+ * cache its data may stay in the ARC for a long time, but nothing links
+ * the ARC header back to a bookmark any more, so the manifest covers at
+ * most dbuf_cache_max_bytes and dbuf_metadata_cache_max_bytes of
+ * unheld blocks, a small fraction of a large ARC.  The "save_bytes"
+ * kstat reports the logical size of the blocks in the last manifest, and
+ * comparing it against the ARC's data_size shows how much of the cache a
+ * restore can bring back.
+ *
+ * Blocks that were in the MFU state are written first and thus restored
+ * first.  Prefetches are issued at ZIO_PRIORITY_ASYNC_READ and at most
+ * zfs_arc_warm_inflight of them are outstanding at any time.  Progress is
+ * reported in the per-pool "arc_warm" kstat.
+ *
+ * The manifest is saved from open context every zfs_arc_warm_interval
+ * seconds while the pool is imported and writable.  It is not saved at
+ * export time because by then the file systems have been unmounted and
+ * their dbufs evicted; the last periodic manifest is used instead.
+ *
+ * The manifest object is counted by the arc_warm feature, which is active
+ * while it exists.  Once zfs_arc_warm_enabled is turned off, the manifest
+ * is destroyed at the next save interval and the feature is deactivated.
+ */
+
+#include <sys/arc.h>
+#include <sys/arc_warm.h>
+#include <sys/dbuf.h>
+#include <sys/dmu_objset.h>
+#include <sys/dmu_tx.h>
+#include <sys/dnode.h>
+#include <sys/dsl_crypt.h>
+#include <sys/dsl_dataset.h>
+#include <sys/dsl_dir.h>
+#include <sys/dsl_pool.h>
+#include <sys/dsl_synctask.h>
+#include <sys/spa_impl.h>
+#include <sys/zap.h>
+#include <sys/zfeature.h>
+#include <sys/zthr.h>
+
+/*
+ * Save and restore the ARC warm-restart manifest.
+ */
+static int zfs_arc_warm_enabled = B_FALSE;
+
+/*
+ * Seconds between manifest saves.
+ */
+static uint_t zfs_arc_warm_interval = 600;
+
+/*
+ * Maximum number of blocks recorded in a manifest.
+ */
+static uint_t zfs_arc_warm_max_blocks = 262144;
+
+/*
+ * Maximum number of outstanding prefetches while restoring.
+ */
+static uint_t zfs_arc_warm_inflight = 64;
+
+/* Entries read from the manifest object at a time while restoring. */
+#define	ARC_WARM_CHUNK	512
+
+typedef struct arc_warm_collect {
+	arc_warm_entry_t	*awc_ents;
+	uint64_t		awc_count;
+	uint64_t		awc_max;
+	uint64_t		awc_cursor;	/* next MRU entry to replace */
+} arc_warm_collect_t;
+
+typedef struct arc_warm_restore {
+	spa_t		*awr_spa;
+	kmutex_t	awr_lock;
+	kcondvar_t	awr_cv;
+	uint64_t	awr_inflight;
+
+	/* Holds reused across consecutive entries, see below. */
+	boolean_t	awr_config_held;
+	dsl_dataset_t	*awr_ds;
+	objset_t	*awr_os;
+	dnode_t		*awr_dn;
+} arc_warm_restore_t;
+
+typedef struct arc_warm_save_arg {
+	arc_warm_phys_t		*awa_buf;
+	size_t			awa_bufsize;
+	uint64_t		awa_bytes;	/* logical size of the blocks */
+} arc_warm_save_arg_t;
+
+static void
+arc_warm_collect_cb(dmu_buf_impl_t *db, void *arg)
+{
+	arc_warm_collect_t *awc = arg;
+	dsl_dataset_t *ds = db->db_objset->os_dsl_dataset;
+	arc_buf_info_t abi;
+
+	/* MOS blocks are read in at import time anyway. */
+	if (ds == NULL || db->db_buf == NULL)
+		return;
+
+	/* The user/group/project used objects are not in the meta-dnode. */
+	if (DMU_OBJECT_IS_SPECIAL(db->db.db_object) &&
+	    db->db.db_object != DMU_META_DNODE_OBJECT)
+		return;
+
+	arc_buf_info(db->db_buf, &abi, 0);
+	boolean_t mfu = (abi.abi_state_type == ARC_STATE_MFU);
+
+	arc_warm_entry_t *awe;
+	if (awc->awc_count < awc->awc_max) {
+		awe = &awc->awc_ents[awc->awc_count++];
+	} else {
+		/*
+		 * The manifest is full; let MFU blocks displace MRU ones,
+		 * which are cheaper to lose.
+		 */
+		if (!mfu)
+			return;
+		while (awc->awc_cursor < awc->awc_max &&
+		    AWE_GET_MFU(&awc->awc_ents[awc->awc_cursor]))
+			awc->awc_cursor++;
+		if (awc->awc_cursor == awc->awc_max)
+			return;
+		awe = &awc->awc_ents[awc->awc_cursor++];
+	}
+
+	awe->awe_objset = ds->ds_object;
+	awe->awe_object = db->db.db_object;
+	awe->awe_blkid = db->db_blkid;
+	awe->awe_prop = 0;
+	AWE_SET_LEVEL(awe, db->db_level);
+	AWE_SET_MFU(awe, mfu);
+	AWE_SET_LSIZE(awe, db->db.db_size);
+}
+
+/*
+ * Order the manifest so that MFU blocks are restored first, and within
+ * each state by dataset and object so that their holds can be reused,
+ * indirect blocks before the blocks they point to.
+ */
+static int
+arc_warm_entry_compare(const void *x1, const void *x2)
+{
+	const arc_warm_entry_t *a = x1;
+	const arc_warm_entry_t *b = x2;
+
+	int cmp = TREE_CMP(AWE_GET_MFU(b), AWE_GET_MFU(a));
+	if (cmp != 0)
+		return (cmp);
+	cmp = TREE_CMP(a->awe_objset, b->awe_objset);
+	if (cmp != 0)
+		return (cmp);
+	cmp = TREE_CMP(a->awe_object, b->awe_object);
+	if (cmp != 0)
+		return (cmp);
+	cmp = TREE_CMP(AWE_GET_LEVEL(b), AWE_GET_LEVEL(a));
+	if (cmp != 0)
+		return (cmp);
+	return (TREE_CMP(a->awe_blkid, b->awe_blkid));
+}
+
+static void
+arc_warm_save_sync(void *arg, dmu_tx_t *tx)
+{
+	arc_warm_save_arg_t *awa = arg;
+	spa_t *spa = dmu_tx_pool(tx)->dp_spa;
+	objset_t *mos = spa->spa_meta_objset;
+	uint64_t count = awa->awa_buf->awp_count;
+	uint64_t size = (count + 1) * sizeof (arc_warm_entry_t);
+	uint64_t obj;
+
+	int err = zap_lookup(mos, DMU_POOL_DIRECTORY_OBJECT,
+	    DMU_POOL_ARC_WARM, sizeof (uint64_t), 1, &obj);
+	if (err == ENOENT) {
+		obj = dmu_object_alloc(mos, DMU_OTN_UINT64_METADATA,
+		    SPA_OLD_MAXBLOCKSIZE, DMU_OT_NONE, 0, tx);
+		VERIFY0(zap_add(mos, DMU_POOL_DIRECTORY_OBJECT,
+		    DMU_POOL_ARC_WARM, sizeof (uint64_t), 1, &obj, tx));
+		spa_feature_incr(spa, SPA_FEATURE_ARC_WARM, tx);
+	} else {
+		VERIFY0(err);
+		VERIFY0(dmu_free_range(mos, obj, size, DMU_OBJECT_END, tx));
+	}
+	spa->spa_arc_warm_obj = obj;
+
+	awa->awa_buf->awp_txg = dmu_tx_get_txg(tx);
+	dmu_write(mos, obj, 0, size, awa->awa_buf, tx);
+
+	spa_arc_warm_stats_save(spa, count, awa->awa_bytes,
+	    dmu_tx_get_txg(tx));
+	zfs_dbgmsg("arc_warm: saved %llu blocks of %llu bytes for pool %s "
+	    "in txg %llu", (u_longlong_t)count,
+	    (u_longlong_t)awa->awa_bytes, spa_name(spa),
+	    (u_longlong_t)dmu_tx_get_txg(tx));
+
+	vmem_free(awa->awa_buf, awa->awa_bufsize);
+	kmem_free(awa, sizeof (*awa));
+}
+
+static void
+arc_warm_destroy_sync(void *arg, dmu_tx_t *tx)
+{
+	spa_t *spa = arg;
+	objset_t *mos = spa->spa_meta_objset;
+	uint64_t obj = spa->spa_arc_warm_obj;
+
+	if (obj == 0)
+		return;
+
+	VERIFY0(dmu_object_free(mos, obj, tx));
+	VERIFY0(zap_remove(mos, DMU_POOL_DIRECTORY_OBJECT,
+	    DMU_POOL_ARC_WARM, tx));
+	spa_feature_decr(spa, SPA_FEATURE_ARC_WARM, tx);
+	spa->spa_arc_warm_obj = 0;
+}
+
+/*
+ * Destroy the manifest, returning the arc_warm feature to enabled.
+ */
+static void
+arc_warm_destroy(spa_t *spa)
+{
+	dmu_tx_t *tx = dmu_tx_create_dd(spa_get_dsl(spa)->dp_mos_dir);
+	if (dmu_tx_assign(tx, DMU_TX_WAIT) != 0) {
+		dmu_tx_abort(tx);
+		return;
+	}
+	dsl_sync_task_nowait(spa_get_dsl(spa), arc_warm_destroy_sync, spa, tx);
+	dmu_tx_commit(tx);
+}
+
+/*
+ * Collect the bookmarks of the pool's cached dbufs and write them out as
+ * the new manifest in the currently open txg.
+ */
+static void
+arc_warm_save(spa_t *spa)
+{
+	uint64_t max = zfs_arc_warm_max_blocks;
+	arc_warm_collect_t awc = { 0 };
+
+	if (max == 0 || !spa_feature_is_enabled(spa, SPA_FEATURE_ARC_WARM))
+		return;
+
+	/* The header occupies the first entry of the buffer. */
+	size_t bufsize = (max + 1) * sizeof (arc_warm_entry_t);
+	arc_warm_phys_t *awp = vmem_zalloc(bufsize, KM_SLEEP);
+
+	awc.awc_ents = (arc_warm_entry_t *)(awp + 1);
+	awc.awc_max = max;
+	dbuf_walk_cached(spa, arc_warm_collect_cb, &awc);
+
+	/*
+	 * Nothing to record, e.g. because no file system has been accessed
+	 * since the pool was imported.  Keep the previous manifest.
+	 */
+	if (awc.awc_count == 0) {
+		vmem_free(awp, bufsize);
+		return;
+	}
+
+	qsort(awc.awc_ents, awc.awc_count, sizeof (arc_warm_entry_t),
+	    arc_warm_entry_compare);
+
+	awp->awp_magic = ARC_WARM_MAGIC;
+	awp->awp_version = ARC_WARM_VERSION;
+	awp->awp_count = awc.awc_count;
+
+	uint64_t bytes = 0;
+	for (uint64_t i = 0; i < awc.awc_count; i++)
+		bytes += AWE_GET_LSIZE(&awc.awc_ents[i]);
+
+	dmu_tx_t *tx = dmu_tx_create_dd(spa_get_dsl(spa)->dp_mos_dir);
+	if (dmu_tx_assign(tx, DMU_TX_WAIT) != 0) {
+		dmu_tx_abort(tx);
+		vmem_free(awp, bufsize);
+		return;
+	}
+
+	arc_warm_save_arg_t *awa = kmem_alloc(sizeof (*awa), KM_SLEEP);
+	awa->awa_buf = awp;
+	awa->awa_bufsize = bufsize;
+	awa->awa_bytes = bytes;
+	dsl_sync_task_nowait(spa_get_dsl(spa), arc_warm_save_sync, awa, tx);
+	dmu_tx_commit(tx);
+}
+
+static void
+arc_warm_prefetch_done(void *arg, uint64_t level, uint64_t blkid,
+    boolean_t issued)
+{
+	(void) level; (void) blkid;
+	arc_warm_restore_t *awr = arg;
+
+	spa_arc_warm_stats_restore_add(awr->awr_spa, 0, issued, !issued);
+
+	mutex_enter(&awr->awr_lock);
+	ASSERT3U(awr->awr_inflight, >, 0);
+	awr->awr_inflight--;
+	cv_broadcast(&awr->awr_cv);
+	mutex_exit(&awr->awr_lock);
+}
+
+static void
+arc_warm_restore_rele_dnode(arc_warm_restore_t *awr)
+{
+	if (awr->awr_dn != NULL && awr->awr_dn != DMU_META_DNODE(awr->awr_os))
+		dnode_rele(awr->awr_dn, awr);
+	awr->awr_dn = NULL;
+}
+
+static void
+arc_warm_restore_rele(arc_warm_restore_t *awr)
+{
+	arc_warm_restore_rele_dnode(awr);
+	if (awr->awr_ds != NULL)
+		dsl_dataset_rele(awr->awr_ds, awr);
+	awr->awr_ds = NULL;
+	awr->awr_os = NULL;
+	if (awr->awr_config_held)
+		dsl_pool_config_exit(spa_get_dsl(awr->awr_spa), awr);
+	awr->awr_config_held = B_FALSE;
+}
+
+/*
+ * Look up the dnode of an entry, reusing the holds of the previous entry
+ * where possible.  Returns NULL if the block no longer exists or cannot
+ * be read, e.g. because the dataset's encryption key is not loaded.
+ */
+static dnode_t *
+arc_warm_restore_dnode(arc_warm_restore_t *awr, const arc_warm_entry_t *awe)
+{
+	dsl_pool_t *dp = spa_get_dsl(awr->awr_spa);
+
+	if (!awr->awr_config_held) {
+		dsl_pool_config_enter(dp, awr);
+		awr->awr_config_held = B_TRUE;
+	}
+
+	if (awr->awr_ds != NULL && awr->awr_ds->ds_object != awe->awe_objset) {
+		arc_warm_restore_rele_dnode(awr);
+		dsl_dataset_rele(awr->awr_ds, awr);
+		awr->awr_ds = NULL;
+		awr->awr_os = NULL;
+	}
+
+	if (awr->awr_ds == NULL) {
+		dsl_dataset_t *ds;
+		objset_t *os;
+
+		if (dsl_dataset_hold_obj(dp, awe->awe_objset, awr, &ds) != 0)
+			return (NULL);
+		if (dmu_objset_from_ds(ds, &os) != 0 ||
+		    (ds->ds_dir->dd_crypto_obj != 0 &&
+		    dsl_dataset_get_keystatus(ds->ds_dir) !=
+		    ZFS_KEYSTATUS_AVAILABLE)) {
+			dsl_dataset_rele(ds, awr);
+			return (NULL);
+		}
+		awr->awr_ds = ds;
+		awr->awr_os = os;
+	}
+
+	if (awr->awr_dn != NULL && awr->awr_dn->dn_object != awe->awe_object)
+		arc_warm_restore_rele_dnode(awr);
+
+	if (awr->awr_dn == NULL) {
+		if (awe->awe_object == DMU_META_DNODE_OBJECT) {
+			awr->awr_dn = DMU_META_DNODE(awr->awr_os);
+		} else if (dnode_hold(awr->awr_os, awe->awe_object, awr,
+		    &awr->awr_dn) != 0) {
+			awr->awr_dn = NULL;
+		}
+	}
+
+	return (awr->awr_dn);
+}
+
+/*
+ * Issue the prefetches for a chunk of manifest entries.  The pool
+ * configuration lock and the dataset and dnode holds are cached across
+ * consecutive entries, but dropped whenever we have to wait for in-flight
+ * prefetches to complete so that we do not stall spa_sync().
+ */
+static void
+arc_warm_restore_chunk(arc_warm_restore_t *awr, const arc_warm_entry_t *ents,
+    uint64_t count, zthr_t *zthr)
+{
+	for (uint64_t i = 0; i < count && !zthr_iscancelled(zthr); i++) {
+		const arc_warm_entry_t *awe = &ents[i];
+		uint64_t limit = MAX(zfs_arc_warm_inflight, 1);
+
+		mutex_enter(&awr->awr_lock);
+		if (awr->awr_inflight >= limit) {
+			mutex_exit(&awr->awr_lock);
+			arc_warm_restore_rele(awr);
+			mutex_enter(&awr->awr_lock);
+			while (awr->awr_inflight >= limit)
+				cv_wait(&awr->awr_cv, &awr->awr_lock);
+		}
+		awr->awr_inflight++;
+		mutex_exit(&awr->awr_lock);
+
+		spa_arc_warm_stats_restore_add(awr->awr_spa, 1, 0, 0);
+
+		dnode_t *dn = arc_warm_restore_dnode(awr, awe);
+		if (dn == NULL) {
+			/* Account for it as if the prefetch was skipped. */
+			arc_warm_prefetch_done(awr, 0, 0, B_FALSE);
+			continue;
+		}
+
+		rw_enter(&dn->dn_struct_rwlock, RW_READER);
+		(void) dbuf_prefetch_impl(dn, AWE_GET_LEVEL(awe),
+		    awe->awe_blkid, ZIO_PRIORITY_ASYNC_READ, 0,
+		    arc_warm_prefetch_done, awr);
+		rw_exit(&dn->dn_struct_rwlock);
+	}
+
+	arc_warm_restore_rele(awr);
+}
+
+/*
+ * Read the manifest back and prefetch every block it lists.  Returns
+ * B_FALSE if the restore was interrupted and should be retried.
+ */
+static boolean_t
+arc_warm_restore(spa_t *spa, zthr_t *zthr)
+{
+	objset_t *mos = spa->spa_meta_objset;
+	uint64_t obj = spa->spa_arc_warm_obj;
+	arc_warm_phys_t awp;
+
+	if (obj == 0)
+		return (B_TRUE);
+
+	if (dmu_read(mos, obj, 0, sizeof (awp), &awp,
+	    DMU_READ_PREFETCH) != 0 || awp.awp_magic != ARC_WARM_MAGIC ||
+	    awp.awp_version != ARC_WARM_VERSION)
+		return (B_TRUE);
+
+	/*
+	 * Holding datasets takes references on the spa, which requires
+	 * holding one already.  Don't block on the namespace lock, since
+	 * spa_unload() cancels this thread with it held; retry later.
+	 */
+	if (!mutex_tryenter(&spa_namespace_lock))
+		return (B_FALSE);
+	spa_open_ref(spa, FTAG);
+	mutex_exit(&spa_namespace_lock);
+
+	spa_arc_warm_stats_restore(spa, awp.awp_count);
+
+	arc_warm_restore_t awr = { 0 };
+	awr.awr_spa = spa;
+	mutex_init(&awr.awr_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&awr.awr_cv, NULL, CV_DEFAULT, NULL);
+
+	size_t bufsize = ARC_WARM_CHUNK * sizeof (arc_warm_entry_t);
+	arc_warm_entry_t *ents = kmem_alloc(bufsize, KM_SLEEP);
+
+	for (uint64_t i = 0; i < awp.awp_count && !zthr_iscancelled(zthr); ) {
+		uint64_t n = MIN(ARC_WARM_CHUNK, awp.awp_count - i);
+
+		/* Entry 0 is the header. */
+		if (dmu_read(mos, obj, (i + 1) * sizeof (arc_warm_entry_t),
+		    n * sizeof (arc_warm_entry_t), ents,
+		    DMU_READ_PREFETCH) != 0)
+			break;
+
+		arc_warm_restore_chunk(&awr, ents, n, zthr);
+		i += n;
+	}
+
+	/* The prefetch callbacks reference awr, wait for all of them. */
+	mutex_enter(&awr.awr_lock);
+	while (awr.awr_inflight > 0)
+		cv_wait(&awr.awr_cv, &awr.awr_lock);
+	mutex_exit(&awr.awr_lock);
+
+	kmem_free(ents, bufsize);
+	cv_destroy(&awr.awr_cv);
+	mutex_destroy(&awr.awr_lock);
+	spa_close(spa, FTAG);
+
+	return (!zthr_iscancelled(zthr));
+}
+
+static boolean_t
+arc_warm_thread_check(void *arg, zthr_t *zthr)
+{
+	(void) zthr;
+	spa_t *spa = arg;
+
+	/* Dataset holds are not allowed until the pool has been loaded. */
+	if (spa->spa_load_state != SPA_LOAD_NONE)
+		return (B_FALSE);
+
+	/*
+	 * Once disabled, destroy the manifest when the next save would be
+	 * due.  This leaves time to enable saving after the pool has been
+	 * imported without losing the manifest written before.
+	 */
+	if (!zfs_arc_warm_enabled) {
+		return (spa->spa_arc_warm_obj != 0 &&
+		    zfs_arc_warm_interval != 0 &&
+		    gethrtime() - spa->spa_arc_warm_last_run >=
+		    SEC2NSEC(zfs_arc_warm_interval));
+	}
+
+	/* Retry interrupted restores once a second. */
+	if (spa->spa_arc_warm_restore)
+		return (gethrtime() - spa->spa_arc_warm_last_run >=
+		    SEC2NSEC(1));
+
+	return (zfs_arc_warm_interval != 0 &&
+	    gethrtime() - spa->spa_arc_warm_last_run >=
+	    SEC2NSEC(zfs_arc_warm_interval));
+}
+
+static void
+arc_warm_thread(void *arg, zthr_t *zthr)
+{
+	spa_t *spa = arg;
+
+	/*
+	 * Restore the previous manifest before writing a new one, which
+	 * would otherwise only reflect what was accessed since the import.
+	 */
+	if (!zfs_arc_warm_enabled) {
+		arc_warm_destroy(spa);
+		spa->spa_arc_warm_restore = B_FALSE;
+	} else if (spa->spa_arc_warm_restore) {
+		if (arc_warm_restore(spa, zthr))
+			spa->spa_arc_warm_restore = B_FALSE;
+	} else {
+		arc_warm_save(spa);
+	}
+	spa->spa_arc_warm_last_run = gethrtime();
+}
+
+void
+spa_start_arc_warm_thread(spa_t *spa)
+{
+	ASSERT0P(spa->spa_arc_warm_zthr);
+
+	spa->spa_arc_warm_restore = (spa->spa_arc_warm_obj != 0);
+	spa->spa_arc_warm_last_run = gethrtime();
+	spa->spa_arc_warm_zthr = zthr_create_timer("z_arc_warm",
+	    arc_warm_thread_check, arc_warm_thread, spa, SEC2NSEC(1),
+	    minclsyspri);
+}
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, warm_enabled, INT, ZMOD_RW,
+	"Save and restore the ARC warm-restart manifest");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, warm_interval, UINT, ZMOD_RW,
+	"Seconds between ARC warm-restart manifest saves");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, warm_max_blocks, UINT, ZMOD_RW,
+	"Maximum number of blocks in the ARC warm-restart manifest");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, warm_inflight, UINT, ZMOD_RW,
+	"Maximum outstanding prefetches while restoring the ARC");
@@ -41,6 +41,8 @@ static dataset_kstat_values_t empty_dataset_kstats = {
 	{
 	{ "zil_commit_count",			KSTAT_DATA_UINT64 },
 	{ "zil_commit_writer_count",		KSTAT_DATA_UINT64 },
+	{ "zil_commit_issuer_contended_count",	KSTAT_DATA_UINT64 },
+	{ "zil_commit_issuer_wait_time",	KSTAT_DATA_UINT64 },
 	{ "zil_commit_error_count",		KSTAT_DATA_UINT64 },
 	{ "zil_commit_stall_count",		KSTAT_DATA_UINT64 },
 	{ "zil_commit_suspend_count",		KSTAT_DATA_UINT64 },
@@ -59,7 +61,11 @@ static dataset_kstat_values_t empty_dataset_kstats = {
 	{ "zil_itx_metaslab_slog_count",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_bytes",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_write",	KSTAT_DATA_UINT64 },
-	{ "zil_itx_metaslab_slog_alloc",	KSTAT_DATA_UINT64 }
+	{ "zil_itx_metaslab_slog_alloc",	KSTAT_DATA_UINT64 },
+	{ "zil_replay_count",			KSTAT_DATA_UINT64 },
+	{ "zil_replay_bytes",			KSTAT_DATA_UINT64 },
+	{ "zil_replay_time",			KSTAT_DATA_UINT64 },
+	{ "zil_replay_prefetch_count",		KSTAT_DATA_UINT64 }
 	}
 };
 
@@ -145,10 +151,15 @@ dataset_kstats_create(dataset_kstats_t *dk, objset_t *objset)
 		return (SET_ERROR(ENAMETOOLONG));
 	}
 
+	/*
+	 * Without a per-dataset commit latency histogram, its entries at the
+	 * end of dataset_kstat_values_t are left out.
+	 */
+	boolean_t histo = zil_dataset_histo != 0;
 	kstat_t *kstat = kstat_create(kstat_module_name, 0, kstat_name,
 	    "dataset", KSTAT_TYPE_NAMED,
-	    sizeof (empty_dataset_kstats) / sizeof (kstat_named_t),
-	    KSTAT_FLAG_VIRTUAL);
+	    sizeof (empty_dataset_kstats) / sizeof (kstat_named_t) -
+	    (histo ? 0 : ZIL_HISTO_BUCKETS), KSTAT_FLAG_VIRTUAL);
 	if (kstat == NULL)
 		return (SET_ERROR(ENOMEM));
 
@@ -156,6 +167,7 @@ dataset_kstats_create(dataset_kstats_t *dk, objset_t *objset)
 	    kmem_alloc(sizeof (empty_dataset_kstats), KM_SLEEP);
 	memcpy(dk_kstats, &empty_dataset_kstats,
 	    sizeof (empty_dataset_kstats));
+	zil_kstat_values_init(&dk_kstats->dkv_zil_stats);
 
 	char *ds_name = kmem_zalloc(ZFS_MAX_DATASET_NAME_LEN, KM_SLEEP);
 	dsl_dataset_name(objset->os_dsl_dataset, ds_name);
@@ -174,7 +186,7 @@ dataset_kstats_create(dataset_kstats_t *dk, objset_t *objset)
 	wmsum_init(&dk->dk_sums.dss_nread, 0);
 	wmsum_init(&dk->dk_sums.dss_nunlinks, 0);
 	wmsum_init(&dk->dk_sums.dss_nunlinked, 0);
-	zil_sums_init(&dk->dk_zil_sums);
+	zil_sums_init(&dk->dk_zil_sums, histo);
 
 	dk->dk_kstats = kstat;
 	kstat_install(kstat);
@@ -339,6 +339,178 @@ dbuf_hash(void *os, uint64_t obj, uint8_t lvl, uint64_t blkid)
 	(dbuf)->db_level == (level) &&			\
 	(dbuf)->db_blkid == (blkid))
 
+/*
+ * dbuf_find() walks the hash chains without taking the hash mutexes, so
+ * a dbuf which has been removed from the hash table may still be looked
+ * at by a concurrent lookup.  dbuf_destroy() therefore does not return
+ * hashed dbufs to dbuf_kmem_cache directly.  It parks them on a per-CPU
+ * limbo list until every lookup that could have seen them is finished.
+ *
+ * Lookups are tracked with a global epoch.  A lookup is counted in
+ * dec_readers[] under the parity of the epoch it started in, and the
+ * epoch only advances from e to e + 1 once no lookup is counted against
+ * e - 1.  A dbuf retired in epoch r was unlinked before any lookup that
+ * started in r + 1 or later, so it can be freed once the epoch reaches
+ * r + 2.  Neither side ever waits for the other; a slow lookup only
+ * delays frees.
+ */
+#define	DBUF_EPOCH_LISTS	3
+#define	DBUF_EPOCH_BATCH	64
+
+typedef struct dbuf_epoch_cpu {
+	uint64_t	dec_readers[2];
+	kmutex_t	dec_lock;
+	list_t		dec_limbo[DBUF_EPOCH_LISTS];
+	uint_t		dec_nlimbo[DBUF_EPOCH_LISTS];
+} ____cacheline_aligned dbuf_epoch_cpu_t;
+
+static dbuf_epoch_cpu_t *dbuf_epoch_cpu;
+static uint_t dbuf_epoch_ncpu;
+static uint64_t dbuf_epoch = 1;
+
+static uint_t
+dbuf_epoch_enter(void)
+{
+	uint_t cpu = CPU_SEQID_UNSTABLE % dbuf_epoch_ncpu;
+	uint64_t *readers = dbuf_epoch_cpu[cpu].dec_readers;
+	uint64_t e;
+
+	/*
+	 * The count only protects us if the epoch was still e after it
+	 * became visible; otherwise retry in the new epoch.
+	 */
+	for (;;) {
+		e = atomic_load_64(&dbuf_epoch);
+		atomic_inc_64(&readers[e & 1]);
+		membar_sync();
+		if (atomic_load_64(&dbuf_epoch) == e)
+			break;
+		atomic_dec_64(&readers[e & 1]);
+	}
+
+	return ((cpu << 1) | (e & 1));
+}
+
+static void
+dbuf_epoch_exit(uint_t cookie)
+{
+	membar_sync();
+	atomic_dec_64(&dbuf_epoch_cpu[cookie >> 1].dec_readers[cookie & 1]);
+}
+
+static void
+dbuf_epoch_advance(void)
+{
+	uint64_t e = atomic_load_64(&dbuf_epoch);
+
+	membar_sync();
+	for (uint_t c = 0; c < dbuf_epoch_ncpu; c++) {
+		if (atomic_load_64(&dbuf_epoch_cpu[c].dec_readers[(e - 1) & 1]))
+			return;
+	}
+	(void) atomic_cas_64(&dbuf_epoch, e, e + 1);
+}
+
+static void
+dbuf_free_list(list_t *list)
+{
+	dmu_buf_impl_t *db;
+
+	while ((db = list_remove_head(list)) != NULL)
+		kmem_cache_free(dbuf_kmem_cache, db);
+}
+
+/*
+ * Free the dbufs on this CPU's limbo lists whose grace period is over.
+ * With the epoch at e, the list for e + 1 (mod 3) only holds dbufs that
+ * were retired in e - 2 or earlier.
+ */
+static void
+dbuf_epoch_reclaim(dbuf_epoch_cpu_t *dec)
+{
+	list_t free;
+	uint_t l;
+
+	list_create(&free, sizeof (dmu_buf_impl_t),
+	    offsetof(dmu_buf_impl_t, db_cache_link));
+
+	dbuf_epoch_advance();
+
+	mutex_enter(&dec->dec_lock);
+	l = (atomic_load_64(&dbuf_epoch) + 1) % DBUF_EPOCH_LISTS;
+	list_move_tail(&free, &dec->dec_limbo[l]);
+	dec->dec_nlimbo[l] = 0;
+	mutex_exit(&dec->dec_lock);
+
+	dbuf_free_list(&free);
+	list_destroy(&free);
+}
+
+/*
+ * Called by dbuf_destroy() for a dbuf that has been removed from the hash
+ * table.  The dbuf is no longer on any dbuf cache list, so db_cache_link
+ * is reused to link it on the limbo list.
+ */
+static void
+dbuf_epoch_retire(dmu_buf_impl_t *db)
+{
+	dbuf_epoch_cpu_t *dec =
+	    &dbuf_epoch_cpu[CPU_SEQID_UNSTABLE % dbuf_epoch_ncpu];
+	uint_t l, n = 0;
+
+	/* Order the unlink in dbuf_hash_remove() before the epoch load. */
+	membar_sync();
+
+	mutex_enter(&dec->dec_lock);
+	l = atomic_load_64(&dbuf_epoch) % DBUF_EPOCH_LISTS;
+	list_insert_tail(&dec->dec_limbo[l], db);
+	dec->dec_nlimbo[l]++;
+	for (l = 0; l < DBUF_EPOCH_LISTS; l++)
+		n += dec->dec_nlimbo[l];
+	mutex_exit(&dec->dec_lock);
+
+	if (n >= DBUF_EPOCH_BATCH)
+		dbuf_epoch_reclaim(dec);
+}
+
+static void
+dbuf_epoch_init(void)
+{
+	dbuf_epoch_ncpu = max_ncpus;
+	dbuf_epoch_cpu = kmem_zalloc(dbuf_epoch_ncpu *
+	    sizeof (dbuf_epoch_cpu_t), KM_SLEEP);
+	for (uint_t c = 0; c < dbuf_epoch_ncpu; c++) {
+		dbuf_epoch_cpu_t *dec = &dbuf_epoch_cpu[c];
+
+		mutex_init(&dec->dec_lock, NULL, MUTEX_DEFAULT, NULL);
+		for (int l = 0; l < DBUF_EPOCH_LISTS; l++) {
+			list_create(&dec->dec_limbo[l],
+			    sizeof (dmu_buf_impl_t),
+			    offsetof(dmu_buf_impl_t, db_cache_link));
+		}
+	}
+}
+
+/*
+ * No lookups can be running anymore, so everything in limbo is freed.
+ */
+static void
+dbuf_epoch_fini(void)
+{
+	for (uint_t c = 0; c < dbuf_epoch_ncpu; c++) {
+		dbuf_epoch_cpu_t *dec = &dbuf_epoch_cpu[c];
+
+		ASSERT0(dec->dec_readers[0]);
+		ASSERT0(dec->dec_readers[1]);
+		for (int l = 0; l < DBUF_EPOCH_LISTS; l++) {
+			dbuf_free_list(&dec->dec_limbo[l]);
+			list_destroy(&dec->dec_limbo[l]);
+		}
+		mutex_destroy(&dec->dec_lock);
+	}
+	kmem_free(dbuf_epoch_cpu, dbuf_epoch_ncpu * sizeof (dbuf_epoch_cpu_t));
+}
+
 dmu_buf_impl_t *
 dbuf_find(objset_t *os, uint64_t obj, uint8_t level, uint64_t blkid,
     uint64_t *hash_out)
@@ -346,11 +518,43 @@ dbuf_find(objset_t *os, uint64_t obj, uint8_t level, uint64_t blkid,
 	dbuf_hash_table_t *h = &dbuf_hash_table;
 	uint64_t hv;
 	uint64_t idx;
+	uint_t cookie;
 	dmu_buf_impl_t *db;
 
 	hv = dbuf_hash(os, obj, level, blkid);
 	idx = hv & h->hash_table_mask;
 
+	/*
+	 * An empty bucket can be detected without the hash mutex since
+	 * only the bucket head is read.  Every caller treats a miss as a
+	 * hint: dbuf_hold_impl() rechecks under the mutex when it inserts
+	 * the new dbuf in dbuf_hash_insert().
+	 */
+	if (atomic_load_ptr(&h->hash_table[idx]) == NULL)
+		goto out;
+
+	/*
+	 * Look for a hit without the hash mutex.  The epoch keeps every
+	 * dbuf we can reach allocated, and once db_mtx is held a dbuf
+	 * which is not DB_EVICTING is still hashed and cannot change
+	 * identity.  If the walk raced with a removal it may end early,
+	 * so a miss here is retried under the hash mutex.
+	 */
+	cookie = dbuf_epoch_enter();
+	for (db = atomic_load_ptr(&h->hash_table[idx]); db != NULL;
+	    db = atomic_load_ptr(&db->db_hash_next)) {
+		if (!DBUF_EQUAL(db, os, obj, level, blkid))
+			continue;
+		mutex_enter(&db->db_mtx);
+		if (db->db_state != DB_EVICTING &&
+		    DBUF_EQUAL(db, os, obj, level, blkid)) {
+			dbuf_epoch_exit(cookie);
+			return (db);
+		}
+		mutex_exit(&db->db_mtx);
+	}
+	dbuf_epoch_exit(cookie);
+
 	mutex_enter(DBUF_HASH_MUTEX(h, idx));
 	for (db = h->hash_table[idx]; db != NULL; db = db->db_hash_next) {
 		if (DBUF_EQUAL(db, os, obj, level, blkid)) {
@@ -363,11 +567,43 @@ dbuf_find(objset_t *os, uint64_t obj, uint8_t level, uint64_t blkid,
 		}
 	}
 	mutex_exit(DBUF_HASH_MUTEX(h, idx));
+out:
 	if (hash_out != NULL)
 		*hash_out = hv;
 	return (NULL);
 }
 
+/*
+ * Call func for every cached dbuf of the given pool.  Both the hash bucket
+ * mutex and the dbuf's db_mtx are held across the call, so func must not
+ * block.  Bonus buffers are not hashed and spill blocks are skipped.
+ */
+void
+dbuf_walk_cached(spa_t *spa, dbuf_walk_fn func, void *arg)
+{
+	dbuf_hash_table_t *h = &dbuf_hash_table;
+	dmu_buf_impl_t *db;
+
+	for (uint64_t idx = 0; idx <= h->hash_table_mask; idx++) {
+		if (atomic_load_ptr(&h->hash_table[idx]) == NULL)
+			continue;
+
+		mutex_enter(DBUF_HASH_MUTEX(h, idx));
+		for (db = h->hash_table[idx]; db != NULL;
+		    db = db->db_hash_next) {
+			if (db->db_objset->os_spa != spa ||
+			    db->db_blkid == DMU_SPILL_BLKID)
+				continue;
+
+			mutex_enter(&db->db_mtx);
+			if (db->db_state == DB_CACHED)
+				func(db, arg);
+			mutex_exit(&db->db_mtx);
+		}
+		mutex_exit(DBUF_HASH_MUTEX(h, idx));
+	}
+}
+
 static dmu_buf_impl_t *
 dbuf_find_bonus(objset_t *os, uint64_t object)
 {
@@ -430,7 +666,9 @@ dbuf_hash_insert(dmu_buf_impl_t *db)
 
 	mutex_enter(&db->db_mtx);
 	db->db_hash_next = h->hash_table[idx];
-	h->hash_table[idx] = db;
+	/* Publish the initialized dbuf to lockless dbuf_find() walks. */
+	membar_producer();
+	atomic_store_ptr(&h->hash_table[idx], db);
 	mutex_exit(DBUF_HASH_MUTEX(h, idx));
 	DBUF_STAT_BUMP(hash_elements);
 
@@ -499,8 +737,8 @@ dbuf_hash_remove(dmu_buf_impl_t *db)
 		dbp = &dbf->db_hash_next;
 		ASSERT(dbf != NULL);
 	}
-	*dbp = db->db_hash_next;
-	db->db_hash_next = NULL;
+	atomic_store_ptr(dbp, db->db_hash_next);
+	atomic_store_ptr(&db->db_hash_next, NULL);
 	if (h->hash_table[idx] &&
 	    h->hash_table[idx]->db_hash_next == NULL)
 		DBUF_STAT_BUMPDOWN(hash_chains);
@@ -980,8 +1218,8 @@ dbuf_init(void)
 	while (h->hash_mutexes == NULL) {
 		h->hash_mutex_mask = hmsize - 1;
 
-		h->hash_mutexes = vmem_zalloc(hmsize * sizeof (kmutex_t),
-		    KM_SLEEP);
+		h->hash_mutexes = vmem_zalloc(hmsize *
+		    sizeof (zfs_padded_mutex_t), KM_SLEEP);
 		if (h->hash_mutexes == NULL)
 			hmsize >>= 1;
 	}
@@ -993,7 +1231,8 @@ dbuf_init(void)
 	    sizeof (dbuf_dirty_record_t), 0, NULL, NULL, NULL, NULL, NULL, 0);
 
 	for (int i = 0; i < hmsize; i++)
-		mutex_init(&h->hash_mutexes[i], NULL, MUTEX_NOLOCKDEP, NULL);
+		mutex_init(DBUF_HASH_MUTEX(h, i), NULL, MUTEX_NOLOCKDEP, NULL);
+	dbuf_epoch_init();
 
 	dbuf_stats_init(h);
 
@@ -1060,12 +1299,13 @@ dbuf_fini(void)
 	dbuf_stats_destroy();
 
 	for (int i = 0; i < (h->hash_mutex_mask + 1); i++)
-		mutex_destroy(&h->hash_mutexes[i]);
+		mutex_destroy(DBUF_HASH_MUTEX(h, i));
 
 	vmem_free(h->hash_table, (h->hash_table_mask + 1) * sizeof (void *));
 	vmem_free(h->hash_mutexes, (h->hash_mutex_mask + 1) *
-	    sizeof (kmutex_t));
+	    sizeof (zfs_padded_mutex_t));
 
+	dbuf_epoch_fini();
 	kmem_cache_destroy(dbuf_kmem_cache);
 	kmem_cache_destroy(dbuf_dirty_kmem_cache);
 	taskq_destroy(dbu_evict_taskq);
@@ -1628,6 +1868,14 @@ dbuf_read_impl(dmu_buf_impl_t *db, dnode_t *dn, zio_t *zio, dmu_flags_t flags,
 
 	db->db_state = DB_READ;
 	DTRACE_SET_STATE(db, "read issued");
+
+	/*
+	 * Data turned away by the ARC admission filter is read uncached and
+	 * the dbuf is evicted on its last release, like DMU_UNCACHEDIO.
+	 */
+	if (DBUF_IS_CACHEABLE(db) && DBUF_IS_FILTERED(db) &&
+	    !arc_admit(db->db_objset->os_spa, bp))
+		db->db_pending_evict = B_TRUE;
 	mutex_exit(&db->db_mtx);
 
 	if (!DBUF_IS_CACHEABLE(db))
@@ -3318,7 +3566,14 @@ dbuf_destroy(dmu_buf_impl_t *db)
 		dbuf_rele_and_unlock(parent, db, B_TRUE);
 	}
 
-	kmem_cache_free(dbuf_kmem_cache, db);
+	/*
+	 * Hashed dbufs may still be seen by a lockless dbuf_find(), so
+	 * they are freed once its epoch is over.  Bonus dbufs never are.
+	 */
+	if (db->db_blkid != DMU_BONUS_BLKID)
+		dbuf_epoch_retire(db);
+	else
+		kmem_cache_free(dbuf_kmem_cache, db);
 	arc_space_return(sizeof (dmu_buf_impl_t), ARC_SPACE_DBUF);
 }
 
@@ -3549,6 +3804,7 @@ typedef struct dbuf_prefetch_arg {
 	zio_priority_t dpa_prio; /* The priority I/Os should be issued at. */
 	zio_t *dpa_zio; /* The parent zio_t for all prefetches. */
 	arc_flags_t dpa_aflags; /* Flags to pass to the final prefetch. */
+	boolean_t dpa_filtered; /* Final block must pass arc_admit(). */
 	dbuf_prefetch_fn dpa_cb; /* prefetch completion callback */
 	void *dpa_arg; /* prefetch completion arg */
 } dbuf_prefetch_arg_t;
@@ -3592,6 +3848,9 @@ dbuf_issue_final_prefetch(dbuf_prefetch_arg_t *dpa, blkptr_t *bp)
 	    dpa->dpa_aflags | ARC_FLAG_NOWAIT | ARC_FLAG_PREFETCH |
 	    ARC_FLAG_NO_BUF;
 
+	if (dpa->dpa_filtered && !arc_admit(dpa->dpa_spa, bp))
+		aflags = (aflags & ~ARC_FLAG_L2CACHE) | ARC_FLAG_UNCACHED;
+
 	/* dnodes are always read as raw and then converted later */
 	if (BP_GET_TYPE(bp) == DMU_OT_DNODE && BP_IS_PROTECTED(bp) &&
 	    dpa->dpa_curlevel == 0)
@@ -3816,6 +4075,7 @@ dbuf_prefetch_impl(dnode_t *dn, int64_t level, uint64_t blkid,
 		dpa->dpa_aflags |= ARC_FLAG_UNCACHED;
 	else if (dnode_level_is_l2cacheable(&bp, dn, level))
 		dpa->dpa_aflags |= ARC_FLAG_L2CACHE;
+	dpa->dpa_filtered = DNODE_LEVEL_IS_FILTERED(dn, level);
 
 	/*
 	 * If we have the indirect just above us, no need to do the asynchronous
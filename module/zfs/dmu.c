@@ -720,9 +720,24 @@ dmu_prefetch(objset_t *os, uint64_t object, int64_t level, uint64_t offset,
 void
 dmu_prefetch_by_dnode(dnode_t *dn, int64_t level, uint64_t offset,
     uint64_t len, zio_priority_t pri)
+{
+	(void) dmu_prefetch_by_dnode_limit(dn, level, offset, len,
+	    dmu_prefetch_max, pri);
+}
+
+/*
+ * Same as dmu_prefetch_by_dnode(), but with the caller's limit in place of
+ * dmu_prefetch_max.  This lets callers that prefetch many ranges on behalf
+ * of an explicit request share one limit across them.  Returns the number
+ * of bytes prefetched at the requested level, which the caller may deduct
+ * from its limit.
+ */
+uint64_t
+dmu_prefetch_by_dnode_limit(dnode_t *dn, int64_t level, uint64_t offset,
+    uint64_t len, uint64_t max, zio_priority_t pri)
 {
 	int64_t level2 = level;
-	uint64_t start, end, start2, end2;
+	uint64_t start, end, start2, end2, bytes;
 
 	/*
 	 * Depending on len we may do two prefetches: blocks [start, end) at
@@ -737,7 +752,7 @@ dmu_prefetch_by_dnode(dnode_t *dn, int64_t level, uint64_t offset,
 		uint64_t size = (dn->dn_maxblkid + 1) << dn->dn_datablkshift;
 		if (offset >= size) {
 			rw_exit(&dn->dn_struct_rwlock);
-			return;
+			return (0);
 		}
 		if (offset + len < offset || offset + len > size)
 			len = size - offset;
@@ -745,20 +760,21 @@ dmu_prefetch_by_dnode(dnode_t *dn, int64_t level, uint64_t offset,
 		/*
 		 * The object has multiple blocks.  Calculate the full range
 		 * of blocks [start, end2) and then split it into two parts,
-		 * so that the first [start, end) fits into dmu_prefetch_max.
+		 * so that the first [start, end) fits into max.
 		 */
 		start = dbuf_whichblock(dn, level, offset);
 		end2 = dbuf_whichblock(dn, level, offset + len - 1) + 1;
 		uint8_t ibs = dn->dn_indblkshift;
 		uint8_t bs = (level == 0) ? dn->dn_datablkshift : ibs;
-		uint_t limit = P2ROUNDUP(dmu_prefetch_max, 1 << bs) >> bs;
+		uint64_t limit = P2ROUNDUP(max, 1ULL << bs) >> bs;
 		start2 = end = MIN(end2, start + limit);
+		bytes = (end - start) << bs;
 
 		/*
-		 * Find level2 where [start2, end2) fits into dmu_prefetch_max.
+		 * Find level2 where [start2, end2) fits into max.
 		 */
 		uint8_t ibps = ibs - SPA_BLKPTRSHIFT;
-		limit = P2ROUNDUP(dmu_prefetch_max, 1 << ibs) >> ibs;
+		limit = P2ROUNDUP(max, 1ULL << ibs) >> ibs;
 		if (limit == 0)
 			end2 = start2;
 		do {
@@ -770,6 +786,7 @@ dmu_prefetch_by_dnode(dnode_t *dn, int64_t level, uint64_t offset,
 		/* There is only one block.  Prefetch it or nothing. */
 		start = start2 = end2 = 0;
 		end = start + (level == 0 && offset < dn->dn_datablksz);
+		bytes = (end - start) * dn->dn_datablksz;
 	}
 
 	for (uint64_t i = start; i < end; i++)
@@ -777,6 +794,8 @@ dmu_prefetch_by_dnode(dnode_t *dn, int64_t level, uint64_t offset,
 	for (uint64_t i = start2; i < end2; i++)
 		dbuf_prefetch(dn, level2, i, pri, 0);
 	rw_exit(&dn->dn_struct_rwlock);
+
+	return (bytes);
 }
 
 typedef struct {
@@ -2423,6 +2442,8 @@ dmu_write_policy(objset_t *os, dnode_t *dn, int level, int wp, zio_prop_t *zp)
 		    compress);
 		complevel = zio_complevel_select(os->os_spa, compress,
 		    complevel, complevel);
+		if (os->os_zstd_frames)
+			complevel = zio_complevel_frames(compress, complevel);
 
 		/*
 		 * Storing many references to an all zeros block in the dedup
@@ -2941,6 +2962,7 @@ EXPORT_SYMBOL(dmu_buf_hold_array_by_bonus);
 EXPORT_SYMBOL(dmu_buf_rele_array);
 EXPORT_SYMBOL(dmu_prefetch);
 EXPORT_SYMBOL(dmu_prefetch_by_dnode);
+EXPORT_SYMBOL(dmu_prefetch_by_dnode_limit);
 EXPORT_SYMBOL(dmu_prefetch_dnode);
 EXPORT_SYMBOL(dmu_free_range);
 EXPORT_SYMBOL(dmu_free_long_range);
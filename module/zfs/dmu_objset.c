@@ -348,6 +348,14 @@ smallblk_changed_cb(void *arg, uint64_t newval)
 	os->os_zpl_special_smallblock = newval;
 }
 
+static void
+zstd_frames_changed_cb(void *arg, uint64_t newval)
+{
+	objset_t *os = arg;
+
+	os->os_zstd_frames = !!newval;
+}
+
 static void
 direct_changed_cb(void *arg, uint64_t newval)
 {
@@ -589,6 +597,11 @@ dmu_objset_open_impl(spa_t *spa, dsl_dataset_t *ds, blkptr_t *bp,
 				    zfs_prop_to_name(ZFS_PROP_COMPRESSION),
 				    compression_changed_cb, os);
 			}
+			if (err == 0) {
+				err = dsl_prop_register(ds,
+				    zfs_prop_to_name(ZFS_PROP_ZSTD_FRAMES),
+				    zstd_frames_changed_cb, os);
+			}
 			if (err == 0) {
 				err = dsl_prop_register(ds,
 				    zfs_prop_to_name(ZFS_PROP_COPIES),
@@ -1461,12 +1474,23 @@ dmu_objset_upgrade_stop(objset_t *os)
 	}
 }
 
+/*
+ * Sync the dirty dnodes of one sublist.  The sublist lock is only held
+ * while taking a dnode off the list, so other sync_dnodes_task()s which
+ * ran out of work may drain the same sublist concurrently.
+ */
 static void
-dmu_objset_sync_dnodes(multilist_sublist_t *list, dmu_tx_t *tx)
+dmu_objset_sync_dnodes(multilist_t *ml, int sublist_idx, dmu_tx_t *tx)
 {
+	multilist_sublist_t *list;
 	dnode_t *dn;
 
-	while ((dn = multilist_sublist_head(list)) != NULL) {
+	for (;;) {
+		list = multilist_sublist_lock_idx(ml, sublist_idx);
+		if ((dn = multilist_sublist_head(list)) == NULL) {
+			multilist_sublist_unlock(list);
+			break;
+		}
 		ASSERT(dn->dn_object != DMU_META_DNODE_OBJECT);
 		ASSERT(dn->dn_dbuf->db_data_pending);
 		/*
@@ -1483,10 +1507,15 @@ dmu_objset_sync_dnodes(multilist_sublist_t *list, dmu_tx_t *tx)
 		 * See the comment above dnode_rele_task() for an explanation
 		 * of why this dnode hold is always needed (even when not
 		 * doing user accounting).
+		 *
+		 * os_synced_dnodes shares dn_dirty_link with the dirty list,
+		 * so move the dnode over before dropping the sublist lock;
+		 * dnode_setdirty() checks that link under the same lock.
 		 */
 		multilist_t *newlist = &dn->dn_objset->os_synced_dnodes;
 		(void) dnode_add_ref(dn, newlist);
 		multilist_insert(newlist, dn);
+		multilist_sublist_unlock(list);
 
 		dnode_sync(dn, tx);
 	}
@@ -1561,34 +1590,55 @@ typedef struct sync_dnodes_arg {
 
 static void sync_meta_dnode_task(void *arg);
 
+/*
+ * Drop a reference on soa_count; the last one dispatches
+ * sync_meta_dnode_task.
+ */
+static void
+sync_dnodes_rele(sync_objset_arg_t *soa)
+{
+	mutex_enter(&soa->soa_mutex);
+	ASSERT(soa->soa_count != 0);
+	if (--soa->soa_count != 0) {
+		mutex_exit(&soa->soa_mutex);
+		return;
+	}
+	mutex_exit(&soa->soa_mutex);
+
+	taskq_dispatch_ent(dmu_objset_pool(soa->soa_os)->dp_sync_taskq,
+	    sync_meta_dnode_task, soa, TQ_FRONT, &soa->soa_tq_ent);
+}
+
 static void
 sync_dnodes_task(void *arg)
 {
 	sync_dnodes_arg_t *sda = arg;
 	sync_objset_arg_t *soa = sda->sda_soa;
 	objset_t *os = soa->soa_os;
+	multilist_t *ml = sda->sda_list;
+	int num_sublists = multilist_get_num_sublists(ml);
 
+	/*
+	 * Drain our own sublist, then help with any others which still
+	 * have dirty dnodes, so that a few heavily loaded sublists (e.g.
+	 * one objset with millions of dirty files hashing unevenly) don't
+	 * leave the rest of the sync taskq idle.  Once every task has
+	 * found all sublists empty all dnodes have been synced, so the
+	 * soa_count accounting below is unchanged.
+	 */
 	uint_t allocator = spa_acq_allocator(os->os_spa);
-	multilist_sublist_t *ms =
-	    multilist_sublist_lock_idx(sda->sda_list, sda->sda_sublist_idx);
-
-	dmu_objset_sync_dnodes(ms, soa->soa_tx);
+	for (int i = 0; i < num_sublists; i++) {
+		int idx = (sda->sda_sublist_idx + i) % num_sublists;
 
-	multilist_sublist_unlock(ms);
+		if (i != 0 && multilist_sublist_is_empty_idx(ml, idx))
+			continue;
+		dmu_objset_sync_dnodes(ml, idx, soa->soa_tx);
+	}
 	spa_rel_allocator(os->os_spa, allocator);
 
 	kmem_free(sda, sizeof (*sda));
 
-	mutex_enter(&soa->soa_mutex);
-	ASSERT(soa->soa_count != 0);
-	if (--soa->soa_count != 0) {
-		mutex_exit(&soa->soa_mutex);
-		return;
-	}
-	mutex_exit(&soa->soa_mutex);
-
-	taskq_dispatch_ent(dmu_objset_pool(os)->dp_sync_taskq,
-	    sync_meta_dnode_task, soa, TQ_FRONT, &soa->soa_tq_ent);
+	sync_dnodes_rele(soa);
 }
 
 /*
@@ -1737,36 +1787,31 @@ dmu_objset_sync(objset_t *os, zio_t *pio, dmu_tx_t *tx)
 	mutex_init(&soa->soa_mutex, NULL, MUTEX_DEFAULT, NULL);
 
 	ml = &os->os_dirty_dnodes[txgoff];
-	soa->soa_count = num_sublists = multilist_get_num_sublists(ml);
+	num_sublists = multilist_get_num_sublists(ml);
 
+	/*
+	 * Sync sublists in parallel. The last to finish (i.e., when
+	 * soa->soa_count reaches zero) must dispatch sync_meta_dnode_task.
+	 * We hold a reference of our own while dispatching, because tasks
+	 * which have already started may drain sublists we haven't yet
+	 * dispatched a task for.
+	 */
+	soa->soa_count = 1;
 	for (int i = 0; i < num_sublists; i++) {
 		if (multilist_sublist_is_empty_idx(ml, i))
-			soa->soa_count--;
-	}
-
-	if (soa->soa_count == 0) {
-		taskq_dispatch_ent(dmu_objset_pool(os)->dp_sync_taskq,
-		    sync_meta_dnode_task, soa, TQ_FRONT, &soa->soa_tq_ent);
-	} else {
-		/*
-		 * Sync sublists in parallel. The last to finish
-		 * (i.e., when soa->soa_count reaches zero) must
-		 *  dispatch sync_meta_dnode_task.
-		 */
-		for (int i = 0; i < num_sublists; i++) {
-			if (multilist_sublist_is_empty_idx(ml, i))
-				continue;
-			sync_dnodes_arg_t *sda =
-			    kmem_alloc(sizeof (*sda), KM_SLEEP);
-			sda->sda_list = ml;
-			sda->sda_sublist_idx = i;
-			sda->sda_soa = soa;
-			(void) taskq_dispatch(
-			    dmu_objset_pool(os)->dp_sync_taskq,
-			    sync_dnodes_task, sda, 0);
-			/* sync_dnodes_task frees sda */
-		}
+			continue;
+		sync_dnodes_arg_t *sda = kmem_alloc(sizeof (*sda), KM_SLEEP);
+		sda->sda_list = ml;
+		sda->sda_sublist_idx = i;
+		sda->sda_soa = soa;
+		mutex_enter(&soa->soa_mutex);
+		soa->soa_count++;
+		mutex_exit(&soa->soa_mutex);
+		(void) taskq_dispatch(dmu_objset_pool(os)->dp_sync_taskq,
+		    sync_dnodes_task, sda, 0);
+		/* sync_dnodes_task frees sda */
 	}
+	sync_dnodes_rele(soa);
 }
 
 boolean_t
@@ -1456,9 +1456,14 @@ do_corrective_recv(struct receive_writer_arg *rwa, struct drr_write *drrw,
 		/* Recompress the data */
 		abd_t *cabd = abd_alloc_linear(BP_GET_PSIZE(bp),
 		    B_FALSE);
+		uint8_t complevel = rwa->os->os_complevel;
+		if (rwa->os->os_zstd_frames) {
+			complevel = zio_complevel_frames(BP_GET_COMPRESS(bp),
+			    complevel);
+		}
 		uint64_t csize = zio_compress_data(BP_GET_COMPRESS(bp),
 		    abd, &cabd, abd_get_size(abd), BP_GET_PSIZE(bp),
-		    rwa->os->os_complevel);
+		    complevel);
 		abd_zero_off(cabd, csize, BP_GET_PSIZE(bp) - csize);
 		/* Swap in newly compressed data into the abd */
 		abd_free(abd);
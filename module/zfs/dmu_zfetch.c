@@ -70,6 +70,10 @@ static unsigned int	zfetch_max_idistance = 128 * 1024 * 1024;
 static unsigned int	zfetch_max_reorder = 16 * 1024 * 1024;
 /* Max log2 fraction of holes in a stream */
 static unsigned int	zfetch_hole_shift = 2;
+/* max distance between accesses of a strided stream (default 16MB) */
+static unsigned int	zfetch_max_stride = 16 * 1024 * 1024;
+
+#define	ZFETCH_HISTORY_EMPTY	UINT64_MAX
 
 typedef struct zfetch_stats {
 	kstat_named_t zfetchstat_hits;
@@ -78,6 +82,12 @@ typedef struct zfetch_stats {
 	kstat_named_t zfetchstat_past;
 	kstat_named_t zfetchstat_misses;
 	kstat_named_t zfetchstat_max_streams;
+	kstat_named_t zfetchstat_stride_streams;
+	kstat_named_t zfetchstat_stride_hits;
+	kstat_named_t zfetchstat_stride_misses;
+	kstat_named_t zfetchstat_reverse_streams;
+	kstat_named_t zfetchstat_reverse_hits;
+	kstat_named_t zfetchstat_reverse_misses;
 	kstat_named_t zfetchstat_io_issued;
 	kstat_named_t zfetchstat_io_active;
 } zfetch_stats_t;
@@ -89,6 +99,12 @@ static zfetch_stats_t zfetch_stats = {
 	{ "past",			KSTAT_DATA_UINT64 },
 	{ "misses",			KSTAT_DATA_UINT64 },
 	{ "max_streams",		KSTAT_DATA_UINT64 },
+	{ "stride_streams",		KSTAT_DATA_UINT64 },
+	{ "stride_hits",		KSTAT_DATA_UINT64 },
+	{ "stride_misses",		KSTAT_DATA_UINT64 },
+	{ "reverse_streams",		KSTAT_DATA_UINT64 },
+	{ "reverse_hits",		KSTAT_DATA_UINT64 },
+	{ "reverse_misses",		KSTAT_DATA_UINT64 },
 	{ "io_issued",			KSTAT_DATA_UINT64 },
 	{ "io_active",			KSTAT_DATA_UINT64 },
 };
@@ -100,6 +116,12 @@ struct {
 	wmsum_t zfetchstat_past;
 	wmsum_t zfetchstat_misses;
 	wmsum_t zfetchstat_max_streams;
+	wmsum_t zfetchstat_stride_streams;
+	wmsum_t zfetchstat_stride_hits;
+	wmsum_t zfetchstat_stride_misses;
+	wmsum_t zfetchstat_reverse_streams;
+	wmsum_t zfetchstat_reverse_hits;
+	wmsum_t zfetchstat_reverse_misses;
 	wmsum_t zfetchstat_io_issued;
 	aggsum_t zfetchstat_io_active;
 } zfetch_sums;
@@ -131,6 +153,18 @@ zfetch_kstats_update(kstat_t *ksp, int rw)
 	    wmsum_value(&zfetch_sums.zfetchstat_misses);
 	zs->zfetchstat_max_streams.value.ui64 =
 	    wmsum_value(&zfetch_sums.zfetchstat_max_streams);
+	zs->zfetchstat_stride_streams.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_stride_streams);
+	zs->zfetchstat_stride_hits.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_stride_hits);
+	zs->zfetchstat_stride_misses.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_stride_misses);
+	zs->zfetchstat_reverse_streams.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_reverse_streams);
+	zs->zfetchstat_reverse_hits.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_reverse_hits);
+	zs->zfetchstat_reverse_misses.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_reverse_misses);
 	zs->zfetchstat_io_issued.value.ui64 =
 	    wmsum_value(&zfetch_sums.zfetchstat_io_issued);
 	zs->zfetchstat_io_active.value.ui64 =
@@ -147,6 +181,12 @@ zfetch_init(void)
 	wmsum_init(&zfetch_sums.zfetchstat_past, 0);
 	wmsum_init(&zfetch_sums.zfetchstat_misses, 0);
 	wmsum_init(&zfetch_sums.zfetchstat_max_streams, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_stride_streams, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_stride_hits, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_stride_misses, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_reverse_streams, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_reverse_hits, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_reverse_misses, 0);
 	wmsum_init(&zfetch_sums.zfetchstat_io_issued, 0);
 	aggsum_init(&zfetch_sums.zfetchstat_io_active, 0);
 
@@ -175,6 +215,12 @@ zfetch_fini(void)
 	wmsum_fini(&zfetch_sums.zfetchstat_past);
 	wmsum_fini(&zfetch_sums.zfetchstat_misses);
 	wmsum_fini(&zfetch_sums.zfetchstat_max_streams);
+	wmsum_fini(&zfetch_sums.zfetchstat_stride_streams);
+	wmsum_fini(&zfetch_sums.zfetchstat_stride_hits);
+	wmsum_fini(&zfetch_sums.zfetchstat_stride_misses);
+	wmsum_fini(&zfetch_sums.zfetchstat_reverse_streams);
+	wmsum_fini(&zfetch_sums.zfetchstat_reverse_hits);
+	wmsum_fini(&zfetch_sums.zfetchstat_reverse_misses);
 	wmsum_fini(&zfetch_sums.zfetchstat_io_issued);
 	ASSERT0(aggsum_value(&zfetch_sums.zfetchstat_io_active));
 	aggsum_fini(&zfetch_sums.zfetchstat_io_active);
@@ -192,6 +238,9 @@ dmu_zfetch_init(zfetch_t *zf, dnode_t *dno)
 		return;
 	zf->zf_dnode = dno;
 	zf->zf_numstreams = 0;
+	zf->zf_history_next = 0;
+	for (int i = 0; i < ZFETCH_HISTORY; i++)
+		zf->zf_history[i] = ZFETCH_HISTORY_EMPTY;
 
 	list_create(&zf->zf_stream, sizeof (zstream_t),
 	    offsetof(zstream_t, zs_node));
@@ -243,8 +292,9 @@ dmu_zfetch_fini(zfetch_t *zf)
  * In process delete/reuse all streams without hits for zfetch_max_sec_reap.
  * If needed, reuse oldest stream without hits for zfetch_min_sec_reap or ever.
  * The "blkid" argument is the next block that we expect this stream to access.
+ * Returns the new stream, or NULL if there are too many active ones.
  */
-static void
+static zstream_t *
 dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 {
 	zstream_t *zs, *zs_next, *zs_old = NULL;
@@ -302,7 +352,7 @@ dmu_zfetch_stream_create(zfetch_t *zf, uint64_t blkid)
 			goto reuse;
 		}
 		ZFETCHSTAT_BUMP(zfetchstat_max_streams);
-		return;
+		return (NULL);
 	}
 
 	zs = kmem_zalloc(sizeof (*zs), KM_SLEEP);
@@ -326,6 +376,53 @@ reuse:
 	zs->zs_ipf_end = blkid;
 	zs->zs_missed = B_FALSE;
 	zs->zs_more = B_FALSE;
+	zs->zs_stride = 0;
+	zs->zs_stride_base = 0;
+	zs->zs_stride_nblks = 0;
+	return (zs);
+}
+
+/*
+ * Remember the start of an access which did not continue any stream, and
+ * check whether it extends a fixed stride formed by two earlier ones.  As
+ * all pairs of remembered accesses are checked, this also finds strided or
+ * backward streams interleaved with other accesses to the file.  Returns
+ * the stride in blocks, or zero if none was found.
+ */
+static int64_t
+dmu_zfetch_stride_detect(zfetch_t *zf, uint64_t blkid, uint64_t nblks)
+{
+	int64_t max_stride = zfetch_max_stride >> zf->zf_dnode->dn_datablkshift;
+	uint64_t *h = zf->zf_history;
+	int64_t stride;
+	uint_t i, j;
+
+	ASSERT(MUTEX_HELD(&zf->zf_lock));
+
+	if (max_stride == 0)
+		return (0);
+
+	for (i = 0; i < ZFETCH_HISTORY; i++) {
+		if (h[i] == ZFETCH_HISTORY_EMPTY)
+			continue;
+		stride = (int64_t)(blkid - h[i]);
+		if (ABS(stride) < MAX(nblks, 1) || ABS(stride) > max_stride)
+			continue;
+		for (j = 0; j < ZFETCH_HISTORY; j++) {
+			if (j != i && h[j] != ZFETCH_HISTORY_EMPTY &&
+			    (int64_t)(h[i] - h[j]) == stride)
+				goto found;
+		}
+	}
+
+	h[zf->zf_history_next] = blkid;
+	zf->zf_history_next = (zf->zf_history_next + 1) % ZFETCH_HISTORY;
+	return (0);
+
+found:
+	/* The accesses now belong to the strided stream. */
+	h[i] = h[j] = ZFETCH_HISTORY_EMPTY;
+	return (stride);
 }
 
 static void
@@ -333,7 +430,10 @@ dmu_zfetch_done(void *arg, uint64_t level, uint64_t blkid, boolean_t io_issued)
 {
 	zstream_t *zs = arg;
 
-	if (io_issued && level == 0 && blkid < zs->zs_blkid)
+	/* The demand accesses got to the block before its prefetch did. */
+	if (io_issued && level == 0 && (zs->zs_stride < 0 ?
+	    blkid >= zs->zs_blkid + zs->zs_stride_nblks :
+	    blkid < zs->zs_blkid))
 		zs->zs_more = B_TRUE;
 	if (zfs_refcount_remove(&zs->zs_refs, NULL) == 0)
 		dmu_zfetch_stream_fini(zs);
@@ -454,6 +554,34 @@ dmu_zfetch_future(zstream_t *zs, uint64_t blkid, uint64_t nblks)
 	return (0);
 }
 
+/*
+ * Calculate the data prefetch distance of a stream on a hit.
+ *
+ * Start prefetch from the demand access size (nbytes).  Double the distance
+ * every access up to zfetch_min_distance.  After that only if needed increase
+ * the distance by 1/8 up to zfetch_max_distance.
+ *
+ * Don't double the distance beyond single block if we have more than ~6% of
+ * ARC held by active prefetches.  It should help with getting out of RAM on
+ * some badly mispredicted read patterns.
+ */
+static void
+dmu_zfetch_pf_dist(zstream_t *zs, unsigned int nbytes, unsigned int dbs)
+{
+	if (unlikely(zs->zs_pf_dist < nbytes))
+		zs->zs_pf_dist = nbytes;
+	else if (zs->zs_pf_dist < zfetch_min_distance &&
+	    (zs->zs_pf_dist < (1 << dbs) ||
+	    aggsum_compare(&zfetch_sums.zfetchstat_io_active,
+	    arc_c_max >> (4 + dbs)) < 0))
+		zs->zs_pf_dist *= 2;
+	else if (zs->zs_more)
+		zs->zs_pf_dist += zs->zs_pf_dist / 8;
+	zs->zs_more = B_FALSE;
+	if (zs->zs_pf_dist > zfetch_max_distance)
+		zs->zs_pf_dist = zfetch_max_distance;
+}
+
 /*
  * This is the predictive prefetch entry point.  dmu_zfetch_prepare()
  * associates dnode access specified with blkid and nblks arguments with
@@ -473,7 +601,7 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	zstream_t *zs;
 	spa_t *spa = zf->zf_dnode->dn_objset->os_spa;
 	zfs_prefetch_type_t os_prefetch = zf->zf_dnode->dn_objset->os_prefetch;
-	int64_t ipf_start, ipf_end;
+	int64_t ipf_start, ipf_end, stride;
 
 	if (zfs_prefetch_disable || os_prefetch == ZFS_PREFETCH_NONE)
 		return (NULL);
@@ -522,6 +650,11 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	uint64_t end_blkid = blkid + nblks;
 	for (zs = list_head(&zf->zf_stream); zs != NULL;
 	    zs = list_next(&zf->zf_stream, zs)) {
+		if (zs->zs_stride != 0) {
+			if (blkid == zs->zs_blkid)
+				goto stride_hit;
+			continue;
+		}
 		if (blkid == zs->zs_blkid) {
 			goto hit;
 		} else if (blkid + 1 == zs->zs_blkid) {
@@ -537,11 +670,15 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	 * a hit for metadata prefetch, since we do not care about fill percent,
 	 * or stored for future otherwise.  Access behind stream position is
 	 * silently ignored, since we already skipped it reaching fill percent.
+	 * Data accesses which do not extend a stream may still form a strided
+	 * or backward stream with earlier ones, which is checked for instead.
 	 */
 	uint_t max_reorder = MIN((zfetch_max_reorder >> dbs) + 1, UINT16_MAX);
 	uint_t t = gethrestime_sec() - zfetch_max_sec_reap;
 	for (zs = list_head(&zf->zf_stream); zs != NULL;
 	    zs = list_next(&zf->zf_stream, zs)) {
+		if (zs->zs_stride != 0)
+			continue;
 		if (blkid > zs->zs_blkid) {
 			if (end_blkid <= zs->zs_blkid + max_reorder) {
 				if (!fetch_data) {
@@ -551,10 +688,15 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 					goto future;
 				}
 				nblks = dmu_zfetch_future(zs, blkid, nblks);
-				if (nblks > 0)
+				if (nblks > 0) {
 					ZFETCHSTAT_BUMP(zfetchstat_stride);
-				else
-					ZFETCHSTAT_BUMP(zfetchstat_future);
+					goto future;
+				}
+				stride = dmu_zfetch_stride_detect(zf, blkid,
+				    end_blkid - blkid);
+				if (stride != 0)
+					goto stride_start;
+				ZFETCHSTAT_BUMP(zfetchstat_future);
 				goto future;
 			}
 		} else if (end_blkid >= zs->zs_blkid) {
@@ -563,6 +705,12 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 			goto hit;
 		} else if (end_blkid + max_reorder > zs->zs_blkid &&
 		    (int)(zs->zs_atime - t) >= 0) {
+			if (fetch_data) {
+				stride = dmu_zfetch_stride_detect(zf, blkid,
+				    nblks);
+				if (stride != 0)
+					goto stride_start;
+			}
 			ZFETCHSTAT_BUMP(zfetchstat_past);
 			zs->zs_atime = gethrestime_sec();
 			goto out;
@@ -574,13 +722,99 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	 * stream for it unless we are at the end of file.
 	 */
 	ASSERT0P(zs);
+	if (fetch_data) {
+		stride = dmu_zfetch_stride_detect(zf, blkid, nblks);
+		if (stride != 0)
+			goto stride_start;
+	}
 	if (end_blkid < maxblkid)
-		dmu_zfetch_stream_create(zf, end_blkid);
+		(void) dmu_zfetch_stream_create(zf, end_blkid);
 	mutex_exit(&zf->zf_lock);
 	ZFETCHSTAT_BUMP(zfetchstat_misses);
 	ipf_start = 0;
 	goto prescient;
 
+stride_start:
+	/*
+	 * Turn the stream the access was attributed to, or else the one
+	 * created by the previous access of the pattern, into the strided
+	 * one, unless it ever made progress or is in use.
+	 */
+	if (zs == NULL) {
+		for (zs = list_head(&zf->zf_stream); zs != NULL;
+		    zs = list_next(&zf->zf_stream, zs)) {
+			if (zs->zs_stride == 0 &&
+			    zs->zs_blkid == end_blkid - stride)
+				break;
+		}
+	}
+	if (zs == NULL || zs->zs_ipf_dist != 0 ||
+	    zfs_refcount_count(&zs->zs_refs) != 1) {
+		zs = dmu_zfetch_stream_create(zf, blkid);
+		if (zs == NULL)
+			goto out;
+	}
+	memset(zs->zs_ranges, 0, sizeof (zs->zs_ranges));
+	zs->zs_blkid = blkid;
+	zs->zs_stride = stride;
+	zs->zs_stride_base = blkid;
+	zs->zs_stride_nblks = end_blkid - blkid;
+	zs->zs_pf_start = zs->zs_pf_end = 0;
+	zs->zs_ipf_start = zs->zs_ipf_end = 0;
+	if (stride < 0)
+		ZFETCHSTAT_BUMP(zfetchstat_reverse_streams);
+	else
+		ZFETCHSTAT_BUMP(zfetchstat_stride_streams);
+
+stride_hit:
+	if (zs->zs_stride < 0)
+		ZFETCHSTAT_BUMP(zfetchstat_reverse_hits);
+	else
+		ZFETCHSTAT_BUMP(zfetchstat_stride_hits);
+	zs->zs_atime = gethrestime_sec();
+
+	/*
+	 * The accesses of a strided stream are numbered from zs_stride_base;
+	 * "step" is the number of the next one expected.  Remove the stream
+	 * once that would be outside of the file.
+	 */
+	stride = zs->zs_stride;
+	uint64_t step = (int64_t)(blkid - zs->zs_stride_base) / stride + 1;
+	uint64_t last_step;
+	if (stride < 0)
+		last_step = zs->zs_stride_base / -stride;
+	else if (zs->zs_stride_base <= maxblkid)
+		last_step = (maxblkid - zs->zs_stride_base) / stride;
+	else
+		last_step = 0;
+	if (step > last_step) {
+		dmu_zfetch_stream_remove(zf, zs);
+		goto out;
+	}
+	zs->zs_blkid = zs->zs_stride_base + step * stride;
+
+	/*
+	 * Prefetch the data of as many of the following accesses as fit into
+	 * the prefetch distance.  Indirect blocks are read as needed by the
+	 * data prefetches, as they are not contiguous ahead of the stream.
+	 */
+	if (fetch_data) {
+		unsigned int step_bytes = zs->zs_stride_nblks << dbs;
+		dmu_zfetch_pf_dist(zs, step_bytes, dbs);
+		uint64_t pf_steps = MAX(zs->zs_pf_dist / step_bytes, 1);
+		if (zs->zs_pf_start < step)
+			zs->zs_pf_start = step;
+		if (zs->zs_pf_end < MIN(step + pf_steps, last_step + 1))
+			zs->zs_pf_end = MIN(step + pf_steps, last_step + 1);
+	}
+
+	zfs_refcount_add(&zs->zs_refs, NULL);
+	/* Count concurrent callers. */
+	zfs_refcount_add(&zs->zs_callers, NULL);
+	mutex_exit(&zf->zf_lock);
+	ipf_start = 0;
+	goto prescient;
+
 hit:
 	nblks = dmu_zfetch_hit(zs, nblks);
 	ZFETCHSTAT_BUMP(zfetchstat_hits);
@@ -606,30 +840,11 @@ out:
 	/*
 	 * This access was to a block that we issued a prefetch for on
 	 * behalf of this stream.  Calculate further prefetch distances.
-	 *
-	 * Start prefetch from the demand access size (nblks).  Double the
-	 * distance every access up to zfetch_min_distance.  After that only
-	 * if needed increase the distance by 1/8 up to zfetch_max_distance.
-	 *
-	 * Don't double the distance beyond single block if we have more
-	 * than ~6% of ARC held by active prefetches.  It should help with
-	 * getting out of RAM on some badly mispredicted read patterns.
 	 */
 	unsigned int nbytes = nblks << dbs;
 	unsigned int pf_nblks;
 	if (fetch_data) {
-		if (unlikely(zs->zs_pf_dist < nbytes))
-			zs->zs_pf_dist = nbytes;
-		else if (zs->zs_pf_dist < zfetch_min_distance &&
-		    (zs->zs_pf_dist < (1 << dbs) ||
-		    aggsum_compare(&zfetch_sums.zfetchstat_io_active,
-		    arc_c_max >> (4 + dbs)) < 0))
-			zs->zs_pf_dist *= 2;
-		else if (zs->zs_more)
-			zs->zs_pf_dist += zs->zs_pf_dist / 8;
-		zs->zs_more = B_FALSE;
-		if (zs->zs_pf_dist > zfetch_max_distance)
-			zs->zs_pf_dist = zfetch_max_distance;
+		dmu_zfetch_pf_dist(zs, nbytes, dbs);
 		pf_nblks = zs->zs_pf_dist >> dbs;
 	} else {
 		pf_nblks = 0;
@@ -693,10 +908,17 @@ dmu_zfetch_run(zfetch_t *zf, zstream_t *zs, boolean_t missed,
     boolean_t have_lock, boolean_t uncached)
 {
 	int64_t pf_start, pf_end, ipf_start, ipf_end;
+	int64_t stride, base;
+	uint64_t nblks;
 	int epbs, issued;
 
-	if (missed)
+	if (missed) {
 		zs->zs_missed = missed;
+		if (zs->zs_stride < 0)
+			ZFETCHSTAT_BUMP(zfetchstat_reverse_misses);
+		else if (zs->zs_stride > 0)
+			ZFETCHSTAT_BUMP(zfetchstat_stride_misses);
+	}
 
 	/*
 	 * Postpone the prefetch if there are more concurrent callers.
@@ -719,6 +941,20 @@ dmu_zfetch_run(zfetch_t *zf, zstream_t *zs, boolean_t missed,
 	}
 	ipf_start = zs->zs_ipf_start;
 	ipf_end = zs->zs_ipf_start = zs->zs_ipf_end;
+
+	/*
+	 * For strided streams the data range counts accesses, each of
+	 * nblks blocks; sequential streams are a stride of one block.
+	 */
+	if (zs->zs_stride != 0) {
+		stride = zs->zs_stride;
+		base = zs->zs_stride_base;
+		nblks = zs->zs_stride_nblks;
+	} else {
+		stride = 1;
+		base = 0;
+		nblks = 1;
+	}
 	mutex_exit(&zf->zf_lock);
 	ASSERT3S(pf_start, <=, pf_end);
 	ASSERT3S(ipf_start, <=, ipf_end);
@@ -727,7 +963,7 @@ dmu_zfetch_run(zfetch_t *zf, zstream_t *zs, boolean_t missed,
 	ipf_start = P2ROUNDUP(ipf_start, 1 << epbs) >> epbs;
 	ipf_end = P2ROUNDUP(ipf_end, 1 << epbs) >> epbs;
 	ASSERT3S(ipf_start, <=, ipf_end);
-	issued = pf_end - pf_start + ipf_end - ipf_start;
+	issued = (pf_end - pf_start) * nblks + ipf_end - ipf_start;
 	if (issued > 1) {
 		/* More references on top of taken in dmu_zfetch_prepare(). */
 		zfs_refcount_add_few(&zs->zs_refs, issued - 1, NULL);
@@ -743,10 +979,13 @@ dmu_zfetch_run(zfetch_t *zf, zstream_t *zs, boolean_t missed,
 		rw_enter(&zf->zf_dnode->dn_struct_rwlock, RW_READER);
 
 	issued = 0;
-	for (int64_t blk = pf_start; blk < pf_end; blk++) {
-		issued += dbuf_prefetch_impl(zf->zf_dnode, 0, blk,
-		    ZIO_PRIORITY_ASYNC_READ, uncached ?
-		    ARC_FLAG_UNCACHED : 0, dmu_zfetch_done, zs);
+	for (int64_t pf = pf_start; pf < pf_end; pf++) {
+		for (uint64_t i = 0; i < nblks; i++) {
+			issued += dbuf_prefetch_impl(zf->zf_dnode, 0,
+			    base + pf * stride + i, ZIO_PRIORITY_ASYNC_READ,
+			    uncached ? ARC_FLAG_UNCACHED : 0, dmu_zfetch_done,
+			    zs);
+		}
 	}
 	for (int64_t iblk = ipf_start; iblk < ipf_end; iblk++) {
 		issued += dbuf_prefetch_impl(zf->zf_dnode, 1, iblk,
@@ -797,3 +1036,6 @@ ZFS_MODULE_PARAM(zfs_prefetch, zfetch_, max_reorder, UINT, ZMOD_RW,
 
 ZFS_MODULE_PARAM(zfs_prefetch, zfetch_, hole_shift, UINT, ZMOD_RW,
 	"Max log2 fraction of holes in a stream");
+
+ZFS_MODULE_PARAM(zfs_prefetch, zfetch_, max_stride, UINT, ZMOD_RW,
+	"Max distance between accesses of a strided stream");
@@ -4669,6 +4669,10 @@ dsl_dataset_set_compression_check(void *arg, dmu_tx_t *tx)
 	if (!spa_feature_is_enabled(dp->dp_spa, f))
 		return (SET_ERROR(ENOTSUP));
 
+	if (ZIO_COMPRESS_LEVEL(ddsca->ddsca_value) == ZIO_ZSTD_LEVEL_AUTO &&
+	    !spa_feature_is_enabled(dp->dp_spa, SPA_FEATURE_COMPRESS_ADAPTIVE))
+		return (SET_ERROR(ENOTSUP));
+
 	return (0);
 }
 
@@ -4691,6 +4695,19 @@ dsl_dataset_set_compression_sync(void *arg, dmu_tx_t *tx)
 		    ds->ds_feature_activation[f], tx);
 		ds->ds_feature[f] = ds->ds_feature_activation[f];
 	}
+
+	/*
+	 * compression=adaptive is stored as a zstd level that older
+	 * releases do not know, so it has a feature of its own.
+	 */
+	f = SPA_FEATURE_COMPRESS_ADAPTIVE;
+	if (ZIO_COMPRESS_LEVEL(ddsca->ddsca_value) == ZIO_ZSTD_LEVEL_AUTO &&
+	    zfeature_active(f, ds->ds_feature[f]) != B_TRUE) {
+		ds->ds_feature_activation[f] = (void *)B_TRUE;
+		dsl_dataset_activate_feature(ds->ds_object, f,
+		    ds->ds_feature_activation[f], tx);
+		ds->ds_feature[f] = ds->ds_feature_activation[f];
+	}
 	dsl_dataset_rele(ds, FTAG);
 }
 
@@ -4702,7 +4719,7 @@ dsl_dataset_set_compression(const char *dsname, zprop_source_t source,
 
 	/*
 	 * The sync task is only required for zstd in order to activate
-	 * the feature flag when the property is first set.
+	 * the feature flags when the property is first set.
 	 */
 	if (ZIO_COMPRESS_ALGO(compression) != ZIO_COMPRESS_ZSTD)
 		return (0);
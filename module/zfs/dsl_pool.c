@@ -682,11 +682,13 @@ dsl_pool_sync(dsl_pool_t *dp, uint64_t txg)
 	dsl_dataset_t *ds;
 	objset_t *mos = dp->dp_meta_objset;
 	list_t synced_datasets;
+	hrtime_t start;
 
 	list_create(&synced_datasets, sizeof (dsl_dataset_t),
 	    offsetof(dsl_dataset_t, ds_synced_link));
 
 	tx = dmu_tx_create_assigned(dp, txg);
+	start = gethrtime();
 
 	/*
 	 * Run all early sync tasks before writing out any dirty blocks.
@@ -703,6 +705,8 @@ dsl_pool_sync(dsl_pool_t *dp, uint64_t txg)
 			dsl_sync_task_sync(dst, tx);
 		}
 		ASSERT(dsl_early_sync_task_verify(dp, txg));
+		spa_sync_phase_add(dp->dp_spa, SPA_SYNC_PHASE_SYNCTASKS,
+		    &start);
 	}
 
 	/*
@@ -721,6 +725,7 @@ dsl_pool_sync(dsl_pool_t *dp, uint64_t txg)
 		dsl_dataset_sync(ds, rio, tx);
 	}
 	VERIFY0(zio_wait(rio));
+	spa_sync_phase_add(dp->dp_spa, SPA_SYNC_PHASE_DATASETS, &start);
 
 	/*
 	 * Update the long range free counter after
@@ -771,6 +776,7 @@ dsl_pool_sync(dsl_pool_t *dp, uint64_t txg)
 		}
 	}
 	VERIFY0(zio_wait(rio));
+	spa_sync_phase_add(dp->dp_spa, SPA_SYNC_PHASE_USERSPACE, &start);
 
 	/*
 	 * Now that the datasets have been completely synced, we can
@@ -817,6 +823,7 @@ dsl_pool_sync(dsl_pool_t *dp, uint64_t txg)
 	if (dmu_objset_is_dirty(mos, txg)) {
 		dsl_pool_sync_mos(dp, tx);
 	}
+	spa_sync_phase_add(dp->dp_spa, SPA_SYNC_PHASE_MOS, &start);
 
 	/*
 	 * We have written all of the accounted dirty data, so our
@@ -851,6 +858,8 @@ dsl_pool_sync(dsl_pool_t *dp, uint64_t txg)
 		ASSERT3U(spa_sync_pass(dp->dp_spa), ==, 1);
 		while ((dst = txg_list_remove(&dp->dp_sync_tasks, txg)) != NULL)
 			dsl_sync_task_sync(dst, tx);
+		spa_sync_phase_add(dp->dp_spa, SPA_SYNC_PHASE_SYNCTASKS,
+		    &start);
 	}
 
 	dmu_tx_commit(tx);
@@ -40,9 +40,17 @@
  * It also contains a couple of defines from the old lz4.c to make things
  * fit together smoothly.
  *
+ * The one functional change is a simd_directive for the fast decode loop,
+ * which lets the literal and match copies use SSE2, SSSE3 or AVX2 on
+ * x86_64; the implementation is selected at runtime (see lz4_zfs.c).
+ * The vector variants restart their FPU section every LZ4_FPU_CHUNK bytes
+ * of output rather than holding it for the whole block.
+ *
  */
 
 #include <sys/zfs_context.h>
+#include <sys/simd.h>
+#include <sys/lz4_impl.h>
 
 int LZ4_uncompress_unknownOutputSize(const char *source, char *dest,
     int isize, int maxOutputSize);
@@ -492,6 +500,227 @@ typedef enum { noDictIssue = 0, dictSmall } dictIssue_directive;
 typedef enum { endOnOutputSize = 0, endOnInputSize = 1 } endCondition_directive;
 typedef enum { decode_full_block = 0, partial_decode = 1 } earlyEnd_directive;
 
+typedef enum { noSimd = 0, withSSE2, withSSSE3, withAVX2 } simd_directive;
+
+#if LZ4_FAST_DEC_LOOP && defined(__x86_64)
+/*
+ * ZFS: vector variants of the fast loop's copy helpers.  Each asm
+ * statement loads and stores its own data, so no vector state is live
+ * between statements.  In the kernel nothing else uses the vector
+ * registers (and naming them would trip -mno-sse); in user space the
+ * compiler has to be told that xmm0/ymm0 is scratch.  The AVX2 variant
+ * only uses VEX encoded instructions so that it never pays for SSE/AVX
+ * transitions; its caller issues vzeroupper when done.
+ */
+#ifdef _KERNEL
+#define LZ4_VEC_CLOBBERS "cc", "memory"
+#else
+#define LZ4_VEC_CLOBBERS "cc", "memory", "xmm0"
+#endif
+
+#define LZ4_VEC_COPY32_LOOP(mov)                  \
+    "1:\n\t"                                      \
+    mov " (%[s]), %%xmm0\n\t"                     \
+    mov " %%xmm0, (%[d])\n\t"                     \
+    mov " 16(%[s]), %%xmm0\n\t"                   \
+    mov " %%xmm0, 16(%[d])\n\t"                   \
+    "add $32, %[s]\n\t"                           \
+    "add $32, %[d]\n\t"                           \
+    "cmp %[e], %[d]\n\t"                          \
+    "jb 1b\n\t"
+
+/* pshufb masks which repeat the first `offset` bytes across 16 bytes */
+static const BYTE lz4_pattern_shuffle[16][16] __attribute__((aligned(16))) = {
+    {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+    {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+    {  0,  1,  0,  1,  0,  1,  0,  1,  0,  1,  0,  1,  0,  1,  0,  1 },
+    {  0,  1,  2,  0,  1,  2,  0,  1,  2,  0,  1,  2,  0,  1,  2,  0 },
+    {  0,  1,  2,  3,  0,  1,  2,  3,  0,  1,  2,  3,  0,  1,  2,  3 },
+    {  0,  1,  2,  3,  4,  0,  1,  2,  3,  4,  0,  1,  2,  3,  4,  0 },
+    {  0,  1,  2,  3,  4,  5,  0,  1,  2,  3,  4,  5,  0,  1,  2,  3 },
+    {  0,  1,  2,  3,  4,  5,  6,  0,  1,  2,  3,  4,  5,  6,  0,  1 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  0,  1,  2,  3,  4,  5,  6,  7 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  0,  1,  2,  3,  4,  5,  6 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  0,  1,  2,  3,  4,  5 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10,  0,  1,  2,  3,  4 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11,  0,  1,  2,  3 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12,  0,  1,  2 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13,  0,  1 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,  0 },
+};
+
+/* largest multiple of `offset` that fits in 16 bytes (offset 0 is invalid input) */
+static const size_t lz4_pattern_step[16] = {
+    16, 16, 16, 15, 16, 15, 12, 14, 16, 9, 10, 11, 12, 13, 14, 15
+};
+#endif
+
+#if LZ4_FAST_DEC_LOOP
+/*
+ * ZFS: the vector variants run with the FPU held, which in the kernel
+ * also means with preemption disabled.  To keep that bounded for large
+ * blocks the decoder ends and restarts its FPU section every
+ * LZ4_FPU_CHUNK bytes of output, both between sequences and within long
+ * literal and match copies.  No vector state is live across the break.
+ */
+#define LZ4_FPU_CHUNK (64 KB)
+
+LZ4_FORCE_INLINE void
+LZ4_fpu_yield(simd_directive simd)
+{
+#if defined(__x86_64) && defined(HAVE_AVX2)
+    if (simd == withAVX2)
+        __asm__ __volatile__("vzeroupper" : : : "memory");
+#endif
+    (void) simd;
+    kfpu_end();
+    kfpu_begin();
+}
+
+/* end of the next chunk of a copy from dstPtr to dstEnd */
+LZ4_FORCE_INLINE BYTE*
+LZ4_fpu_chunk_end(BYTE* dstPtr, BYTE* dstEnd)
+{
+    return (dstEnd - dstPtr > LZ4_FPU_CHUNK) ? dstPtr + LZ4_FPU_CHUNK : dstEnd;
+}
+
+/* copies 16 bytes, used for short literal runs */
+LZ4_FORCE_INLINE void
+LZ4_copy16(void* dstPtr, const void* srcPtr, simd_directive simd)
+{
+#if defined(__x86_64) && defined(HAVE_AVX2)
+    if (simd == withAVX2) {
+        __asm__ __volatile__(
+            "vmovdqu (%[s]), %%xmm0\n\t"
+            "vmovdqu %%xmm0, (%[d])\n\t"
+            : : [d] "r" (dstPtr), [s] "r" (srcPtr) : LZ4_VEC_CLOBBERS);
+        return;
+    }
+#endif
+#if defined(__x86_64) && defined(HAVE_SSE2)
+    if (simd == withSSE2 || simd == withSSSE3) {
+        __asm__ __volatile__(
+            "movdqu (%[s]), %%xmm0\n\t"
+            "movdqu %%xmm0, (%[d])\n\t"
+            : : [d] "r" (dstPtr), [s] "r" (srcPtr) : LZ4_VEC_CLOBBERS);
+        return;
+    }
+#endif
+    (void) simd;
+    LZ4_memcpy(dstPtr, srcPtr, 16);
+}
+
+/* LZ4_wildCopy32() for a source that is at least `offset` bytes behind
+ * the destination; may overwrite up to 32 bytes beyond dstEnd.
+ * Literals pass offset == 32, since they never overlap the output.
+ * Long copies are done LZ4_FPU_CHUNK bytes at a time; each chunk resumes
+ * exactly where the previous one stopped. */
+LZ4_FORCE_INLINE void
+LZ4_wildCopy32_simd(void* dstPtr, const void* srcPtr, void* dstEnd,
+                    size_t offset, simd_directive simd)
+{
+#if defined(__x86_64) && (defined(HAVE_SSE2) || defined(HAVE_AVX2))
+    BYTE* d = (BYTE*)dstPtr;
+    const BYTE* s = (const BYTE*)srcPtr;
+    BYTE* e;
+
+    if (simd != noSimd) {
+        for (;;) {
+            e = LZ4_fpu_chunk_end(d, (BYTE*)dstEnd);
+#if defined(HAVE_AVX2)
+            if (simd == withAVX2 && offset >= 32) {
+                __asm__ __volatile__(
+                    "1:\n\t"
+                    "vmovdqu (%[s]), %%ymm0\n\t"
+                    "vmovdqu %%ymm0, (%[d])\n\t"
+                    "add $32, %[s]\n\t"
+                    "add $32, %[d]\n\t"
+                    "cmp %[e], %[d]\n\t"
+                    "jb 1b\n\t"
+                    : [d] "+r" (d), [s] "+r" (s) : [e] "r" (e)
+                    : LZ4_VEC_CLOBBERS);
+            } else if (simd == withAVX2) {
+                __asm__ __volatile__(LZ4_VEC_COPY32_LOOP("vmovdqu")
+                    : [d] "+r" (d), [s] "+r" (s) : [e] "r" (e)
+                    : LZ4_VEC_CLOBBERS);
+            }
+#endif
+#if defined(HAVE_SSE2)
+            if (simd == withSSE2 || simd == withSSSE3) {
+                __asm__ __volatile__(LZ4_VEC_COPY32_LOOP("movdqu")
+                    : [d] "+r" (d), [s] "+r" (s) : [e] "r" (e)
+                    : LZ4_VEC_CLOBBERS);
+            }
+#endif
+            if (e == (BYTE*)dstEnd)
+                return;
+            LZ4_fpu_yield(simd);
+        }
+    }
+#endif
+    (void) offset;
+    (void) simd;
+    LZ4_wildCopy32(dstPtr, srcPtr, dstEnd);
+}
+
+/* LZ4_memcpy_using_offset() for offset < 16: with pshufb the repeating
+ * pattern is built once and then stored in 16-byte strides, which may
+ * overwrite up to 16 bytes beyond dstEnd.  Each stride is a multiple of
+ * offset, so after a chunk the pattern still lines up with srcPtr. */
+LZ4_FORCE_INLINE void
+LZ4_memcpy_using_offset_simd(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd,
+                             const size_t offset, simd_directive simd)
+{
+    assert(offset < 16);
+#if defined(__x86_64) && (defined(HAVE_SSSE3) || defined(HAVE_AVX2))
+    BYTE* e;
+
+    if (simd == withSSSE3 || simd == withAVX2) {
+        for (;;) {
+            e = LZ4_fpu_chunk_end(dstPtr, dstEnd);
+#if defined(HAVE_AVX2)
+            if (simd == withAVX2) {
+                __asm__ __volatile__(
+                    "vmovdqu (%[s]), %%xmm0\n\t"
+                    "vpshufb (%[m]), %%xmm0, %%xmm0\n\t"
+                    "1:\n\t"
+                    "vmovdqu %%xmm0, (%[d])\n\t"
+                    "add %[step], %[d]\n\t"
+                    "cmp %[e], %[d]\n\t"
+                    "jb 1b\n\t"
+                    : [d] "+r" (dstPtr)
+                    : [s] "r" (srcPtr), [m] "r" (lz4_pattern_shuffle[offset]),
+                      [step] "r" (lz4_pattern_step[offset]), [e] "r" (e)
+                    : LZ4_VEC_CLOBBERS);
+            }
+#endif
+#if defined(HAVE_SSSE3)
+            if (simd == withSSSE3) {
+                __asm__ __volatile__(
+                    "movdqu (%[s]), %%xmm0\n\t"
+                    "pshufb (%[m]), %%xmm0\n\t"
+                    "1:\n\t"
+                    "movdqu %%xmm0, (%[d])\n\t"
+                    "add %[step], %[d]\n\t"
+                    "cmp %[e], %[d]\n\t"
+                    "jb 1b\n\t"
+                    : [d] "+r" (dstPtr)
+                    : [s] "r" (srcPtr), [m] "r" (lz4_pattern_shuffle[offset]),
+                      [step] "r" (lz4_pattern_step[offset]), [e] "r" (e)
+                    : LZ4_VEC_CLOBBERS);
+            }
+#endif
+            if (e == dstEnd)
+                return;
+            LZ4_fpu_yield(simd);
+        }
+    }
+#endif
+    (void) simd;
+    LZ4_memcpy_using_offset(dstPtr, srcPtr, dstEnd, offset);
+}
+#endif
+
 typedef enum { loop_error = -2, initial_error = -1, ok = 0 } variable_length_error;
 
 LZ4_FORCE_INLINE unsigned
@@ -539,7 +768,8 @@ LZ4_decompress_generic(
                  dict_directive dict,                 /* noDict, withPrefix64k, usingExtDict */
                  const BYTE* const lowPrefix,  /* always <= dst, == dst when no prefix */
                  const BYTE* const dictStart,  /* only if dict==usingExtDict */
-                 const size_t dictSize         /* note : = 0 if noDict */
+                 const size_t dictSize,        /* note : = 0 if noDict */
+                 simd_directive simd           /* ZFS: noSimd, withSSE2, withSSSE3, withAVX2 */
                  )
 {
     if ((src == NULL) || (outputSize < 0)) { return -1; }
@@ -586,10 +816,17 @@ LZ4_decompress_generic(
             goto safe_decode;
         }
 
+        /* ZFS: where the FPU section is next restarted, see LZ4_FPU_CHUNK */
+        BYTE* fpuMark = op + LZ4_FPU_CHUNK;
+
         /* Fast loop : decode sequences as long as output < iend-FASTLOOP_SAFE_DISTANCE */
         while (1) {
             /* Main fastloop assertion: We can always wildcopy FASTLOOP_SAFE_DISTANCE */
             assert(oend - op >= FASTLOOP_SAFE_DISTANCE);
+            if (simd != noSimd && unlikely(op >= fpuMark)) {
+                LZ4_fpu_yield(simd);
+                fpuMark = op + LZ4_FPU_CHUNK;
+            }
             if (endOnInput) { assert(ip < iend); }
             token = *ip++;
             length = token >> ML_BITS;  /* literal length */
@@ -609,7 +846,7 @@ LZ4_decompress_generic(
                 LZ4_STATIC_ASSERT(MFLIMIT >= WILDCOPYLENGTH);
                 if (endOnInput) {  /* LZ4_decompress_safe() */
                     if ((cpy>oend-32) || (ip+length>iend-32)) { goto safe_literal_copy; }
-                    LZ4_wildCopy32(op, ip, cpy);
+                    LZ4_wildCopy32_simd(op, ip, cpy, 32, simd);
                 } else {   /* LZ4_decompress_fast() */
                     if (cpy>oend-8) { goto safe_literal_copy; }
                     LZ4_wildCopy8(op, ip, cpy); /* LZ4_decompress_fast() cannot copy more than 8 bytes at a time :
@@ -623,7 +860,7 @@ LZ4_decompress_generic(
                     /* We don't need to check oend, since we check it once for each loop below */
                     if (ip > iend-(16 + 1/*max lit + offset + nextToken*/)) { goto safe_literal_copy; }
                     /* Literals can only be 14, but hope compilers optimize if we copy by a register size */
-                    LZ4_memcpy(op, ip, 16);
+                    LZ4_copy16(op, ip, simd);
                 } else {  /* LZ4_decompress_fast() */
                     /* LZ4_decompress_fast() cannot copy more than 8 bytes at a time :
                      * it doesn't know input length, and relies on end-of-block properties */
@@ -708,9 +945,9 @@ LZ4_decompress_generic(
 
             assert((op <= oend) && (oend-op >= 32));
             if (unlikely(offset<16)) {
-                LZ4_memcpy_using_offset(op, match, cpy, offset);
+                LZ4_memcpy_using_offset_simd(op, match, cpy, offset, simd);
             } else {
-                LZ4_wildCopy32(op, match, cpy);
+                LZ4_wildCopy32_simd(op, match, cpy, offset, simd);
             }
 
             op = cpy;   /* wildcopy correction */
@@ -984,5 +1221,104 @@ int LZ4_uncompress_unknownOutputSize(const char* source, char* dest, int compres
 {
     return LZ4_decompress_generic(source, dest, compressedSize, maxDecompressedSize,
                                   endOnInputSize, decode_full_block, noDict,
-                                  (BYTE*)dest, NULL, 0);
+                                  (BYTE*)dest, NULL, 0, noSimd);
+}
+
+static boolean_t
+lz4_scalar_will_work(void)
+{
+    return (B_TRUE);
+}
+
+const lz4_impl_ops_t lz4_scalar_impl = {
+    .decompress = LZ4_uncompress_unknownOutputSize,
+    .is_supported = lz4_scalar_will_work,
+    .name = "scalar"
+};
+
+/*
+ * ZFS: the vector variants only differ in the simd_directive.  They
+ * enter the FPU section here; the decoder restarts it every LZ4_FPU_CHUNK
+ * bytes of output.
+ */
+#if defined(__x86_64) && defined(HAVE_SSE2)
+static int
+LZ4_uncompress_sse2(const char* source, char* dest, int compressedSize, int maxDecompressedSize)
+{
+    int ret;
+
+    kfpu_begin();
+    ret = LZ4_decompress_generic(source, dest, compressedSize, maxDecompressedSize,
+                                 endOnInputSize, decode_full_block, noDict,
+                                 (BYTE*)dest, NULL, 0, withSSE2);
+    kfpu_end();
+    return ret;
+}
+
+static boolean_t
+lz4_sse2_will_work(void)
+{
+    return (kfpu_allowed() && zfs_sse2_available());
+}
+
+const lz4_impl_ops_t lz4_sse2_impl = {
+    .decompress = LZ4_uncompress_sse2,
+    .is_supported = lz4_sse2_will_work,
+    .name = "sse2"
+};
+#endif
+
+#if defined(__x86_64) && defined(HAVE_SSSE3)
+static int
+LZ4_uncompress_ssse3(const char* source, char* dest, int compressedSize, int maxDecompressedSize)
+{
+    int ret;
+
+    kfpu_begin();
+    ret = LZ4_decompress_generic(source, dest, compressedSize, maxDecompressedSize,
+                                 endOnInputSize, decode_full_block, noDict,
+                                 (BYTE*)dest, NULL, 0, withSSSE3);
+    kfpu_end();
+    return ret;
+}
+
+static boolean_t
+lz4_ssse3_will_work(void)
+{
+    return (kfpu_allowed() && zfs_sse2_available() && zfs_ssse3_available());
+}
+
+const lz4_impl_ops_t lz4_ssse3_impl = {
+    .decompress = LZ4_uncompress_ssse3,
+    .is_supported = lz4_ssse3_will_work,
+    .name = "ssse3"
+};
+#endif
+
+#if defined(__x86_64) && defined(HAVE_AVX2)
+static int
+LZ4_uncompress_avx2(const char* source, char* dest, int compressedSize, int maxDecompressedSize)
+{
+    int ret;
+
+    kfpu_begin();
+    ret = LZ4_decompress_generic(source, dest, compressedSize, maxDecompressedSize,
+                                 endOnInputSize, decode_full_block, noDict,
+                                 (BYTE*)dest, NULL, 0, withAVX2);
+    __asm__ __volatile__("vzeroupper" : : : "memory");
+    kfpu_end();
+    return ret;
 }
+
+static boolean_t
+lz4_avx2_will_work(void)
+{
+    return (kfpu_allowed() && zfs_avx_available() && zfs_avx2_available());
+}
+
+const lz4_impl_ops_t lz4_avx2_impl = {
+    .decompress = LZ4_uncompress_avx2,
+    .is_supported = lz4_avx2_will_work,
+    .name = "avx2"
+};
+#endif
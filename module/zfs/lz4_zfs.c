@@ -39,6 +39,8 @@
 
 #include <sys/zfs_context.h>
 #include <sys/zio_compress.h>
+#include <sys/simd.h>
+#include <sys/lz4_impl.h>
 
 static int real_LZ4_compress(const char *source, char *dest, int isize,
     int osize);
@@ -47,10 +49,6 @@ static int LZ4_compressCtx(void *ctx, const char *source, char *dest,
 static int LZ4_compress64kCtx(void *ctx, const char *source, char *dest,
     int isize, int osize);
 
-/* See lz4.c */
-int LZ4_uncompress_unknownOutputSize(const char *source, char *dest,
-    int isize, int maxOutputSize);
-
 static kmem_cache_t *lz4_cache;
 
 static size_t
@@ -97,7 +95,7 @@ zfs_lz4_decompress_buf(void *s_start, void *d_start, size_t s_len,
 	 * Returns 0 on success (decompression function returned non-negative)
 	 * and non-zero on failure (decompression function returned negative).
 	 */
-	return (LZ4_uncompress_unknownOutputSize(&src[sizeof (bufsiz)],
+	return (lz4_impl_get_ops()->decompress(&src[sizeof (bufsiz)],
 	    d_start, bufsiz, d_len) < 0);
 }
 
@@ -867,19 +865,324 @@ real_LZ4_compress(const char *source, char *dest, int isize, int osize)
 	return (result);
 }
 
+/*
+ * Decompression implementations.  The decoder in lz4.c is instantiated
+ * once per instruction set.  Selection uses the same generic_impl.c
+ * backend as blake3 and sha2: the kernel module benchmarks the supported
+ * implementations at load time, and zfs_lz4_impl can override the choice.
+ */
+static const lz4_impl_ops_t *const lz4_impls[] = {
+	&lz4_scalar_impl,
+#if defined(__x86_64) && defined(HAVE_SSE2)
+	&lz4_sse2_impl,
+#endif
+#if defined(__x86_64) && defined(HAVE_SSSE3)
+	&lz4_ssse3_impl,
+#endif
+#if defined(__x86_64) && defined(HAVE_AVX2)
+	&lz4_avx2_impl,
+#endif
+};
+
+/* use the generic implementation functions */
+#define	IMPL_NAME		"lz4"
+#define	IMPL_OPS_T		lz4_impl_ops_t
+#define	IMPL_ARRAY		lz4_impls
+#define	IMPL_GET_OPS		lz4_impl_get_ops
+#define	ZFS_IMPL_OPS		zfs_lz4_ops
+#include <generic_impl.c>
+
+#if defined(_KERNEL)
+static kstat_t *lz4_kstat;
+
+/* decompression bandwidth of each supported implementation, in B/s */
+static uint64_t lz4_stat_data[ARRAY_SIZE(lz4_impls) + 1];
+static uint32_t lz4_fastest_id;
+
+static int
+lz4_kstat_headers(char *buf, size_t size)
+{
+	ssize_t off = 0;
+
+	off += snprintf(buf + off, size, "%-17s", "implementation");
+	(void) snprintf(buf + off, size - off, "%-15s\n", "decompress");
+
+	return (0);
+}
+
+static int
+lz4_kstat_data(char *buf, size_t size, void *data)
+{
+	uint64_t *curr_stat = data;
+	ptrdiff_t id = curr_stat - lz4_stat_data;
+	ssize_t off = 0;
+
+	if (id == generic_supp_impls_cnt) {
+		off += snprintf(buf + off, size - off, "%-17s", "fastest");
+		(void) snprintf(buf + off, size - off, "%-15s\n",
+		    generic_supp_impls[lz4_fastest_id]->name);
+	} else {
+		off += snprintf(buf + off, size - off, "%-17s",
+		    generic_supp_impls[id]->name);
+		(void) snprintf(buf + off, size - off, "%-15llu\n",
+		    (u_longlong_t)*curr_stat);
+	}
+
+	return (0);
+}
+
+static void *
+lz4_kstat_addr(kstat_t *ksp, loff_t n)
+{
+	if (n <= generic_supp_impls_cnt)
+		ksp->ks_private = (void *) (lz4_stat_data + n);
+	else
+		ksp->ks_private = NULL;
+
+	return (ksp->ks_private);
+}
+
+#define	LZ4_BENCH_NS	(MSEC2NSEC(1))		/* 1ms */
+
+/*
+ * Fill the benchmark buffer with a mix of literal runs and back references
+ * at short and long distances, so that every copy path of the decoder is
+ * exercised in roughly the proportions seen in real data.
+ */
+static void
+lz4_benchmark_fill(uint8_t *buf, size_t size)
+{
+	uint64_t x = 0x9e3779b97f4a7c15ULL;
+	size_t i = 0;
+
+	while (i < size) {
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+		size_t len = MIN(size - i, 4 + ((x >> 33) & 63));
+		size_t off = 1 + ((x >> 40) & ((x >> 63) ? 4095 : 15));
+
+		if (((x >> 52) & 7) < 3 || off > i) {
+			for (size_t j = 0; j < len; j++, i++)
+				buf[i] = 'a' + ((x >> (j & 31)) % 26);
+		} else {
+			for (size_t j = 0; j < len; j++, i++)
+				buf[i] = buf[i - off];
+		}
+	}
+}
+
+static void
+lz4_benchmark_impl(const char *src, const char *cbuf, int clen, char *dst,
+    int size)
+{
+	uint64_t run_bw, run_time_ns, best_run = 0;
+	hrtime_t start;
+
+	for (uint32_t i = 0; i < generic_supp_impls_cnt; i++) {
+		const lz4_impl_ops_t *ops = generic_supp_impls[i];
+		uint64_t run_count = 0;
+
+		/* never pick an implementation which gets it wrong */
+		if (ops->decompress(cbuf, dst, clen, size) != size ||
+		    memcmp(src, dst, size) != 0) {
+			lz4_stat_data[i] = 0;
+			continue;
+		}
+
+		kpreempt_disable();
+		start = gethrtime();
+		do {
+			for (int l = 0; l < 8; l++, run_count++)
+				(void) ops->decompress(cbuf, dst, clen, size);
+
+			run_time_ns = gethrtime() - start;
+		} while (run_time_ns < LZ4_BENCH_NS);
+		kpreempt_enable();
+
+		run_bw = size * run_count * NANOSEC;
+		run_bw /= run_time_ns;	/* B/s */
+		lz4_stat_data[i] = run_bw;
+
+		if (run_bw > best_run) {
+			best_run = run_bw;
+			lz4_fastest_id = i;
+		}
+	}
+}
+#endif /* _KERNEL */
+
+/*
+ * Benchmark all supported implementations and make the fastest one the
+ * "fastest" implementation.
+ */
+static void
+lz4_benchmark(void)
+{
+	generic_impl_init();
+
+#if defined(_KERNEL)
+	static const int data_size = 1 << SPA_OLD_MAXBLOCKSHIFT; /* 128kiB */
+	char *src = vmem_alloc(data_size, KM_SLEEP);
+	char *cbuf = vmem_alloc(data_size, KM_SLEEP);
+	char *dst = vmem_alloc(data_size, KM_SLEEP);
+	int clen;
+
+	lz4_benchmark_fill((uint8_t *)src, data_size);
+	clen = real_LZ4_compress(src, cbuf, data_size, data_size);
+	if (clen > 0)
+		lz4_benchmark_impl(src, cbuf, clen, dst, data_size);
+
+	vmem_free(dst, data_size);
+	vmem_free(cbuf, data_size);
+	vmem_free(src, data_size);
+
+	generic_impl_set_fastest(lz4_fastest_id);
+#else
+	/*
+	 * Skip the benchmark in user space to avoid impacting libzpool
+	 * consumers (zdb, zhack, zinject, ztest).  The last implementation
+	 * is assumed to be the fastest and used by default.
+	 */
+	generic_impl_set_fastest(generic_supp_impls_cnt - 1);
+#endif /* _KERNEL */
+}
+
 void
 lz4_init(void)
 {
 	lz4_cache = kmem_cache_create("lz4_cache",
 	    sizeof (struct refTables), 0, NULL, NULL, NULL, NULL, NULL,
 	    KMC_RECLAIMABLE);
+
+	/* Determine the fastest available decompression implementation. */
+	lz4_benchmark();
+
+#if defined(_KERNEL)
+	/* Install kstats for all implementations */
+	lz4_kstat = kstat_create("zfs", 0, "lz4_bench", "misc",
+	    KSTAT_TYPE_RAW, 0, KSTAT_FLAG_VIRTUAL);
+	if (lz4_kstat != NULL) {
+		lz4_kstat->ks_data = NULL;
+		lz4_kstat->ks_ndata = UINT32_MAX;
+		kstat_set_raw_ops(lz4_kstat,
+		    lz4_kstat_headers,
+		    lz4_kstat_data,
+		    lz4_kstat_addr);
+		kstat_install(lz4_kstat);
+	}
+#endif
 }
 
 void
 lz4_fini(void)
 {
+#if defined(_KERNEL)
+	if (lz4_kstat != NULL) {
+		kstat_delete(lz4_kstat);
+		lz4_kstat = NULL;
+	}
+#endif
 	if (lz4_cache) {
 		kmem_cache_destroy(lz4_cache);
 		lz4_cache = NULL;
 	}
 }
+
+#if defined(_KERNEL)
+
+#define	IMPL_FMT(impl, i)	(((impl) == (i)) ? "[%s] " : "%s ")
+
+#if defined(__linux__)
+
+static int
+lz4_param_get(char *buffer, zfs_kernel_param_t *unused)
+{
+	const uint32_t impl = IMPL_READ(generic_impl_chosen);
+	char *fmt;
+	int cnt = 0;
+
+	/* cycling */
+	fmt = IMPL_FMT(impl, IMPL_CYCLE);
+	cnt += kmem_scnprintf(buffer + cnt, PAGE_SIZE - cnt, fmt, "cycle");
+
+	/* list fastest */
+	fmt = IMPL_FMT(impl, IMPL_FASTEST);
+	cnt += kmem_scnprintf(buffer + cnt, PAGE_SIZE - cnt, fmt, "fastest");
+
+	/* list all supported implementations */
+	generic_impl_init();
+	for (uint32_t i = 0; i < generic_supp_impls_cnt; ++i) {
+		fmt = IMPL_FMT(impl, i);
+		cnt += kmem_scnprintf(buffer + cnt, PAGE_SIZE - cnt, fmt,
+		    generic_supp_impls[i]->name);
+	}
+
+	return (cnt);
+}
+
+static int
+lz4_param_set(const char *val, zfs_kernel_param_t *unused)
+{
+	(void) unused;
+	return (generic_impl_setname(val));
+}
+
+#elif defined(__FreeBSD__)
+
+#include <sys/sbuf.h>
+
+static int
+lz4_param(ZFS_MODULE_PARAM_ARGS)
+{
+	int err;
+
+	generic_impl_init();
+	if (req->newptr == NULL) {
+		const uint32_t impl = IMPL_READ(generic_impl_chosen);
+		const int init_buflen = 64;
+		const char *fmt;
+		struct sbuf *s;
+
+		s = sbuf_new_for_sysctl(NULL, NULL, init_buflen, req);
+
+		/* cycling */
+		fmt = IMPL_FMT(impl, IMPL_CYCLE);
+		(void) sbuf_printf(s, fmt, "cycle");
+
+		/* list fastest */
+		fmt = IMPL_FMT(impl, IMPL_FASTEST);
+		(void) sbuf_printf(s, fmt, "fastest");
+
+		/* list all supported implementations */
+		for (uint32_t i = 0; i < generic_supp_impls_cnt; ++i) {
+			fmt = IMPL_FMT(impl, i);
+			(void) sbuf_printf(s, fmt, generic_supp_impls[i]->name);
+		}
+
+		err = sbuf_finish(s);
+		sbuf_delete(s);
+
+		return (err);
+	}
+
+	char buf[16];
+
+	err = sysctl_handle_string(oidp, buf, sizeof (buf), req);
+	if (err) {
+		return (err);
+	}
+
+	return (-generic_impl_setname(buf));
+}
+#endif
+
+#undef IMPL_FMT
+
+/*
+ * Choose an lz4 decompression implementation in ZFS.
+ * Users can choose "cycle" to exercise all implementations, which is
+ * only intended for testing.
+ */
+ZFS_MODULE_VIRTUAL_PARAM_CALL(zfs, zfs_, lz4_impl,
+    lz4_param_set, lz4_param_get, ZMOD_RW,
+	"Select lz4 decompression implementation.");
+#endif
@@ -84,6 +84,7 @@
 #include <sys/dsl_synctask.h>
 #include <sys/fs/zfs.h>
 #include <sys/arc.h>
+#include <sys/arc_warm.h>
 #include <sys/callb.h>
 #include <sys/systeminfo.h>
 #include <sys/zfs_ioctl.h>
@@ -1162,6 +1163,15 @@ spa_get_errlists(spa_t *spa, avl_tree_t *last, avl_tree_t *scrub)
 	    offsetof(spa_error_entry_t, se_avl));
 }
 
+/*
+ * Number of CPUs worth of threads in the batch (write issue) taskqs.
+ */
+uint_t
+spa_taskq_batch_threads(void)
+{
+	return (MAX(1, boot_ncpus * zio_taskq_batch_pct / 100));
+}
+
 static void
 spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 {
@@ -2074,6 +2084,10 @@ spa_destroy_aux_threads(spa_t *spa)
 		zthr_destroy(spa->spa_raidz_expand_zthr);
 		spa->spa_raidz_expand_zthr = NULL;
 	}
+	if (spa->spa_arc_warm_zthr != NULL) {
+		zthr_destroy(spa->spa_arc_warm_zthr);
+		spa->spa_arc_warm_zthr = NULL;
+	}
 }
 
 static void
@@ -3491,6 +3505,8 @@ spa_spawn_aux_threads(spa_t *spa)
 	    zthr_create("z_checkpoint_discard",
 	    spa_checkpoint_discard_thread_check,
 	    spa_checkpoint_discard_thread, spa, minclsyspri);
+
+	spa_start_arc_warm_thread(spa);
 }
 
 /*
@@ -4901,6 +4917,14 @@ spa_ld_get_props(spa_t *spa)
 	if (error != 0 && error != ENOENT)
 		return (spa_vdev_err(rvd, VDEV_AUX_CORRUPT_DATA, EIO));
 
+	/*
+	 * Load the ARC warm-restart manifest object, if one has been saved.
+	 */
+	error = spa_dir_prop(spa, DMU_POOL_ARC_WARM, &spa->spa_arc_warm_obj,
+	    B_FALSE);
+	if (error != 0 && error != ENOENT)
+		return (spa_vdev_err(rvd, VDEV_AUX_CORRUPT_DATA, EIO));
+
 	/*
 	 * Load the per-vdev ZAP map. If we have an older pool, this will not
 	 * be present; in this case, defer its creation to a later time to
@@ -9414,6 +9438,10 @@ spa_async_suspend(spa_t *spa)
 	zthr_t *ll_condense_thread = spa->spa_livelist_condense_zthr;
 	if (ll_condense_thread != NULL)
 		zthr_cancel(ll_condense_thread);
+
+	zthr_t *arc_warm_thread = spa->spa_arc_warm_zthr;
+	if (arc_warm_thread != NULL)
+		zthr_cancel(arc_warm_thread);
 }
 
 void
@@ -9444,6 +9472,10 @@ spa_async_resume(spa_t *spa)
 	zthr_t *ll_condense_thread = spa->spa_livelist_condense_zthr;
 	if (ll_condense_thread != NULL)
 		zthr_resume(ll_condense_thread);
+
+	zthr_t *arc_warm_thread = spa->spa_arc_warm_zthr;
+	if (arc_warm_thread != NULL)
+		zthr_resume(arc_warm_thread);
 }
 
 static boolean_t
@@ -10158,6 +10190,7 @@ spa_sync_iterate_to_convergence(spa_t *spa, dmu_tx_t *tx)
 
 	do {
 		int pass = ++spa->spa_sync_pass;
+		hrtime_t start;
 
 		spa_sync_config_object(spa, tx);
 		spa_sync_aux_dev(spa, &spa->spa_spares, tx,
@@ -10167,6 +10200,7 @@ spa_sync_iterate_to_convergence(spa_t *spa, dmu_tx_t *tx)
 		spa_errlog_sync(spa, txg);
 		dsl_pool_sync(dp, txg);
 
+		start = gethrtime();
 		if (pass < zfs_sync_pass_deferred_free ||
 		    spa_feature_is_active(spa, SPA_FEATURE_LOG_SPACEMAP)) {
 			/*
@@ -10185,20 +10219,28 @@ spa_sync_iterate_to_convergence(spa_t *spa, dmu_tx_t *tx)
 			bplist_iterate(free_bpl, bpobj_enqueue_alloc_cb,
 			    &spa->spa_deferred_bpobj, tx);
 		}
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_FREES, &start);
 
 		brt_sync(spa, txg);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_BRT, &start);
 		ddt_sync(spa, txg);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_DDT, &start);
 		dsl_scan_sync(dp, tx);
 		dsl_errorscrub_sync(dp, tx);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_SCAN, &start);
 		svr_sync(spa, tx);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_REMOVAL, &start);
 		spa_sync_upgrades(spa, tx);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_UPGRADES, &start);
 
 		spa_flush_metaslabs(spa, tx);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_FLUSH, &start);
 
 		vdev_t *vd = NULL;
 		while ((vd = txg_list_remove(&spa->spa_vdev_txg_list, txg))
 		    != NULL)
 			vdev_sync(vd, txg);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_VDEVS, &start);
 
 		if (pass == 1) {
 			/*
@@ -10245,7 +10287,9 @@ spa_sync_iterate_to_convergence(spa_t *spa, dmu_tx_t *tx)
 			break;
 		}
 
+		start = gethrtime();
 		spa_sync_deferred_frees(spa, tx);
+		spa_sync_phase_add(spa, SPA_SYNC_PHASE_DEFERRED_FREES, &start);
 	} while (dmu_objset_is_dirty(mos, txg));
 }
 
@@ -10439,7 +10483,9 @@ spa_sync(spa_t *spa, uint64_t txg)
 		ASSERT0(spa->spa_vdev_removal->svr_bytes_done[txg & TXG_MASK]);
 	}
 
+	hrtime_t start = gethrtime();
 	spa_sync_rewrite_vdev_config(spa, tx);
+	spa_sync_phase_add(spa, SPA_SYNC_PHASE_CONFIG, &start);
 	dmu_tx_commit(tx);
 
 	taskq_cancel_id(system_delay_taskq, spa->spa_deadman_tqid);
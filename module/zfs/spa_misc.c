@@ -2608,6 +2608,7 @@ spa_init(spa_mode_t mode)
 	dmu_init();
 	zil_init();
 	vdev_mirror_stat_init();
+	vdev_queue_stat_init();
 	vdev_raidz_math_init();
 	vdev_file_init();
 	zfs_prop_init();
@@ -2630,6 +2631,7 @@ spa_fini(void)
 	spa_evict_all();
 
 	vdev_file_fini();
+	vdev_queue_stat_fini();
 	vdev_mirror_stat_fini();
 	vdev_raidz_math_fini();
 	chksum_fini();
@@ -200,6 +200,7 @@ typedef struct spa_txg_history {
 	uint64_t	writes;		/* number of write operations */
 	uint64_t	ndirty;		/* number of dirty bytes */
 	hrtime_t	times[TXG_STATE_COMMITTED]; /* completion times */
+	hrtime_t	overlap;	/* quiesced during previous sync */
 	procfs_list_node_t	sth_node;
 } spa_txg_history_t;
 
@@ -207,9 +208,9 @@ static int
 spa_txg_history_show_header(struct seq_file *f)
 {
 	seq_printf(f, "%-8s %-16s %-5s %-12s %-12s %-12s "
-	    "%-8s %-8s %-12s %-12s %-12s %-12s\n", "txg", "birth", "state",
-	    "ndirty", "nread", "nwritten", "reads", "writes",
-	    "otime", "qtime", "wtime", "stime");
+	    "%-8s %-8s %-12s %-12s %-12s %-12s %-12s\n", "txg", "birth",
+	    "state", "ndirty", "nread", "nwritten", "reads", "writes",
+	    "otime", "qtime", "wtime", "stime", "ovtime");
 	return (0);
 }
 
@@ -246,14 +247,14 @@ spa_txg_history_show(struct seq_file *f, void *data)
 		sync = sth->times[TXG_STATE_SYNCED] -
 		    sth->times[TXG_STATE_WAIT_FOR_SYNC];
 
-	seq_printf(f, "%-8llu %-16llu %-5c %-12llu "
-	    "%-12llu %-12llu %-8llu %-8llu %-12llu %-12llu %-12llu %-12llu\n",
+	seq_printf(f, "%-8llu %-16llu %-5c %-12llu %-12llu %-12llu "
+	    "%-8llu %-8llu %-12llu %-12llu %-12llu %-12llu %-12llu\n",
 	    (longlong_t)sth->txg, sth->times[TXG_STATE_BIRTH], state,
 	    (u_longlong_t)sth->ndirty,
 	    (u_longlong_t)sth->nread, (u_longlong_t)sth->nwritten,
 	    (u_longlong_t)sth->reads, (u_longlong_t)sth->writes,
 	    (u_longlong_t)open, (u_longlong_t)quiesce, (u_longlong_t)wait,
-	    (u_longlong_t)sync);
+	    (u_longlong_t)sync, (u_longlong_t)sth->overlap);
 
 	return (0);
 }
@@ -336,6 +337,28 @@ spa_txg_history_add(spa_t *spa, uint64_t txg, hrtime_t birth_time)
 	mutex_exit(&shl->procfs_list.pl_lock);
 }
 
+/*
+ * Return how much of the time "sth" spent quiescing overlapped with the
+ * sync of the txg before it, e.g. due to zfs_txg_pipeline.
+ */
+static hrtime_t
+spa_txg_history_overlap(spa_txg_history_t *prev, spa_txg_history_t *sth)
+{
+	hrtime_t start, end;
+
+	if (prev == NULL || prev->txg != sth->txg - 1 ||
+	    prev->times[TXG_STATE_WAIT_FOR_SYNC] == 0)
+		return (0);
+
+	start = MAX(sth->times[TXG_STATE_OPEN],
+	    prev->times[TXG_STATE_WAIT_FOR_SYNC]);
+	end = sth->times[TXG_STATE_QUIESCED];
+	if (prev->times[TXG_STATE_SYNCED] != 0)
+		end = MIN(end, prev->times[TXG_STATE_SYNCED]);
+
+	return (end > start ? end - start : 0);
+}
+
 /*
  * Set txg state completion time and increment current state.
  */
@@ -356,6 +379,11 @@ spa_txg_history_set(spa_t *spa, uint64_t txg, txg_state_t completed_state,
 		if (sth->txg == txg) {
 			sth->times[completed_state] = completed_time;
 			sth->state++;
+			if (completed_state == TXG_STATE_QUIESCED) {
+				sth->overlap = spa_txg_history_overlap(
+				    list_prev(&shl->procfs_list.pl_list, sth),
+				    sth);
+			}
 			error = 0;
 			break;
 		}
@@ -397,11 +425,149 @@ spa_txg_history_set_io(spa_t *spa, uint64_t txg, uint64_t nread,
 	return (error);
 }
 
+/*
+ * ==========================================================================
+ * SPA TXG Sync Phases Routines
+ * ==========================================================================
+ */
+
+/*
+ * Time spent in each phase of the last zfs_txg_history txg syncs, and how
+ * many times the phase ran (once per sync pass for most phases, so the
+ * "datasets" count is the number of passes the txg took to converge).
+ */
+typedef struct spa_txg_phases {
+	uint64_t	txg;		/* txg id */
+	hrtime_t	time[SPA_SYNC_PHASES];
+	uint32_t	count[SPA_SYNC_PHASES];
+	procfs_list_node_t	stp_node;
+} spa_txg_phases_t;
+
+static const char *const spa_sync_phase_names[SPA_SYNC_PHASES] = {
+	"datasets",
+	"userspace",
+	"mos",
+	"synctasks",
+	"frees",
+	"brt",
+	"ddt",
+	"scan",
+	"removal",
+	"upgrades",
+	"flush",
+	"vdevs",
+	"deferred_frees",
+	"config",
+};
+
+static int
+spa_txg_phases_show_header(struct seq_file *f)
+{
+	seq_printf(f, "%-8s %-16s %-8s %-12s\n", "txg", "phase", "count",
+	    "time");
+	return (0);
+}
+
+static int
+spa_txg_phases_show(struct seq_file *f, void *data)
+{
+	spa_txg_phases_t *stp = (spa_txg_phases_t *)data;
+
+	for (int i = 0; i < SPA_SYNC_PHASES; i++) {
+		if (stp->count[i] == 0)
+			continue;
+		seq_printf(f, "%-8llu %-16s %-8u %-12llu\n",
+		    (u_longlong_t)stp->txg, spa_sync_phase_names[i],
+		    stp->count[i], (u_longlong_t)stp->time[i]);
+	}
+
+	return (0);
+}
+
+/* Remove oldest elements from list until there are no more than 'size' left */
+static void
+spa_txg_phases_truncate(spa_history_list_t *shl, unsigned int size)
+{
+	spa_txg_phases_t *stp;
+	while (shl->size > size) {
+		stp = list_remove_head(&shl->procfs_list.pl_list);
+		ASSERT3P(stp, !=, NULL);
+		kmem_free(stp, sizeof (spa_txg_phases_t));
+		shl->size--;
+	}
+
+	if (size == 0)
+		ASSERT(list_is_empty(&shl->procfs_list.pl_list));
+}
+
+static int
+spa_txg_phases_clear(procfs_list_t *procfs_list)
+{
+	spa_history_list_t *shl = procfs_list->pl_private;
+	mutex_enter(&procfs_list->pl_lock);
+	spa_txg_phases_truncate(shl, 0);
+	mutex_exit(&procfs_list->pl_lock);
+	return (0);
+}
+
+static void
+spa_txg_phases_init(spa_t *spa)
+{
+	spa_history_list_t *shl = &spa->spa_stats.txg_phases;
+
+	shl->size = 0;
+	shl->procfs_list.pl_private = shl;
+	procfs_list_install("zfs",
+	    spa_name(spa),
+	    "txg_phases",
+	    0644,
+	    &shl->procfs_list,
+	    spa_txg_phases_show,
+	    spa_txg_phases_show_header,
+	    spa_txg_phases_clear,
+	    offsetof(spa_txg_phases_t, stp_node));
+}
+
+static void
+spa_txg_phases_destroy(spa_t *spa)
+{
+	spa_history_list_t *shl = &spa->spa_stats.txg_phases;
+	procfs_list_uninstall(&shl->procfs_list);
+	spa_txg_phases_truncate(shl, 0);
+	procfs_list_destroy(&shl->procfs_list);
+}
+
+/*
+ * Record the phase times accumulated by spa_sync_phase_add() for the txg
+ * which just finished syncing.
+ */
+static void
+spa_txg_phases_add(spa_t *spa, uint64_t txg)
+{
+	spa_history_list_t *shl = &spa->spa_stats.txg_phases;
+	spa_txg_phases_t *stp;
+
+	stp = kmem_alloc(sizeof (spa_txg_phases_t), KM_SLEEP);
+	stp->txg = txg;
+	memcpy(stp->time, spa->spa_sync_phase_time, sizeof (stp->time));
+	memcpy(stp->count, spa->spa_sync_phase_count, sizeof (stp->count));
+
+	mutex_enter(&shl->procfs_list.pl_lock);
+	procfs_list_add(&shl->procfs_list, stp);
+	shl->size++;
+	spa_txg_phases_truncate(shl, zfs_txg_history);
+	mutex_exit(&shl->procfs_list.pl_lock);
+}
+
 txg_stat_t *
 spa_txg_history_init_io(spa_t *spa, uint64_t txg, dsl_pool_t *dp)
 {
 	txg_stat_t *ts;
 
+	memset(spa->spa_sync_phase_time, 0, sizeof (spa->spa_sync_phase_time));
+	memset(spa->spa_sync_phase_count, 0,
+	    sizeof (spa->spa_sync_phase_count));
+
 	if (zfs_txg_history == 0)
 		return (NULL);
 
@@ -441,10 +607,26 @@ spa_txg_history_fini_io(spa_t *spa, txg_stat_t *ts)
 	    ts->vs2.vs_ops[ZIO_TYPE_READ] - ts->vs1.vs_ops[ZIO_TYPE_READ],
 	    ts->vs2.vs_ops[ZIO_TYPE_WRITE] - ts->vs1.vs_ops[ZIO_TYPE_WRITE],
 	    ts->ndirty);
+	spa_txg_phases_add(spa, ts->txg);
 
 	kmem_free(ts, sizeof (txg_stat_t));
 }
 
+/*
+ * Charge the time since *start to the given phase of the syncing txg and
+ * restart the clock, so consecutive phases can share one timestamp.
+ */
+void
+spa_sync_phase_add(spa_t *spa, spa_sync_phase_t phase, hrtime_t *start)
+{
+	hrtime_t now = gethrtime();
+
+	ASSERT3U(phase, <, SPA_SYNC_PHASES);
+	spa->spa_sync_phase_time[phase] += now - *start;
+	spa->spa_sync_phase_count[phase]++;
+	*start = now;
+}
+
 /*
  * ==========================================================================
  * SPA TX Assign Histogram Routines
@@ -1037,24 +1219,132 @@ spa_iostats_destroy(spa_t *spa)
 	mutex_destroy(&shk->lock);
 }
 
+static const spa_arc_warm_stats_t spa_arc_warm_stats_template = {
+	{ "saves",				KSTAT_DATA_UINT64 },
+	{ "save_entries",			KSTAT_DATA_UINT64 },
+	{ "save_bytes",				KSTAT_DATA_UINT64 },
+	{ "save_txg",				KSTAT_DATA_UINT64 },
+	{ "restore_entries",			KSTAT_DATA_UINT64 },
+	{ "restore_processed",			KSTAT_DATA_UINT64 },
+	{ "restore_issued",			KSTAT_DATA_UINT64 },
+	{ "restore_skipped",			KSTAT_DATA_UINT64 },
+};
+
+/*
+ * Record a manifest of the given number of entries, covering bytes of
+ * cached blocks, being written in txg.
+ */
+void
+spa_arc_warm_stats_save(spa_t *spa, uint64_t entries, uint64_t bytes,
+    uint64_t txg)
+{
+	kstat_t *ksp = spa->spa_stats.arc_warm.kstat;
+
+	if (ksp == NULL)
+		return;
+
+	spa_arc_warm_stats_t *aws = ksp->ks_data;
+	atomic_inc_64(&aws->saves.value.ui64);
+	aws->save_entries.value.ui64 = entries;
+	aws->save_bytes.value.ui64 = bytes;
+	aws->save_txg.value.ui64 = txg;
+}
+
+/*
+ * Record the start of a restore of a manifest with the given number of
+ * entries, resetting the progress counters.
+ */
+void
+spa_arc_warm_stats_restore(spa_t *spa, uint64_t entries)
+{
+	kstat_t *ksp = spa->spa_stats.arc_warm.kstat;
+
+	if (ksp == NULL)
+		return;
+
+	spa_arc_warm_stats_t *aws = ksp->ks_data;
+	aws->restore_entries.value.ui64 = entries;
+	aws->restore_processed.value.ui64 = 0;
+	aws->restore_issued.value.ui64 = 0;
+	aws->restore_skipped.value.ui64 = 0;
+}
+
+void
+spa_arc_warm_stats_restore_add(spa_t *spa, uint64_t processed,
+    uint64_t issued, uint64_t skipped)
+{
+	kstat_t *ksp = spa->spa_stats.arc_warm.kstat;
+
+	if (ksp == NULL)
+		return;
+
+	spa_arc_warm_stats_t *aws = ksp->ks_data;
+	atomic_add_64(&aws->restore_processed.value.ui64, processed);
+	atomic_add_64(&aws->restore_issued.value.ui64, issued);
+	atomic_add_64(&aws->restore_skipped.value.ui64, skipped);
+}
+
+static void
+spa_arc_warm_stats_init(spa_t *spa)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.arc_warm;
+
+	mutex_init(&shk->lock, NULL, MUTEX_DEFAULT, NULL);
+
+	char *name = kmem_asprintf("zfs/%s", spa_name(spa));
+	kstat_t *ksp = kstat_create(name, 0, "arc_warm", "misc",
+	    KSTAT_TYPE_NAMED,
+	    sizeof (spa_arc_warm_stats_t) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+
+	shk->kstat = ksp;
+	if (ksp) {
+		int size = sizeof (spa_arc_warm_stats_t);
+		ksp->ks_lock = &shk->lock;
+		ksp->ks_private = spa;
+		ksp->ks_data = kmem_alloc(size, KM_SLEEP);
+		memcpy(ksp->ks_data, &spa_arc_warm_stats_template, size);
+		kstat_install(ksp);
+	}
+
+	kmem_strfree(name);
+}
+
+static void
+spa_arc_warm_stats_destroy(spa_t *spa)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.arc_warm;
+	kstat_t *ksp = shk->kstat;
+	if (ksp) {
+		kmem_free(ksp->ks_data, sizeof (spa_arc_warm_stats_t));
+		kstat_delete(ksp);
+	}
+
+	mutex_destroy(&shk->lock);
+}
+
 void
 spa_stats_init(spa_t *spa)
 {
 	spa_read_history_init(spa);
 	spa_txg_history_init(spa);
+	spa_txg_phases_init(spa);
 	spa_tx_assign_init(spa);
 	spa_mmp_history_init(spa);
 	spa_state_init(spa);
 	spa_guid_init(spa);
 	spa_iostats_init(spa);
+	spa_arc_warm_stats_init(spa);
 }
 
 void
 spa_stats_destroy(spa_t *spa)
 {
+	spa_arc_warm_stats_destroy(spa);
 	spa_iostats_destroy(spa);
 	spa_health_destroy(spa);
 	spa_tx_assign_destroy(spa);
+	spa_txg_phases_destroy(spa);
 	spa_txg_history_destroy(spa);
 	spa_read_history_destroy(spa);
 	spa_mmp_history_destroy(spa);
@@ -115,6 +115,18 @@ static __attribute__((noreturn)) void txg_quiesce_thread(void *arg);
 
 uint_t zfs_txg_timeout = 5;	/* max seconds worth of delta per txg */
 
+/*
+ * When a txg is kicked for having accumulated enough dirty data while
+ * another txg is still syncing, quiesce it right away instead of after
+ * spa_sync() of the syncing txg returns.  Waiting for the kicked txg's
+ * holds to drain then overlaps with the previous sync, the kicked txg is
+ * ready to sync the moment the sync thread is free, and new writes are
+ * admitted into the next open txg rather than throttled against one
+ * that can't make progress.  The cost is more, smaller txgs under
+ * sustained load, since the kicked txg stops growing earlier.
+ */
+int zfs_txg_pipeline = 0;
+
 /*
  * Prepare the txg subsystem.
  */
@@ -823,7 +835,8 @@ txg_kick(dsl_pool_t *dp, uint64_t txg)
 
 	ASSERT(!dsl_pool_config_held(dp));
 
-	if (tx->tx_sync_txg_waiting >= txg)
+	if (tx->tx_sync_txg_waiting >= txg &&
+	    (!zfs_txg_pipeline || tx->tx_quiesce_txg_waiting > txg))
 		return;
 
 	mutex_enter(&tx->tx_sync_lock);
@@ -831,6 +844,11 @@ txg_kick(dsl_pool_t *dp, uint64_t txg)
 		tx->tx_sync_txg_waiting = txg;
 		cv_broadcast(&tx->tx_sync_more_cv);
 	}
+	if (zfs_txg_pipeline && tx->tx_syncing_txg != 0 &&
+	    tx->tx_open_txg == txg && tx->tx_quiesce_txg_waiting <= txg) {
+		tx->tx_quiesce_txg_waiting = txg + 1;
+		cv_broadcast(&tx->tx_quiesce_more_cv);
+	}
 	mutex_exit(&tx->tx_sync_lock);
 }
 
@@ -1095,3 +1113,6 @@ EXPORT_SYMBOL(txg_sync_waiting);
 
 ZFS_MODULE_PARAM(zfs_txg, zfs_txg_, timeout, UINT, ZMOD_RW,
 	"Max seconds worth of delta per txg");
+
+ZFS_MODULE_PARAM(zfs_txg, zfs_txg_, pipeline, INT, ZMOD_RW,
+	"Quiesce kicked txgs while the previous txg is still syncing");
@@ -3942,6 +3942,19 @@ vdev_load(vdev_t *vd)
 		if (error && error != ENOENT)
 			vdev_dbgmsg(vd, "vdev_load: zap_lookup(zap=%llu) "
 			    "failed [error=%d]", (u_longlong_t)zapobj, error);
+
+		if (vd->vdev_ops->vdev_op_leaf) {
+			uint64_t bypass;
+
+			error = vdev_prop_get_int(vd, VDEV_PROP_QUEUE_BYPASS,
+			    &bypass);
+			if (error && error != ENOENT)
+				vdev_dbgmsg(vd, "vdev_load: zap_lookup(zap="
+				    "%llu) failed [error=%d]",
+				    (u_longlong_t)zapobj, error);
+			else
+				vd->vdev_queue_bypass = bypass == 1;
+		}
 	}
 
 	/*
@@ -4885,7 +4898,8 @@ vdev_get_stats_ex_impl(vdev_t *vd, vdev_stat_t *vs, vdev_stat_ex_t *vsx)
 		memcpy(vsx, &vd->vdev_stat_ex, sizeof (vd->vdev_stat_ex));
 
 		for (t = 0; t < ZIO_PRIORITY_NUM_QUEUEABLE; t++) {
-			vsx->vsx_active_queue[t] = vd->vdev_queue.vq_cactive[t];
+			vsx->vsx_active_queue[t] =
+			    vdev_queue_class_active(vd, t);
 			vsx->vsx_pend_queue[t] = vdev_queue_class_length(vd, t);
 		}
 	}
@@ -5743,28 +5757,31 @@ vdev_deadman(vdev_t *vd, const char *tag)
 	}
 
 	if (vd->vdev_ops->vdev_op_leaf) {
-		vdev_queue_t *vq = &vd->vdev_queue;
+		for (uint_t s = 0; s < vd->vdev_queue.vq_nshards; s++) {
+			vdev_queue_t *vq = vdev_queue_shard(&vd->vdev_queue, s);
 
-		mutex_enter(&vq->vq_lock);
-		if (vq->vq_active > 0) {
-			spa_t *spa = vd->vdev_spa;
-			zio_t *fio;
-			uint64_t delta;
+			mutex_enter(&vq->vq_lock);
+			if (vq->vq_active > 0) {
+				spa_t *spa = vd->vdev_spa;
+				zio_t *fio;
+				uint64_t delta;
 
-			zfs_dbgmsg("slow vdev: %s has %u active IOs",
-			    vd->vdev_path, vq->vq_active);
+				zfs_dbgmsg("slow vdev: %s has %u active IOs",
+				    vd->vdev_path, vq->vq_active);
 
-			/*
-			 * Look at the head of all the pending queues,
-			 * if any I/O has been outstanding for longer than
-			 * the spa_deadman_synctime invoke the deadman logic.
-			 */
-			fio = list_head(&vq->vq_active_list);
-			delta = gethrtime() - fio->io_timestamp;
-			if (delta > spa_deadman_synctime(spa))
-				zio_deadman(fio, tag);
+				/*
+				 * Look at the head of all the pending queues,
+				 * if any I/O has been outstanding for longer
+				 * than the spa_deadman_synctime invoke the
+				 * deadman logic.
+				 */
+				fio = list_head(&vq->vq_active_list);
+				delta = gethrtime() - fio->io_timestamp;
+				if (delta > spa_deadman_synctime(spa))
+					zio_deadman(fio, tag);
+			}
+			mutex_exit(&vq->vq_lock);
 		}
-		mutex_exit(&vq->vq_lock);
 	}
 }
 
@@ -6187,6 +6204,18 @@ vdev_prop_set(vdev_t *vd, nvlist_t *innvl, nvlist_t *outnvl)
 			}
 			vd->vdev_autosit = intval == 1;
 			break;
+		case VDEV_PROP_QUEUE_BYPASS:
+			/* Only leaf vdevs have an I/O queue */
+			if (!vd->vdev_ops->vdev_op_leaf) {
+				error = ENOTSUP;
+				break;
+			}
+			if (nvpair_value_uint64(elem, &intval) != 0) {
+				error = EINVAL;
+				break;
+			}
+			vd->vdev_queue_bypass = intval == 1;
+			break;
 		case VDEV_PROP_CHECKSUM_N:
 			if (nvpair_value_uint64(elem, &intval) != 0) {
 				error = EINVAL;
@@ -6557,6 +6586,19 @@ vdev_prop_get(vdev_t *vd, nvlist_t *innvl, nvlist_t *outnvl)
 					    ZPROP_SRC_NONE);
 				}
 				continue;
+			case VDEV_PROP_QUEUE_BYPASS:
+				/* only valid for leaf vdevs */
+				if (vd->vdev_ops->vdev_op_leaf) {
+					intval = vd->vdev_queue_bypass;
+					if (intval ==
+					    vdev_prop_default_numeric(prop))
+						src = ZPROP_SRC_DEFAULT;
+					else
+						src = ZPROP_SRC_LOCAL;
+					vdev_prop_add_list(outnvl, propname,
+					    NULL, intval, src);
+				}
+				continue;
 			/* Numeric Properites */
 			case VDEV_PROP_ALLOCATING:
 				/* Leaf vdevs cannot have this property */
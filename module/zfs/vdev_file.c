@@ -52,6 +52,18 @@ static taskq_t *vdev_file_taskq;
 static uint_t vdev_file_logical_ashift = SPA_MINBLOCKSHIFT;
 static uint_t vdev_file_physical_ashift = SPA_MINBLOCKSHIFT;
 
+#ifndef _KERNEL
+/*
+ * In userspace, when this is non-zero and the platform supports it, reads
+ * and writes are submitted asynchronously through a per-vdev io_uring with
+ * this many entries, rather than issued synchronously one at a time by
+ * vdev_file_taskq.  It is applied when the vdev is opened.  The ring is off
+ * by default: on pools that fit in the page cache it measured no faster
+ * than the taskq.
+ */
+static uint_t vdev_file_ring_entries = 0;
+#endif
+
 void
 vdev_file_init(void)
 {
@@ -160,6 +172,12 @@ vdev_file_open(vdev_t *vd, uint64_t *psize, uint64_t *max_psize,
 
 	vf->vf_file = fp;
 
+#ifndef _KERNEL
+	if (vdev_file_ring_entries != 0)
+		vf->vf_ring = vdev_file_ring_create(fp,
+		    vdev_file_ring_entries);
+#endif
+
 #ifdef _KERNEL
 	/*
 	 * Make sure it's a regular file.
@@ -196,6 +214,11 @@ vdev_file_close(vdev_t *vd)
 	if (vd->vdev_reopening || vf == NULL)
 		return;
 
+#ifndef _KERNEL
+	if (vf->vf_ring != NULL)
+		vdev_file_ring_destroy(vf->vf_ring);
+#endif
+
 	if (vf->vf_file != NULL) {
 		(void) zfs_file_close(vf->vf_file);
 	}
@@ -299,6 +322,14 @@ vdev_file_io_start(zio_t *zio)
 	ASSERT(zio->io_type == ZIO_TYPE_READ || zio->io_type == ZIO_TYPE_WRITE);
 	zio->io_target_timestamp = zio_handle_io_delay(zio);
 
+#ifndef _KERNEL
+	vdev_file_t *vf = vd->vdev_tsd;
+	if (vf->vf_ring != NULL) {
+		vdev_file_ring_io(vf->vf_ring, zio);
+		return;
+	}
+#endif
+
 	VERIFY3U(taskq_dispatch(vdev_file_taskq, vdev_file_io_strategy, zio,
 	    TQ_SLEEP), !=, TASKQID_INVALID);
 }
@@ -371,3 +402,7 @@ ZFS_MODULE_PARAM(zfs_vdev_file, vdev_file_, logical_ashift, UINT, ZMOD_RW,
 	"Logical ashift for file-based devices");
 ZFS_MODULE_PARAM(zfs_vdev_file, vdev_file_, physical_ashift, UINT, ZMOD_RW,
 	"Physical ashift for file-based devices");
+#ifndef _KERNEL
+ZFS_MODULE_PARAM(zfs_vdev_file, vdev_file_, ring_entries, UINT, ZMOD_RW,
+	"Depth of the asynchronous I/O ring of file vdevs in userspace");
+#endif
@@ -202,7 +202,7 @@ vdev_mirror_load(mirror_map_t *mm, vdev_t *vd, uint64_t zio_offset)
 
 	/* Standard load based on pending queue length. */
 	load = vdev_queue_length(vd);
-	last_offset = vdev_queue_last_offset(vd);
+	last_offset = vdev_queue_last_offset(vd, zio_offset);
 
 	if (vd->vdev_nonrot) {
 		/* Non-rotating media. */
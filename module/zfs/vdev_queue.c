@@ -116,6 +116,39 @@
  * maximum percentage, this indicates that the rate of incoming data is
  * greater than the rate that the backend storage can handle. In this case, we
  * must further throttle incoming writes (see dmu_tx_delay() for details).
+ *
+ * Queue Shards
+ *
+ * Every I/O to a leaf vdev is queued and completed under the queue's lock.
+ * On fast non-rotating devices that lock can become the bottleneck, so the
+ * queue of a non-rotating leaf vdev may be split into zfs_vdev_queue_shards
+ * independent shards.  The device is striped across the shards in
+ * 2^VDQ_SHARD_SHIFT byte regions, so I/Os that could be aggregated usually
+ * land in the same shard, while random I/Os spread evenly.  An I/O completes
+ * in the shard it was queued to, which then issues its next queued I/Os.
+ * Each shard is scheduled as described above, but with a share of the
+ * per-class and aggregate limits: limit / n each, with the remainder going
+ * to the first shards, so the shares add up to the device-wide limit.
+ *
+ * That would leave the other shards no share of a class maximum lower than
+ * the number of shards, e.g. zfs_vdev_scrub_max_active, and their I/Os of
+ * that class would never be issued.  So for the per-class maximums the
+ * limit % n slots left over are "spill" slots shared by all shards of the
+ * vdev instead, taken and released with atomics on shard 0.  A shard that
+ * finds none free marks itself in vq_spill_wait, and the shard that next
+ * releases one issues its queued I/Os on its behalf.
+ *
+ * Queue Bypass
+ *
+ * Devices with deep hardware queues gain little from having sync I/Os sorted
+ * and aggregated, while the extra queueing adds to their latency.  When the
+ * queue_bypass vdev property is set on a leaf vdev, sync read and sync write
+ * I/Os are issued to the device as soon as they arrive.  They are still
+ * accounted as active in their class, so they count towards
+ * zfs_vdev_max_active, are seen by the deadman and make the remaining
+ * classes back off as usual.  All other classes are queued and aggregated
+ * as described above.  The effect is visible in the syncq_wait columns of
+ * "zpool iostat -l" and the queue histograms of "zpool iostat -w".
  */
 
 /*
@@ -204,6 +237,160 @@ static uint_t zfs_vdev_aggregation_limit_non_rotating = SPA_OLD_MAXBLOCKSIZE;
 static uint_t zfs_vdev_read_gap_limit = 32 << 10;
 static uint_t zfs_vdev_write_gap_limit = 4 << 10;
 
+/*
+ * Number of shards the queue of each non-rotating leaf vdev is split into,
+ * see "Queue Shards" above.  Applied when the vdev is allocated, that is on
+ * pool import or vdev addition.  1 disables sharding.
+ */
+static uint_t zfs_vdev_queue_shards = 1;
+#define	VDQ_MAX_SHARDS	64
+#define	VDQ_SHARD_SHIFT	20
+
+/*
+ * Also measure the time vq_lock is held for, reported in vdev_queue_stats.
+ * This costs two clock reads per lock acquisition, so it is off by default.
+ * The wait time of contended acquisitions is always measured.
+ */
+static int zfs_vdev_queue_lock_timing = 0;
+
+typedef struct vdev_queue_stats {
+	kstat_named_t vqs_lock_acquired;
+	kstat_named_t vqs_lock_contended;
+	kstat_named_t vqs_lock_wait_ns;
+	kstat_named_t vqs_lock_hold_ns;
+	kstat_named_t vqs_bypassed;
+} vdev_queue_stats_t;
+
+static vdev_queue_stats_t vdev_queue_stats = {
+	{ "lock_acquired",		KSTAT_DATA_UINT64 },
+	{ "lock_contended",		KSTAT_DATA_UINT64 },
+	{ "lock_wait_ns",		KSTAT_DATA_UINT64 },
+	{ "lock_hold_ns",		KSTAT_DATA_UINT64 },
+	{ "bypassed",			KSTAT_DATA_UINT64 },
+};
+
+static struct {
+	wmsum_t vqs_lock_acquired;
+	wmsum_t vqs_lock_contended;
+	wmsum_t vqs_lock_wait_ns;
+	wmsum_t vqs_lock_hold_ns;
+	wmsum_t vqs_bypassed;
+} vdev_queue_sums;
+
+#define	VQSTAT_BUMP(stat)	wmsum_add(&vdev_queue_sums.stat, 1)
+#define	VQSTAT_ADD(stat, val)	wmsum_add(&vdev_queue_sums.stat, val)
+
+static kstat_t *vdev_queue_ksp;
+
+static int
+vdev_queue_kstats_update(kstat_t *ksp, int rw)
+{
+	vdev_queue_stats_t *vqs = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (EACCES);
+	vqs->vqs_lock_acquired.value.ui64 =
+	    wmsum_value(&vdev_queue_sums.vqs_lock_acquired);
+	vqs->vqs_lock_contended.value.ui64 =
+	    wmsum_value(&vdev_queue_sums.vqs_lock_contended);
+	vqs->vqs_lock_wait_ns.value.ui64 =
+	    wmsum_value(&vdev_queue_sums.vqs_lock_wait_ns);
+	vqs->vqs_lock_hold_ns.value.ui64 =
+	    wmsum_value(&vdev_queue_sums.vqs_lock_hold_ns);
+	vqs->vqs_bypassed.value.ui64 =
+	    wmsum_value(&vdev_queue_sums.vqs_bypassed);
+	return (0);
+}
+
+void
+vdev_queue_stat_init(void)
+{
+	wmsum_init(&vdev_queue_sums.vqs_lock_acquired, 0);
+	wmsum_init(&vdev_queue_sums.vqs_lock_contended, 0);
+	wmsum_init(&vdev_queue_sums.vqs_lock_wait_ns, 0);
+	wmsum_init(&vdev_queue_sums.vqs_lock_hold_ns, 0);
+	wmsum_init(&vdev_queue_sums.vqs_bypassed, 0);
+
+	vdev_queue_ksp = kstat_create("zfs", 0, "vdev_queue_stats", "misc",
+	    KSTAT_TYPE_NAMED,
+	    sizeof (vdev_queue_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (vdev_queue_ksp != NULL) {
+		vdev_queue_ksp->ks_data = &vdev_queue_stats;
+		vdev_queue_ksp->ks_update = vdev_queue_kstats_update;
+		kstat_install(vdev_queue_ksp);
+	}
+}
+
+void
+vdev_queue_stat_fini(void)
+{
+	if (vdev_queue_ksp != NULL) {
+		kstat_delete(vdev_queue_ksp);
+		vdev_queue_ksp = NULL;
+	}
+
+	wmsum_fini(&vdev_queue_sums.vqs_lock_acquired);
+	wmsum_fini(&vdev_queue_sums.vqs_lock_contended);
+	wmsum_fini(&vdev_queue_sums.vqs_lock_wait_ns);
+	wmsum_fini(&vdev_queue_sums.vqs_lock_hold_ns);
+	wmsum_fini(&vdev_queue_sums.vqs_bypassed);
+}
+
+static inline void
+vdev_queue_enter(vdev_queue_t *vq)
+{
+	if (!mutex_tryenter(&vq->vq_lock)) {
+		hrtime_t start = gethrtime();
+		mutex_enter(&vq->vq_lock);
+		VQSTAT_BUMP(vqs_lock_contended);
+		VQSTAT_ADD(vqs_lock_wait_ns, gethrtime() - start);
+	}
+	VQSTAT_BUMP(vqs_lock_acquired);
+	if (zfs_vdev_queue_lock_timing)
+		vq->vq_lock_ts = gethrtime();
+}
+
+static inline void
+vdev_queue_exit(vdev_queue_t *vq)
+{
+	if (vq->vq_lock_ts != 0) {
+		VQSTAT_ADD(vqs_lock_hold_ns, gethrtime() - vq->vq_lock_ts);
+		vq->vq_lock_ts = 0;
+	}
+	mutex_exit(&vq->vq_lock);
+}
+
+/*
+ * Number of queue shards in use by the vdev.  Shards are only used while the
+ * vdev is non-rotating, but I/Os always complete in the shard they were
+ * queued to, so this may change while I/Os are in flight.
+ */
+static inline uint_t
+vdev_queue_nshards(vdev_t *vd)
+{
+	return (vd->vdev_nonrot ? vd->vdev_queue.vq_nshards : 1);
+}
+
+static inline uint_t
+vdev_queue_offset_shard(vdev_t *vd, uint64_t offset)
+{
+	uint_t n = vdev_queue_nshards(vd);
+
+	return (n > 1 ? (offset >> VDQ_SHARD_SHIFT) % n : 0);
+}
+
+/*
+ * A shard's share of a limit.  The shares of all shards add up to the limit.
+ */
+static inline uint_t
+vdev_queue_share(vdev_queue_t *vq, uint_t limit)
+{
+	uint_t n = vdev_queue_nshards(vq->vq_vdev);
+
+	return (n > 1 ? limit / n + (vq->vq_shard < limit % n) : limit);
+}
+
 static int
 vdev_queue_offset_compare(const void *x1, const void *x2)
 {
@@ -401,6 +588,52 @@ vdev_queue_class_max_active(vdev_queue_t *vq, zio_priority_t p)
 	}
 }
 
+/*
+ * Whether a shard may issue one more I/O of a class, up to the class
+ * maximum, taking a spill slot if it has used up its own share.  See
+ * "Queue Shards" above.
+ */
+static boolean_t
+vdev_queue_class_below_max(vdev_queue_t *vq, zio_priority_t p)
+{
+	vdev_queue_t *vq0 = &vq->vq_vdev->vdev_queue;
+	uint_t n = vdev_queue_nshards(vq->vq_vdev);
+	uint_t limit = vdev_queue_class_max_active(vq, p);
+	uint32_t used;
+
+	if (n == 1)
+		return (vq->vq_cactive[p] < limit);
+	if (vq->vq_cactive[p] - vq->vq_cspill[p] < limit / n)
+		return (B_TRUE);
+	if (limit % n == 0)
+		return (B_FALSE);
+
+	for (;;) {
+		used = atomic_load_32(&vq0->vq_spill[p]);
+		if (used >= limit % n) {
+			uint64_t wait = atomic_load_64(&vq0->vq_spill_wait);
+			uint64_t bit = 1ULL << vq->vq_shard;
+
+			if ((wait & bit) == 0 && atomic_cas_64(
+			    &vq0->vq_spill_wait, wait, wait | bit) != wait)
+				continue;
+			membar_sync();
+			if (atomic_load_32(&vq0->vq_spill[p]) >= limit % n)
+				return (B_FALSE);
+		} else if (atomic_cas_32(&vq0->vq_spill[p], used,
+		    used + 1) == used) {
+			vq->vq_spill_held = B_TRUE;
+			return (B_TRUE);
+		}
+	}
+}
+
+static inline void
+vdev_queue_spill_release(vdev_queue_t *vq, zio_priority_t p)
+{
+	atomic_dec_32(&vq->vq_vdev->vdev_queue.vq_spill[p]);
+}
+
 /*
  * Return the i/o class to issue from, or ZIO_PRIORITY_NUM_QUEUEABLE if
  * there is no eligible class.
@@ -411,7 +644,14 @@ vdev_queue_class_to_issue(vdev_queue_t *vq)
 	uint32_t cq = vq->vq_cqueued;
 	zio_priority_t p, p1;
 
-	if (cq == 0 || vq->vq_active >= zfs_vdev_max_active)
+	ASSERT(!vq->vq_spill_held);
+
+	/*
+	 * Every shard may have at least one I/O active, even if there are
+	 * more shards than zfs_vdev_max_active.
+	 */
+	if (cq == 0 || vq->vq_active >=
+	    MAX(vdev_queue_share(vq, zfs_vdev_max_active), 1))
 		return (ZIO_PRIORITY_NUM_QUEUEABLE);
 
 	/*
@@ -424,12 +664,12 @@ vdev_queue_class_to_issue(vdev_queue_t *vq)
 		p1 = 0;
 	for (p = p1; p < ZIO_PRIORITY_NUM_QUEUEABLE; p++) {
 		if ((cq & (1U << p)) != 0 && vq->vq_cactive[p] <
-		    vdev_queue_class_min_active(vq, p))
+		    vdev_queue_share(vq, vdev_queue_class_min_active(vq, p)))
 			goto found;
 	}
 	for (p = 0; p < p1; p++) {
 		if ((cq & (1U << p)) != 0 && vq->vq_cactive[p] <
-		    vdev_queue_class_min_active(vq, p))
+		    vdev_queue_share(vq, vdev_queue_class_min_active(vq, p)))
 			goto found;
 	}
 
@@ -438,8 +678,7 @@ vdev_queue_class_to_issue(vdev_queue_t *vq)
 	 * maximum # outstanding i/os.
 	 */
 	for (p = 0; p < ZIO_PRIORITY_NUM_QUEUEABLE; p++) {
-		if ((cq & (1U << p)) != 0 && vq->vq_cactive[p] <
-		    vdev_queue_class_max_active(vq, p))
+		if ((cq & (1U << p)) != 0 && vdev_queue_class_below_max(vq, p))
 			break;
 	}
 
@@ -448,13 +687,13 @@ found:
 	return (p);
 }
 
-void
-vdev_queue_init(vdev_t *vd)
+static void
+vdev_queue_init_impl(vdev_queue_t *vq, vdev_t *vd, uint_t s)
 {
-	vdev_queue_t *vq = &vd->vdev_queue;
 	zio_priority_t p;
 
 	vq->vq_vdev = vd;
+	vq->vq_shard = s;
 
 	for (p = 0; p < ZIO_PRIORITY_NUM_QUEUEABLE; p++) {
 		if (vdev_queue_class_fifo(p)) {
@@ -481,10 +720,32 @@ vdev_queue_init(vdev_t *vd)
 }
 
 void
-vdev_queue_fini(vdev_t *vd)
+vdev_queue_init(vdev_t *vd)
 {
 	vdev_queue_t *vq = &vd->vdev_queue;
 
+	vdev_queue_init_impl(vq, vd, 0);
+
+	/*
+	 * Whether the vdev is rotating is not known until it is opened, so
+	 * allocate the shards for every leaf and decide on their use later.
+	 */
+	vq->vq_nshards = 1;
+	if (vd->vdev_ops->vdev_op_leaf && zfs_vdev_queue_shards > 1) {
+		vq->vq_nshards = MIN(MIN(zfs_vdev_queue_shards, boot_ncpus),
+		    VDQ_MAX_SHARDS);
+	}
+	if (vq->vq_nshards > 1) {
+		vq->vq_shards = kmem_zalloc((vq->vq_nshards - 1) *
+		    sizeof (vdev_queue_t), KM_SLEEP);
+		for (uint_t s = 1; s < vq->vq_nshards; s++)
+			vdev_queue_init_impl(vdev_queue_shard(vq, s), vd, s);
+	}
+}
+
+static void
+vdev_queue_fini_impl(vdev_queue_t *vq)
+{
 	for (zio_priority_t p = 0; p < ZIO_PRIORITY_NUM_QUEUEABLE; p++) {
 		if (vdev_queue_class_fifo(p))
 			list_destroy(&vq->vq_class[p].vqc_list);
@@ -498,6 +759,21 @@ vdev_queue_fini(vdev_t *vd)
 	mutex_destroy(&vq->vq_lock);
 }
 
+void
+vdev_queue_fini(vdev_t *vd)
+{
+	vdev_queue_t *vq = &vd->vdev_queue;
+
+	if (vq->vq_nshards > 1) {
+		for (uint_t s = 1; s < vq->vq_nshards; s++)
+			vdev_queue_fini_impl(vdev_queue_shard(vq, s));
+		kmem_free(vq->vq_shards, (vq->vq_nshards - 1) *
+		    sizeof (vdev_queue_t));
+		vq->vq_shards = NULL;
+	}
+	vdev_queue_fini_impl(vq);
+}
+
 static void
 vdev_queue_io_add(vdev_queue_t *vq, zio_t *zio)
 {
@@ -541,6 +817,10 @@ vdev_queue_pending_add(vdev_queue_t *vq, zio_t *zio)
 	ASSERT3U(zio->io_priority, <, ZIO_PRIORITY_NUM_QUEUEABLE);
 	vq->vq_cactive[zio->io_priority]++;
 	vq->vq_active++;
+	if (vq->vq_spill_held) {
+		vq->vq_cspill[zio->io_priority]++;
+		vq->vq_spill_held = B_FALSE;
+	}
 	if (vdev_queue_is_interactive(zio->io_priority)) {
 		if (++vq->vq_ia_active == 1)
 			vq->vq_nia_credit = 1;
@@ -558,6 +838,10 @@ vdev_queue_pending_remove(vdev_queue_t *vq, zio_t *zio)
 	ASSERT3U(zio->io_priority, <, ZIO_PRIORITY_NUM_QUEUEABLE);
 	vq->vq_cactive[zio->io_priority]--;
 	vq->vq_active--;
+	if (vq->vq_cspill[zio->io_priority] > 0) {
+		vq->vq_cspill[zio->io_priority]--;
+		vdev_queue_spill_release(vq, zio->io_priority);
+	}
 	if (vdev_queue_is_interactive(zio->io_priority)) {
 		if (--vq->vq_ia_active == 0)
 			vq->vq_nia_credit = 0;
@@ -808,6 +1092,8 @@ vdev_queue_aggregate(vdev_queue_t *vq, zio_t *zio)
 	return (aio);
 }
 
+static void vdev_queue_spill_kick(vdev_t *vd);
+
 static zio_t *
 vdev_queue_io_to_issue(vdev_queue_t *vq)
 {
@@ -854,6 +1140,7 @@ again:
 
 	aio = vdev_queue_aggregate(vq, zio);
 	if (aio != NULL) {
+		aio->io_queue_shard = zio->io_queue_shard;
 		zio = aio;
 	} else {
 		vdev_queue_io_remove(vq, zio);
@@ -865,10 +1152,18 @@ again:
 		 * I/O will complete immediately.
 		 */
 		if (zio->io_flags & ZIO_FLAG_NODATA) {
-			mutex_exit(&vq->vq_lock);
+			boolean_t spill = vq->vq_spill_held;
+
+			if (spill) {
+				vdev_queue_spill_release(vq, p);
+				vq->vq_spill_held = B_FALSE;
+			}
+			vdev_queue_exit(vq);
+			if (spill)
+				vdev_queue_spill_kick(vq->vq_vdev);
 			zio_vdev_io_bypass(zio);
 			zio_execute(zio);
-			mutex_enter(&vq->vq_lock);
+			vdev_queue_enter(vq);
 			goto again;
 		}
 	}
@@ -879,10 +1174,62 @@ again:
 	return (zio);
 }
 
+/*
+ * Issue the I/Os which have become eligible in a shard, with its lock held.
+ */
+static void
+vdev_queue_issue(vdev_queue_t *vq)
+{
+	zio_t *dio, *nio;
+	zio_link_t *zl = NULL;
+
+	while ((nio = vdev_queue_io_to_issue(vq)) != NULL) {
+		vdev_queue_exit(vq);
+		if (nio->io_done == vdev_queue_agg_io_done) {
+			while ((dio = zio_walk_parents(nio, &zl)) != NULL) {
+				ASSERT3U(dio->io_type, ==, nio->io_type);
+				zio_vdev_io_bypass(dio);
+				zio_execute(dio);
+			}
+			zio_nowait(nio);
+		} else {
+			zio_vdev_io_reissue(nio);
+			zio_execute(nio);
+		}
+		vdev_queue_enter(vq);
+	}
+}
+
+/*
+ * After releasing a spill slot, issue the queued I/Os of the shards which
+ * were waiting for one.
+ */
+static void
+vdev_queue_spill_kick(vdev_t *vd)
+{
+	vdev_queue_t *vq0 = &vd->vdev_queue;
+	uint64_t wait;
+
+	membar_sync();
+	if (atomic_load_64(&vq0->vq_spill_wait) == 0)
+		return;
+
+	wait = atomic_swap_64(&vq0->vq_spill_wait, 0);
+	while (wait != 0) {
+		uint_t s = lowbit64(wait) - 1;
+		vdev_queue_t *vq = vdev_queue_shard(vq0, s);
+
+		wait &= ~(1ULL << s);
+		vdev_queue_enter(vq);
+		vdev_queue_issue(vq);
+		vdev_queue_exit(vq);
+	}
+}
+
 zio_t *
 vdev_queue_io(zio_t *zio)
 {
-	vdev_queue_t *vq = &zio->io_vd->vdev_queue;
+	vdev_queue_t *vq;
 	zio_t *dio, *nio;
 	zio_link_t *zl = NULL;
 
@@ -921,11 +1268,29 @@ vdev_queue_io(zio_t *zio)
 
 	zio->io_flags |= ZIO_FLAG_DONT_QUEUE;
 	zio->io_timestamp = gethrtime();
+	zio->io_queue_shard = vdev_queue_offset_shard(zio->io_vd,
+	    zio->io_offset);
+	vq = vdev_queue_shard(&zio->io_vd->vdev_queue, zio->io_queue_shard);
 
-	mutex_enter(&vq->vq_lock);
+	/*
+	 * With queue bypass, sync I/Os are only accounted as active and
+	 * then issued directly, see "Queue Bypass" above.
+	 */
+	if (zio->io_vd->vdev_queue_bypass &&
+	    (zio->io_priority == ZIO_PRIORITY_SYNC_READ ||
+	    zio->io_priority == ZIO_PRIORITY_SYNC_WRITE) &&
+	    !(zio->io_flags & ZIO_FLAG_NODATA)) {
+		vdev_queue_enter(vq);
+		vdev_queue_pending_add(vq, zio);
+		vdev_queue_exit(vq);
+		VQSTAT_BUMP(vqs_bypassed);
+		return (zio);
+	}
+
+	vdev_queue_enter(vq);
 	vdev_queue_io_add(vq, zio);
 	nio = vdev_queue_io_to_issue(vq);
-	mutex_exit(&vq->vq_lock);
+	vdev_queue_exit(vq);
 
 	if (nio == NULL)
 		return (NULL);
@@ -946,40 +1311,29 @@ vdev_queue_io(zio_t *zio)
 void
 vdev_queue_io_done(zio_t *zio)
 {
-	vdev_queue_t *vq = &zio->io_vd->vdev_queue;
-	zio_t *dio, *nio;
-	zio_link_t *zl = NULL;
+	vdev_queue_t *vq = vdev_queue_shard(&zio->io_vd->vdev_queue,
+	    zio->io_queue_shard);
+	boolean_t spill;
 
 	hrtime_t now = gethrtime();
-	vq->vq_io_complete_ts = now;
-	vq->vq_io_delta_ts = zio->io_delta = now - zio->io_timestamp;
+	zio->io_vd->vdev_queue.vq_io_complete_ts = now;
+	zio->io_vd->vdev_queue.vq_io_delta_ts = zio->io_delta =
+	    now - zio->io_timestamp;
 
-	mutex_enter(&vq->vq_lock);
+	vdev_queue_enter(vq);
+	spill = vq->vq_cspill[zio->io_priority] > 0;
 	vdev_queue_pending_remove(vq, zio);
+	vdev_queue_issue(vq);
+	vdev_queue_exit(vq);
 
-	while ((nio = vdev_queue_io_to_issue(vq)) != NULL) {
-		mutex_exit(&vq->vq_lock);
-		if (nio->io_done == vdev_queue_agg_io_done) {
-			while ((dio = zio_walk_parents(nio, &zl)) != NULL) {
-				ASSERT3U(dio->io_type, ==, nio->io_type);
-				zio_vdev_io_bypass(dio);
-				zio_execute(dio);
-			}
-			zio_nowait(nio);
-		} else {
-			zio_vdev_io_reissue(nio);
-			zio_execute(nio);
-		}
-		mutex_enter(&vq->vq_lock);
-	}
-
-	mutex_exit(&vq->vq_lock);
+	if (spill)
+		vdev_queue_spill_kick(zio->io_vd);
 }
 
 void
 vdev_queue_change_io_priority(zio_t *zio, zio_priority_t priority)
 {
-	vdev_queue_t *vq = &zio->io_vd->vdev_queue;
+	vdev_queue_t *vq;
 
 	/*
 	 * ZIO_PRIORITY_NOW is used by the vdev cache code and the aggregate zio
@@ -1005,7 +1359,21 @@ vdev_queue_change_io_priority(zio_t *zio, zio_priority_t priority)
 			priority = ZIO_PRIORITY_ASYNC_WRITE;
 	}
 
-	mutex_enter(&vq->vq_lock);
+	/*
+	 * A zio that is not queued yet may be about to be, so lock the shard
+	 * vdev_queue_io() would pick rather than trusting io_queue_shard.
+	 */
+	vq = vdev_queue_shard(&zio->io_vd->vdev_queue,
+	    vdev_queue_offset_shard(zio->io_vd, zio->io_offset));
+	vdev_queue_enter(vq);
+	if (zio->io_queue_state != ZIO_QS_NONE &&
+	    vq != vdev_queue_shard(&zio->io_vd->vdev_queue,
+	    zio->io_queue_shard)) {
+		vdev_queue_exit(vq);
+		vq = vdev_queue_shard(&zio->io_vd->vdev_queue,
+		    zio->io_queue_shard);
+		vdev_queue_enter(vq);
+	}
 
 	/*
 	 * If the zio is in none of the queues we can simply change
@@ -1022,7 +1390,7 @@ vdev_queue_change_io_priority(zio_t *zio, zio_priority_t priority)
 		zio->io_priority = priority;
 	}
 
-	mutex_exit(&vq->vq_lock);
+	vdev_queue_exit(vq);
 }
 
 boolean_t
@@ -1044,23 +1412,47 @@ vdev_queue_pool_busy(spa_t *spa)
 uint32_t
 vdev_queue_length(vdev_t *vd)
 {
-	return (vd->vdev_queue.vq_active);
+	uint32_t active = 0;
+
+	for (uint_t s = 0; s < vd->vdev_queue.vq_nshards; s++)
+		active += vdev_queue_shard(&vd->vdev_queue, s)->vq_active;
+	return (active);
 }
 
+/*
+ * Return the end of the last I/O issued from the queue shard that an I/O
+ * at the given offset would be queued to.
+ */
 uint64_t
-vdev_queue_last_offset(vdev_t *vd)
+vdev_queue_last_offset(vdev_t *vd, uint64_t offset)
 {
-	return (vd->vdev_queue.vq_last_offset);
+	return (vdev_queue_shard(&vd->vdev_queue,
+	    vdev_queue_offset_shard(vd, offset))->vq_last_offset);
 }
 
 uint64_t
 vdev_queue_class_length(vdev_t *vd, zio_priority_t p)
 {
-	vdev_queue_t *vq = &vd->vdev_queue;
-	if (vdev_queue_class_fifo(p))
-		return (vq->vq_class[p].vqc_list_numnodes);
-	else
-		return (avl_numnodes(&vq->vq_class[p].vqc_tree));
+	uint64_t length = 0;
+
+	for (uint_t s = 0; s < vd->vdev_queue.vq_nshards; s++) {
+		vdev_queue_t *vq = vdev_queue_shard(&vd->vdev_queue, s);
+		if (vdev_queue_class_fifo(p))
+			length += vq->vq_class[p].vqc_list_numnodes;
+		else
+			length += avl_numnodes(&vq->vq_class[p].vqc_tree);
+	}
+	return (length);
+}
+
+uint32_t
+vdev_queue_class_active(vdev_t *vd, zio_priority_t p)
+{
+	uint32_t active = 0;
+
+	for (uint_t s = 0; s < vd->vdev_queue.vq_nshards; s++)
+		active += vdev_queue_shard(&vd->vdev_queue, s)->vq_cactive[p];
+	return (active);
 }
 
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, aggregation_limit, UINT, ZMOD_RW,
@@ -1078,6 +1470,12 @@ ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, write_gap_limit, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, max_active, UINT, ZMOD_RW,
 	"Maximum number of active I/Os per vdev");
 
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, queue_shards, UINT, ZMOD_RW,
+	"Number of I/O queue shards per non-rotating vdev");
+
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, queue_lock_timing, INT, ZMOD_RW,
+	"Measure vdev queue lock hold time");
+
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, async_write_active_max_dirty_percent,
 	UINT, ZMOD_RW, "Async write concurrency max threshold");
 
@@ -4981,6 +4981,13 @@ zfs_check_settable(const char *dsname, nvpair_t *pair, cred_t *cr)
 					spa_close(spa, FTAG);
 					return (SET_ERROR(ENOTSUP));
 				}
+				if (ZIO_COMPRESS_LEVEL(intval) ==
+				    ZIO_ZSTD_LEVEL_AUTO &&
+				    !spa_feature_is_enabled(spa,
+				    SPA_FEATURE_COMPRESS_ADAPTIVE)) {
+					spa_close(spa, FTAG);
+					return (SET_ERROR(ENOTSUP));
+				}
 				spa_close(spa, FTAG);
 			}
 		}
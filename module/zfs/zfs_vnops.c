@@ -98,6 +98,18 @@ static int zfs_dio_enabled = 1;
  */
 static int zfs_dio_strict = 0;
 
+/*
+ * Maximum amount of file data, in bytes, that a single explicit prefetch
+ * request from an application (POSIX_FADV_WILLNEED or ZFS_IOC_PREFETCH)
+ * will read into the ARC.  Unlike dmu_prefetch_max, this is shared by all
+ * ranges of a ZFS_IOC_PREFETCH call.
+ */
+uint64_t zfs_prefetch_hint_max = 256 * 1024 * 1024;
+
+/*
+ * Number of ZFS_IOC_PREFETCH ranges copied in from user space at a time.
+ */
+#define	ZFS_PREFETCH_CHUNK	256
 
 /*
  * Maximum bytes to read per chunk in zfs_read().
@@ -2063,6 +2075,130 @@ zfs_clone_range_replay(znode_t *zp, uint64_t off, uint64_t len, uint64_t blksz,
 	return (error);
 }
 
+/*
+ * Asynchronously prefetch a range of a file into the ARC, up to max bytes
+ * of data.  The caller must have entered the file system.
+ *
+ *	IN:	zp	- znode of file to be prefetched.
+ *		off	- Offset of the range to prefetch.
+ *		len	- Length of the range, 0 means to the end of file.
+ *		max	- Maximum number of bytes to prefetch.
+ *
+ *	RETURN:	number of bytes prefetched.
+ */
+uint64_t
+zfs_prefetch(znode_t *zp, uint64_t off, uint64_t len, uint64_t max)
+{
+	if (off >= zp->z_size || max == 0)
+		return (0);
+	if (len == 0 || len > zp->z_size - off)
+		len = zp->z_size - off;
+
+	dmu_buf_impl_t *db = (dmu_buf_impl_t *)sa_get_db(zp->z_sa_hdl);
+	DB_DNODE_ENTER(db);
+	uint64_t n = dmu_prefetch_by_dnode_limit(DB_DNODE(db), 0, off, len,
+	    max, ZIO_PRIORITY_ASYNC_READ);
+	DB_DNODE_EXIT(db);
+
+	return (n);
+}
+
+/*
+ * Prefetch a batch of file ranges for ZFS_IOC_PREFETCH.  Each range names
+ * a regular file in the same dataset as zp, or zp itself, and all of them
+ * are issued in one pass without waiting for any I/O.  Naming other files
+ * by object number skips the search permission of their directories, and
+ * the errors would tell which objects exist, so that requires the same
+ * privilege as opening a file by handle.  The total amount
+ * prefetched is limited by zfs_prefetch_hint_max; ranges past that limit
+ * are ignored.  On error, the ranges before the failing one have already
+ * been issued.
+ *
+ *	IN:	zp	- znode of file the ioctl was issued on.
+ *		args	- Ranges array address, count, and flags.
+ *		flag	- ddi_copyin() flags for the ranges array.
+ *		cr	- credentials of caller.
+ *
+ *	RETURN:	0 if success
+ *		error code if failure
+ */
+int
+zfs_prefetch_ranges(znode_t *zp, const zfs_prefetch_args_t *args, int flag,
+    cred_t *cr)
+{
+	zfsvfs_t *zfsvfs = ZTOZSB(zp);
+	int error;
+
+	if (args->flags != 0 || args->arg != 0)
+		return (SET_ERROR(EINVAL));
+	if (args->count == 0)
+		return (0);
+
+	if ((error = zfs_enter_verify_zp(zfsvfs, zp, FTAG)) != 0)
+		return (error);
+
+	uint64_t budget = zfs_prefetch_hint_max;
+	uint64_t chunk = MIN(args->count, ZFS_PREFETCH_CHUNK);
+	zfs_prefetch_range_t *zpr = kmem_alloc(chunk * sizeof (*zpr), KM_SLEEP);
+
+	for (uint64_t i = 0; i < args->count && budget > 0; i += chunk) {
+		uint64_t n = MIN(args->count - i, chunk);
+		if (ddi_copyin((void *)(uintptr_t)(args->ranges +
+		    i * sizeof (*zpr)), zpr, n * sizeof (*zpr), flag) != 0) {
+			error = SET_ERROR(EFAULT);
+			break;
+		}
+
+		for (uint64_t j = 0; j < n && budget > 0; j++) {
+			znode_t *xzp = zp;
+
+			/* Other files must be readable by the caller. */
+			if (zpr[j].object != 0 && zpr[j].object != zp->z_id) {
+				error = secpolicy_fhopen(cr);
+				if (error != 0)
+					break;
+				error = zfs_zget(zfsvfs, zpr[j].object, &xzp);
+				if (error != 0)
+					break;
+				if (!S_ISREG(xzp->z_mode))
+					error = SET_ERROR(EINVAL);
+				else
+#if defined(__linux__)
+					error = zfs_zaccess(xzp, ACE_READ_DATA,
+					    0, B_FALSE, cr, zfs_init_idmap);
+#else
+					error = zfs_zaccess(xzp, ACE_READ_DATA,
+					    0, B_FALSE, cr, NULL);
+#endif
+			} else if (!S_ISREG(zp->z_mode)) {
+				error = SET_ERROR(EINVAL);
+			}
+
+			if (error == 0) {
+				uint64_t nb = zfs_prefetch(xzp, zpr[j].off,
+				    zpr[j].len, budget);
+				budget -= MIN(nb, budget);
+			}
+			if (xzp != zp)
+				zrele(xzp);
+			if (error != 0)
+				break;
+		}
+		if (error != 0)
+			break;
+
+		if (issig()) {
+			error = SET_ERROR(EINTR);
+			break;
+		}
+	}
+
+	kmem_free(zpr, chunk * sizeof (*zpr));
+	zfs_exit(zfsvfs, FTAG);
+
+	return (error);
+}
+
 EXPORT_SYMBOL(zfs_access);
 EXPORT_SYMBOL(zfs_fsync);
 EXPORT_SYMBOL(zfs_holey);
@@ -2076,6 +2212,9 @@ EXPORT_SYMBOL(zfs_clone_range_replay);
 ZFS_MODULE_PARAM(zfs_vnops, zfs_vnops_, read_chunk_size, U64, ZMOD_RW,
 	"Bytes to read per chunk");
 
+ZFS_MODULE_PARAM(zfs, zfs_, prefetch_hint_max, U64, ZMOD_RW,
+	"Max bytes to prefetch per application prefetch request");
+
 ZFS_MODULE_PARAM(zfs, zfs_, bclone_enabled, INT, ZMOD_RW,
 	"Enable block cloning");
 
@@ -96,11 +96,36 @@
 static uint_t zfs_commit_timeout_pct = 10;
 
 /*
- * See zil.h for more information about these fields.
+ * Target latency (in microseconds) of a ZIL commit when several threads
+ * are committing concurrently.  When set, an lwb may be held open for up
+ * to this long, less the measured lwb write latency, so that commits
+ * arriving in the meantime share a single log write.  How long it is
+ * actually held adapts to whether waiting picks up more records; see
+ * zil_commit_delay_update().  Zero keeps the fixed zfs_commit_timeout_pct
+ * timeout.
  */
-static zil_kstat_values_t zil_stats = {
+static uint_t zil_commit_latency_us = 0;
+
+/*
+ * Keep a zil_commit() latency histogram per dataset, as well as the global
+ * one.  Each costs ZIL_HISTO_BUCKETS wmsums, so it is off by default.  It
+ * applies to datasets whose kstats are created afterwards.
+ */
+int zil_dataset_histo = 0;
+
+/*
+ * See zil.h for more information about these fields.  The global kstat
+ * also carries the lwb write and flush latency histograms.
+ */
+static struct {
+	zil_kstat_values_t	zgs_zil;
+	kstat_named_t		zgs_lwb_histo[ZIL_HISTO_BUCKETS];
+	kstat_named_t		zgs_flush_histo[ZIL_HISTO_BUCKETS];
+} zil_stats = { {
 	{ "zil_commit_count",			KSTAT_DATA_UINT64 },
 	{ "zil_commit_writer_count",		KSTAT_DATA_UINT64 },
+	{ "zil_commit_issuer_contended_count",	KSTAT_DATA_UINT64 },
+	{ "zil_commit_issuer_wait_time",	KSTAT_DATA_UINT64 },
 	{ "zil_commit_error_count",		KSTAT_DATA_UINT64 },
 	{ "zil_commit_stall_count",		KSTAT_DATA_UINT64 },
 	{ "zil_commit_suspend_count",		KSTAT_DATA_UINT64 },
@@ -120,9 +145,15 @@ static zil_kstat_values_t zil_stats = {
 	{ "zil_itx_metaslab_slog_bytes",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_write",	KSTAT_DATA_UINT64 },
 	{ "zil_itx_metaslab_slog_alloc",	KSTAT_DATA_UINT64 },
-};
+	{ "zil_replay_count",			KSTAT_DATA_UINT64 },
+	{ "zil_replay_bytes",			KSTAT_DATA_UINT64 },
+	{ "zil_replay_time",			KSTAT_DATA_UINT64 },
+	{ "zil_replay_prefetch_count",		KSTAT_DATA_UINT64 },
+} };
 
 static zil_sums_t zil_sums_global;
+static wmsum_t zil_lwb_histo[ZIL_HISTO_BUCKETS];
+static wmsum_t zil_flush_histo[ZIL_HISTO_BUCKETS];
 static kstat_t *zil_kstats_global;
 
 /*
@@ -130,6 +161,23 @@ static kstat_t *zil_kstats_global;
  */
 int zil_replay_disable = 0;
 
+/*
+ * Number of log records zil_replay() parses ahead of the record it is
+ * applying.  As each record is queued, the dnodes, indirect blocks and
+ * out-of-line write data it will need are prefetched, so that the reads
+ * for many independent objects are in flight while records are applied
+ * one at a time in log order.  Zero applies every record as soon as it
+ * is parsed, without any prefetching.
+ */
+static uint_t zil_replay_prefetch = 64;
+
+/*
+ * Maximum number of threads issuing replay prefetches for one dataset.
+ * Resolving a write's target blocks needs its dnode, which may have to
+ * be read synchronously, so this is done off the replay thread.
+ */
+static uint_t zil_replay_prefetch_threads = 8;
+
 /*
  * Disable the flush commands that are normally sent to the disk(s) by the ZIL
  * after an LWB write has completed. Setting this will cause ZIL corruption on
@@ -150,6 +198,8 @@ static kmem_cache_t *zil_zcw_cache;
 static int zil_lwb_commit(zilog_t *zilog, lwb_t *lwb, itx_t *itx);
 static itx_t *zil_itx_clone(itx_t *oitx);
 static uint64_t zil_max_waste_space(zilog_t *zilog);
+static void zil_commit_delay_update(zilog_t *zilog, boolean_t batched);
+static void zil_kstat_histo_update(kstat_named_t *ks, wmsum_t *histo);
 
 static int
 zil_bp_compare(const void *x1, const void *x2)
@@ -229,14 +279,15 @@ zil_init_log_chain(zilog_t *zilog, blkptr_t *bp)
 static int
 zil_kstats_global_update(kstat_t *ksp, int rw)
 {
-	zil_kstat_values_t *zs = ksp->ks_data;
-	ASSERT3P(&zil_stats, ==, zs);
+	ASSERT3P(&zil_stats, ==, ksp->ks_data);
 
 	if (rw == KSTAT_WRITE) {
 		return (SET_ERROR(EACCES));
 	}
 
-	zil_kstat_values_update(zs, &zil_sums_global);
+	zil_kstat_values_update(&zil_stats.zgs_zil, &zil_sums_global);
+	zil_kstat_histo_update(zil_stats.zgs_lwb_histo, zil_lwb_histo);
+	zil_kstat_histo_update(zil_stats.zgs_flush_histo, zil_flush_histo);
 
 	return (0);
 }
@@ -362,10 +413,12 @@ zil_read_log_data(zilog_t *zilog, const lr_write_t *lr, void *wbuf)
 }
 
 void
-zil_sums_init(zil_sums_t *zs)
+zil_sums_init(zil_sums_t *zs, boolean_t histo)
 {
 	wmsum_init(&zs->zil_commit_count, 0);
 	wmsum_init(&zs->zil_commit_writer_count, 0);
+	wmsum_init(&zs->zil_commit_issuer_contended_count, 0);
+	wmsum_init(&zs->zil_commit_issuer_wait_time, 0);
 	wmsum_init(&zs->zil_commit_error_count, 0);
 	wmsum_init(&zs->zil_commit_stall_count, 0);
 	wmsum_init(&zs->zil_commit_suspend_count, 0);
@@ -385,6 +438,17 @@ zil_sums_init(zil_sums_t *zs)
 	wmsum_init(&zs->zil_itx_metaslab_slog_bytes, 0);
 	wmsum_init(&zs->zil_itx_metaslab_slog_write, 0);
 	wmsum_init(&zs->zil_itx_metaslab_slog_alloc, 0);
+	wmsum_init(&zs->zil_replay_count, 0);
+	wmsum_init(&zs->zil_replay_bytes, 0);
+	wmsum_init(&zs->zil_replay_time, 0);
+	wmsum_init(&zs->zil_replay_prefetch_count, 0);
+	zs->zil_commit_histo = NULL;
+	if (histo) {
+		zs->zil_commit_histo = kmem_alloc(ZIL_HISTO_BUCKETS *
+		    sizeof (wmsum_t), KM_SLEEP);
+		for (int i = 0; i < ZIL_HISTO_BUCKETS; i++)
+			wmsum_init(&zs->zil_commit_histo[i], 0);
+	}
 }
 
 void
@@ -392,6 +456,8 @@ zil_sums_fini(zil_sums_t *zs)
 {
 	wmsum_fini(&zs->zil_commit_count);
 	wmsum_fini(&zs->zil_commit_writer_count);
+	wmsum_fini(&zs->zil_commit_issuer_contended_count);
+	wmsum_fini(&zs->zil_commit_issuer_wait_time);
 	wmsum_fini(&zs->zil_commit_error_count);
 	wmsum_fini(&zs->zil_commit_stall_count);
 	wmsum_fini(&zs->zil_commit_suspend_count);
@@ -411,6 +477,56 @@ zil_sums_fini(zil_sums_t *zs)
 	wmsum_fini(&zs->zil_itx_metaslab_slog_bytes);
 	wmsum_fini(&zs->zil_itx_metaslab_slog_write);
 	wmsum_fini(&zs->zil_itx_metaslab_slog_alloc);
+	wmsum_fini(&zs->zil_replay_count);
+	wmsum_fini(&zs->zil_replay_bytes);
+	wmsum_fini(&zs->zil_replay_time);
+	wmsum_fini(&zs->zil_replay_prefetch_count);
+	if (zs->zil_commit_histo != NULL) {
+		for (int i = 0; i < ZIL_HISTO_BUCKETS; i++)
+			wmsum_fini(&zs->zil_commit_histo[i]);
+		kmem_free(zs->zil_commit_histo, ZIL_HISTO_BUCKETS *
+		    sizeof (wmsum_t));
+		zs->zil_commit_histo = NULL;
+	}
+}
+
+static void
+zil_kstat_histo_init(kstat_named_t *ks, const char *name)
+{
+	for (int i = 0; i < ZIL_HISTO_BUCKETS; i++) {
+		ks[i].data_type = KSTAT_DATA_UINT64;
+		(void) snprintf(ks[i].name, KSTAT_STRLEN, "%s_%lluus", name,
+		    (u_longlong_t)1 << (i + ZIL_HISTO_MIN_SHIFT));
+	}
+}
+
+/*
+ * The histogram entries can't be named statically, so this must be called
+ * on every zil_kstat_values_t before its kstat is installed.
+ */
+void
+zil_kstat_values_init(zil_kstat_values_t *zs)
+{
+	zil_kstat_histo_init(zs->zil_commit_histo, "zil_commit_histo");
+}
+
+/*
+ * Histogram bucket for a latency of "delta" nanoseconds.
+ */
+int
+zil_histo_bucket(hrtime_t delta)
+{
+	uint64_t us = NSEC2USEC(MAX(delta, 0));
+
+	return (MIN(highbit64(us >> ZIL_HISTO_MIN_SHIFT),
+	    ZIL_HISTO_BUCKETS - 1));
+}
+
+static void
+zil_kstat_histo_update(kstat_named_t *ks, wmsum_t *histo)
+{
+	for (int i = 0; i < ZIL_HISTO_BUCKETS; i++)
+		ks[i].value.ui64 = wmsum_value(&histo[i]);
 }
 
 void
@@ -420,6 +536,10 @@ zil_kstat_values_update(zil_kstat_values_t *zs, zil_sums_t *zil_sums)
 	    wmsum_value(&zil_sums->zil_commit_count);
 	zs->zil_commit_writer_count.value.ui64 =
 	    wmsum_value(&zil_sums->zil_commit_writer_count);
+	zs->zil_commit_issuer_contended_count.value.ui64 =
+	    wmsum_value(&zil_sums->zil_commit_issuer_contended_count);
+	zs->zil_commit_issuer_wait_time.value.ui64 =
+	    wmsum_value(&zil_sums->zil_commit_issuer_wait_time);
 	zs->zil_commit_error_count.value.ui64 =
 	    wmsum_value(&zil_sums->zil_commit_error_count);
 	zs->zil_commit_stall_count.value.ui64 =
@@ -458,6 +578,18 @@ zil_kstat_values_update(zil_kstat_values_t *zs, zil_sums_t *zil_sums)
 	    wmsum_value(&zil_sums->zil_itx_metaslab_slog_write);
 	zs->zil_itx_metaslab_slog_alloc.value.ui64 =
 	    wmsum_value(&zil_sums->zil_itx_metaslab_slog_alloc);
+	zs->zil_replay_count.value.ui64 =
+	    wmsum_value(&zil_sums->zil_replay_count);
+	zs->zil_replay_bytes.value.ui64 =
+	    wmsum_value(&zil_sums->zil_replay_bytes);
+	zs->zil_replay_time.value.ui64 =
+	    wmsum_value(&zil_sums->zil_replay_time);
+	zs->zil_replay_prefetch_count.value.ui64 =
+	    wmsum_value(&zil_sums->zil_replay_prefetch_count);
+	if (zil_sums->zil_commit_histo != NULL) {
+		zil_kstat_histo_update(zs->zil_commit_histo,
+		    zil_sums->zil_commit_histo);
+	}
 }
 
 /*
@@ -854,6 +986,7 @@ zil_alloc_lwb(zilog_t *zilog, blkptr_t *bp, int min_sz, int sz,
 	lwb->lwb_write_zio = NULL;
 	lwb->lwb_root_zio = NULL;
 	lwb->lwb_issued_timestamp = 0;
+	lwb->lwb_flush_timestamp = 0;
 	lwb->lwb_issued_txg = 0;
 	lwb->lwb_alloc_txg = txg;
 	lwb->lwb_max_txg = 0;
@@ -1362,6 +1495,7 @@ zil_commit_waiter_link_lwb(zil_commit_waiter_t *zcw, lwb_t *lwb)
 	list_insert_tail(&lwb->lwb_waiters, zcw);
 	ASSERT0P(zcw->zcw_lwb);
 	zcw->zcw_lwb = lwb;
+	zcw->zcw_nused = lwb->lwb_nused;
 }
 
 /*
@@ -1469,7 +1603,14 @@ zil_lwb_flush_vdevs_done(zio_t *zio)
 
 	spa_config_exit(zilog->zl_spa, SCL_STATE, lwb);
 
-	hrtime_t t = gethrtime() - lwb->lwb_issued_timestamp;
+	hrtime_t now = gethrtime();
+	hrtime_t t = now - lwb->lwb_issued_timestamp;
+
+	wmsum_add(&zil_lwb_histo[zil_histo_bucket(t)], 1);
+	if (lwb->lwb_flush_timestamp != 0) {
+		wmsum_add(&zil_flush_histo[zil_histo_bucket(now -
+		    lwb->lwb_flush_timestamp)], 1);
+	}
 
 	mutex_enter(&zilog->zl_lock);
 
@@ -1654,6 +1795,12 @@ zil_lwb_write_done(zio_t *zio)
 		return;
 	}
 
+	/*
+	 * The flushes are children of the root zio, so they can't complete
+	 * before this callback returns and zil_lwb_flush_vdevs_done() is
+	 * safe to read the timestamp.
+	 */
+	lwb->lwb_flush_timestamp = gethrtime();
 	while ((zv = avl_destroy_nodes(t, &cookie)) != NULL) {
 		vdev_t *vd = vdev_lookup_top(spa, zv->zv_vdev);
 		if (vd != NULL) {
@@ -2325,6 +2472,12 @@ cont:
 	    lwb_sp < zil_max_waste_space(zilog) &&
 	    (dlen % max_log_data == 0 ||
 	    lwb_sp < reclen + dlen % max_log_data))) {
+		/*
+		 * Commit waiters holding this lwb open got it filled, so
+		 * the batching delay is paying off.
+		 */
+		if (!list_is_empty(&lwb->lwb_waiters))
+			zil_commit_delay_update(zilog, B_TRUE);
 		list_insert_tail(ilwbs, lwb);
 		lwb = zil_lwb_write_close(zilog, lwb);
 		if (lwb == NULL)
@@ -3404,8 +3557,32 @@ zil_commit_writer(zilog_t *zilog, zil_commit_waiter_t *zcw)
 	ASSERT(!MUTEX_HELD(&zilog->zl_lock));
 	ASSERT(spa_writeable(zilog->zl_spa));
 
+	/*
+	 * If another writer has already linked this waiter to an lwb, or
+	 * it is already done, there is nothing for us to do, so return
+	 * without queueing up behind the current issuer.  The waiter is
+	 * unlinked again (zcw_lwb reset to NULL) when its lwb is flushed
+	 * or the ZIL crashes, but always together with setting zcw_done,
+	 * which is never cleared, so the condition stays true once it is.
+	 * Those updates are made under "zcw_lock", so take it rather than
+	 * reading the fields unlocked.  Linking sets zcw_lwb under
+	 * "zl_issuer_lock" only; if we miss that, we just fall through to
+	 * the check below, made under that lock.
+	 */
+	mutex_enter(&zcw->zcw_lock);
+	boolean_t handled = (zcw->zcw_lwb != NULL || zcw->zcw_done);
+	mutex_exit(&zcw->zcw_lock);
+	if (handled)
+		return (0);
+
 	list_create(&ilwbs, sizeof (lwb_t), offsetof(lwb_t, lwb_issue_node));
-	mutex_enter(&zilog->zl_issuer_lock);
+	if (!mutex_tryenter(&zilog->zl_issuer_lock)) {
+		hrtime_t wait = gethrtime();
+		mutex_enter(&zilog->zl_issuer_lock);
+		ZIL_STAT_BUMP(zilog, zil_commit_issuer_contended_count);
+		ZIL_STAT_INCR(zilog, zil_commit_issuer_wait_time,
+		    gethrtime() - wait);
+	}
 
 	if (zcw->zcw_lwb != NULL || zcw->zcw_done) {
 		/*
@@ -3454,6 +3631,63 @@ out:
 	return (wtxg);
 }
 
+/*
+ * Bounds of the time a commit waiter holds its lwb open for more records.
+ * The floor is the zfs_commit_timeout_pct share of the lwb latency; the
+ * ceiling is whatever zil_commit_latency_us leaves once the lwb write
+ * itself is accounted for.  Returns B_FALSE if there is no room between
+ * the two, i.e. no latency target or one the log device can't meet.
+ */
+static boolean_t
+zil_commit_delay_bounds(zilog_t *zilog, hrtime_t *floor, hrtime_t *ceil)
+{
+	hrtime_t latency = zilog->zl_last_lwb_latency;
+	hrtime_t target = USEC2NSEC((hrtime_t)zil_commit_latency_us);
+
+	*floor = (latency * MAX(zfs_commit_timeout_pct, 1)) / 100;
+	*ceil = target - latency;
+
+	return (*ceil > *floor);
+}
+
+static hrtime_t
+zil_commit_delay(zilog_t *zilog)
+{
+	hrtime_t floor, ceil;
+
+	if (!zil_commit_delay_bounds(zilog, &floor, &ceil))
+		return (floor);
+
+	return (MIN(MAX(zilog->zl_commit_delay, floor), ceil));
+}
+
+/*
+ * Called with whether holding an lwb open for commit waiters batched more
+ * records into it: when an lwb with waiters fills up, and when a waiter
+ * times out, depending on whether records were added since it was linked.
+ * If batching is paying off, the next waiter waits longer; if not, the
+ * wait only added latency and is cut back towards the floor.  The wait
+ * grows by at least 1/16 of the range, so that it gets going quickly
+ * from a floor which may be tiny (or zero, before any lwb completed).
+ */
+static void
+zil_commit_delay_update(zilog_t *zilog, boolean_t batched)
+{
+	hrtime_t floor, ceil;
+
+	ASSERT(MUTEX_HELD(&zilog->zl_issuer_lock));
+
+	if (!zil_commit_delay_bounds(zilog, &floor, &ceil))
+		return;
+
+	hrtime_t delay = MIN(MAX(zilog->zl_commit_delay, floor), ceil);
+	if (batched)
+		delay = MIN(delay + MAX(delay / 2, (ceil - floor) / 16), ceil);
+	else
+		delay = MAX(delay / 2, floor);
+	zilog->zl_commit_delay = delay;
+}
+
 static void
 zil_commit_waiter_timeout(zilog_t *zilog, zil_commit_waiter_t *zcw)
 {
@@ -3526,6 +3760,8 @@ zil_commit_waiter_timeout(zilog_t *zilog, zil_commit_waiter_t *zcw)
 		return;
 	}
 
+	zil_commit_delay_update(zilog, lwb->lwb_nused > zcw->zcw_nused);
+
 	/*
 	 * We do not need zcw_lock once we hold zl_issuer_lock and know lwb
 	 * is still open.  But we have to drop it to avoid a deadlock in case
@@ -3594,13 +3830,12 @@ zil_commit_waiter(zilog_t *zilog, zil_commit_waiter_t *zcw)
 
 	/*
 	 * The timeout is scaled based on the lwb latency to avoid
-	 * significantly impacting the latency of each individual itx.
-	 * For more details, see the comment at the bottom of the
-	 * zil_process_commit_list() function.
+	 * significantly impacting the latency of each individual itx,
+	 * and extended up to zil_commit_latency_us while doing so keeps
+	 * batching more itxs into the lwb.  For more details, see the
+	 * comment at the bottom of the zil_process_commit_list() function.
 	 */
-	int pct = MAX(zfs_commit_timeout_pct, 1);
-	hrtime_t sleep = (zilog->zl_last_lwb_latency * pct) / 100;
-	hrtime_t wakeup = gethrtime() + sleep;
+	hrtime_t wakeup = gethrtime() + zil_commit_delay(zilog);
 	boolean_t timedout = B_FALSE;
 
 	while (!zcw->zcw_done) {
@@ -3695,6 +3930,7 @@ zil_alloc_commit_waiter(void)
 	mutex_init(&zcw->zcw_lock, NULL, MUTEX_DEFAULT, NULL);
 	list_link_init(&zcw->zcw_node);
 	zcw->zcw_lwb = NULL;
+	zcw->zcw_nused = 0;
 	zcw->zcw_done = B_FALSE;
 	zcw->zcw_error = 0;
 
@@ -4054,6 +4290,8 @@ out:
 static int
 zil_commit_impl(zilog_t *zilog, uint64_t foid)
 {
+	hrtime_t start = gethrtime();
+
 	ZIL_STAT_BUMP(zilog, zil_commit_count);
 
 	/*
@@ -4109,6 +4347,7 @@ zil_commit_impl(zilog_t *zilog, uint64_t foid)
 		    TXG_WAIT_SUSPEND);
 	}
 
+	ZIL_STAT_HISTO(zilog, zil_commit_histo, gethrtime() - start);
 	zil_free_commit_waiter(zcw);
 
 	if (err == 0)
@@ -4248,7 +4487,14 @@ zil_init(void)
 	zil_zcw_cache = kmem_cache_create("zil_zcw_cache",
 	    sizeof (zil_commit_waiter_t), 0, NULL, NULL, NULL, NULL, NULL, 0);
 
-	zil_sums_init(&zil_sums_global);
+	zil_sums_init(&zil_sums_global, B_TRUE);
+	for (int i = 0; i < ZIL_HISTO_BUCKETS; i++) {
+		wmsum_init(&zil_lwb_histo[i], 0);
+		wmsum_init(&zil_flush_histo[i], 0);
+	}
+	zil_kstat_values_init(&zil_stats.zgs_zil);
+	zil_kstat_histo_init(zil_stats.zgs_lwb_histo, "zil_lwb_histo");
+	zil_kstat_histo_init(zil_stats.zgs_flush_histo, "zil_flush_histo");
 	zil_kstats_global = kstat_create("zfs", 0, "zil", "misc",
 	    KSTAT_TYPE_NAMED, sizeof (zil_stats) / sizeof (kstat_named_t),
 	    KSTAT_FLAG_VIRTUAL);
@@ -4273,6 +4519,10 @@ zil_fini(void)
 	}
 
 	zil_sums_fini(&zil_sums_global);
+	for (int i = 0; i < ZIL_HISTO_BUCKETS; i++) {
+		wmsum_fini(&zil_lwb_histo[i]);
+		wmsum_fini(&zil_flush_histo[i]);
+	}
 }
 
 void
@@ -4304,6 +4554,7 @@ zil_alloc(objset_t *os, zil_header_t *zh_phys)
 	zilog->zl_dirty_max_txg = 0;
 	zilog->zl_last_lwb_opened = NULL;
 	zilog->zl_last_lwb_latency = 0;
+	zilog->zl_commit_delay = 0;
 	zilog->zl_max_block_size = MIN(MAX(P2ALIGN_TYPED(zil_maxblocksize,
 	    ZIL_MIN_BLKSZ, uint64_t), ZIL_MIN_BLKSZ),
 	    spa_maxblocksize(dmu_objset_spa(os)));
@@ -4656,11 +4907,48 @@ zil_resume(void *cookie)
 	dsl_dataset_rele(dmu_objset_ds(os), suspend_tag);
 }
 
+/*
+ * Replay Prefetch
+ *
+ * Log records must be applied strictly in log order: each replay function
+ * records the sequence number of its record in the same tx that applies
+ * it (see zil_replaying()), so the set of records reflected in any synced
+ * txg has to be a prefix of the log for a crash during replay to resume
+ * correctly.  What dominates replay time, however, is not applying the
+ * records but the synchronous reads each one does first: the target
+ * dnode, the indirect blocks and any partially overwritten data block,
+ * and for indirect writes the data block itself.
+ *
+ * So rather than applying records as zil_parse() returns them, we queue up
+ * to zil_replay_prefetch records and, as each one is queued, issue
+ * prefetches for everything it will need.  The reads for independent
+ * objects then proceed concurrently while the oldest queued record is
+ * applied.  Prefetches are read-only, so records that reference several
+ * objects (renames, links, removes) need no special ordering.
+ */
+typedef struct zil_replay_rec {
+	list_node_t	zrr_node;
+	lr_t		*zrr_lr;	/* private copy of the log record */
+} zil_replay_rec_t;
+
+typedef struct zil_replay_prefetch_arg {
+	objset_t	*zrp_os;
+	uint64_t	zrp_object;
+	uint64_t	zrp_offset;
+	uint64_t	zrp_length;
+} zil_replay_prefetch_arg_t;
+
 typedef struct zil_replay_arg {
 	zil_replay_func_t *const *zr_replay;
 	void		*zr_arg;
 	boolean_t	zr_byteswap;
 	char		*zr_lr;
+	taskq_t		*zr_prefetch_tq;	/* NULL if not prefetching */
+	list_t		zr_queue;		/* parsed, not yet applied */
+	uint64_t	zr_queued;
+	int		zr_error;		/* first replay error */
+	uint64_t	zr_records;		/* records applied */
+	uint64_t	zr_bytes;		/* log bytes applied */
 } zil_replay_arg_t;
 
 static int
@@ -4681,24 +4969,20 @@ zil_replay_error(zilog_t *zilog, const lr_t *lr, int error)
 	return (error);
 }
 
+/*
+ * Apply a single log record.  The caller has already skipped records
+ * which were replayed or committed before the crash.
+ */
 static int
-zil_replay_log_record(zilog_t *zilog, const lr_t *lr, void *zra,
-    uint64_t claim_txg)
+zil_replay_apply(zilog_t *zilog, zil_replay_arg_t *zr, const lr_t *lr)
 {
-	zil_replay_arg_t *zr = zra;
-	const zil_header_t *zh = zilog->zl_header;
 	uint64_t reclen = lr->lrc_reclen;
 	uint64_t txtype = lr->lrc_txtype;
+	uint64_t datalen = 0;
 	int error = 0;
 
 	zilog->zl_replaying_seq = lr->lrc_seq;
 
-	if (lr->lrc_seq <= zh->zh_replay_seq)	/* already replayed */
-		return (0);
-
-	if (lr->lrc_txg < claim_txg)		/* already committed */
-		return (0);
-
 	/* Strip case-insensitive bit, still present in log record */
 	txtype &= ~TX_CI;
 
@@ -4729,6 +5013,7 @@ zil_replay_log_record(zilog_t *zilog, const lr_t *lr, void *zra,
 		    zr->zr_lr + reclen);
 		if (error != 0)
 			return (zil_replay_error(zilog, lr, error));
+		datalen = BP_GET_LSIZE(&((lr_write_t *)lr)->lr_blkptr);
 	}
 
 	/*
@@ -4761,6 +5046,180 @@ zil_replay_log_record(zilog_t *zilog, const lr_t *lr, void *zra,
 		if (error != 0)
 			return (zil_replay_error(zilog, lr, error));
 	}
+
+	zr->zr_records++;
+	zr->zr_bytes += reclen + datalen;
+	ZIL_STAT_BUMP(zilog, zil_replay_count);
+	ZIL_STAT_INCR(zilog, zil_replay_bytes, reclen + datalen);
+
+	return (0);
+}
+
+static void
+zil_replay_prefetch_task(void *arg)
+{
+	zil_replay_prefetch_arg_t *zrp = arg;
+	uint64_t off = zrp->zrp_offset;
+	uint64_t end = off + zrp->zrp_length;
+	dnode_t *dn;
+
+	if (dnode_hold(zrp->zrp_os, zrp->zrp_object, FTAG, &dn) == 0) {
+		uint64_t blksz = dn->dn_datablksz;
+
+		/*
+		 * Dirtying the range needs the indirect blocks above it, but
+		 * only blocks that are partially overwritten need their old
+		 * contents.
+		 */
+		dmu_prefetch_by_dnode(dn, 1, off, end - off,
+		    ZIO_PRIORITY_ASYNC_READ);
+		if (P2PHASE(off, blksz) != 0)
+			dmu_prefetch_by_dnode(dn, 0, off, 1,
+			    ZIO_PRIORITY_ASYNC_READ);
+		if (P2PHASE(end, blksz) != 0)
+			dmu_prefetch_by_dnode(dn, 0, end - 1, 1,
+			    ZIO_PRIORITY_ASYNC_READ);
+		dnode_rele(dn, FTAG);
+	}
+
+	kmem_free(zrp, sizeof (*zrp));
+}
+
+/*
+ * Issue prefetches for everything replaying this record is going to read.
+ * This is purely advisory; records we don't understand are ignored.
+ */
+static void
+zil_replay_prefetch_record(zilog_t *zilog, zil_replay_arg_t *zr,
+    const lr_t *lr)
+{
+	objset_t *os = zilog->zl_os;
+	uint64_t txtype = lr->lrc_txtype & ~TX_CI;
+
+	if (zr->zr_byteswap || lr->lrc_reclen < sizeof (lr_ooo_t))
+		return;
+
+	/*
+	 * Every record type starts with the object it modifies, or with
+	 * the directory it modifies for namespace operations.
+	 */
+	uint64_t obj = LR_FOID_GET_OBJ(((const lr_ooo_t *)lr)->lr_foid);
+	dmu_prefetch_dnode(os, obj, ZIO_PRIORITY_ASYNC_READ);
+
+	switch (txtype) {
+	case TX_LINK:
+		if (lr->lrc_reclen >= sizeof (lr_link_t)) {
+			dmu_prefetch_dnode(os, ((const lr_link_t *)lr)->
+			    lr_link_obj, ZIO_PRIORITY_ASYNC_READ);
+		}
+		break;
+	case TX_RENAME:
+	case TX_RENAME_EXCHANGE:
+	case TX_RENAME_WHITEOUT:
+		if (lr->lrc_reclen >= sizeof (_lr_rename_t)) {
+			dmu_prefetch_dnode(os, ((const _lr_rename_t *)lr)->
+			    lr_tdoid, ZIO_PRIORITY_ASYNC_READ);
+		}
+		break;
+	case TX_WRITE: {
+		const lr_write_t *lrw = (const lr_write_t *)lr;
+
+		if (lr->lrc_reclen < sizeof (lr_write_t) ||
+		    lrw->lr_length == 0)
+			break;
+
+		if (lr->lrc_reclen == sizeof (lr_write_t) &&
+		    !BP_IS_HOLE(&lrw->lr_blkptr)) {
+			const blkptr_t *bp = &lrw->lr_blkptr;
+			arc_flags_t aflags = ARC_FLAG_NOWAIT |
+			    ARC_FLAG_PREFETCH | ARC_FLAG_PRESCIENT_PREFETCH;
+			zbookmark_phys_t zb;
+
+			SET_BOOKMARK(&zb, dmu_objset_id(os), lrw->lr_foid,
+			    ZB_ZIL_LEVEL, lrw->lr_offset / BP_GET_LSIZE(bp));
+			(void) arc_read(NULL, zilog->zl_spa, bp, NULL, NULL,
+			    ZIO_PRIORITY_ASYNC_READ,
+			    ZIO_FLAG_CANFAIL | ZIO_FLAG_SPECULATIVE,
+			    &aflags, &zb);
+			ZIL_STAT_BUMP(zilog, zil_replay_prefetch_count);
+		}
+
+		zil_replay_prefetch_arg_t *zrp = kmem_alloc(sizeof (*zrp),
+		    KM_SLEEP);
+		zrp->zrp_os = os;
+		zrp->zrp_object = obj;
+		zrp->zrp_offset = lrw->lr_offset;
+		zrp->zrp_length = lrw->lr_length;
+		VERIFY3U(taskq_dispatch(zr->zr_prefetch_tq,
+		    zil_replay_prefetch_task, zrp, TQ_SLEEP), !=,
+		    TASKQID_INVALID);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/*
+ * Apply the oldest queued record.
+ */
+static int
+zil_replay_dequeue(zilog_t *zilog, zil_replay_arg_t *zr)
+{
+	zil_replay_rec_t *zrr = list_remove_head(&zr->zr_queue);
+	int error;
+
+	ASSERT3P(zrr, !=, NULL);
+	zr->zr_queued--;
+
+	error = zil_replay_apply(zilog, zr, zrr->zrr_lr);
+	if (error != 0 && zr->zr_error == 0)
+		zr->zr_error = error;
+
+	vmem_free(zrr->zrr_lr, zrr->zrr_lr->lrc_reclen);
+	kmem_free(zrr, sizeof (*zrr));
+
+	return (error);
+}
+
+static int
+zil_replay_log_record(zilog_t *zilog, const lr_t *lr, void *zra,
+    uint64_t claim_txg)
+{
+	zil_replay_arg_t *zr = zra;
+	const zil_header_t *zh = zilog->zl_header;
+
+	if (lr->lrc_seq <= zh->zh_replay_seq)	/* already replayed */
+		return (0);
+
+	if (lr->lrc_txg < claim_txg)		/* already committed */
+		return (0);
+
+	if (zr->zr_prefetch_tq == NULL) {
+		int error = zil_replay_apply(zilog, zr, lr);
+		if (error != 0)
+			zr->zr_error = error;
+		return (error);
+	}
+
+	/*
+	 * The record lives in a log block which zil_parse() releases once
+	 * we've seen all of its records, so queue a private copy.
+	 */
+	zil_replay_rec_t *zrr = kmem_alloc(sizeof (*zrr), KM_SLEEP);
+	zrr->zrr_lr = vmem_alloc(lr->lrc_reclen, KM_SLEEP);
+	memcpy(zrr->zrr_lr, lr, lr->lrc_reclen);
+	list_insert_tail(&zr->zr_queue, zrr);
+	zr->zr_queued++;
+
+	zil_replay_prefetch_record(zilog, zr, lr);
+
+	while (zr->zr_queued > zil_replay_prefetch) {
+		int error = zil_replay_dequeue(zilog, zr);
+		if (error != 0)
+			return (error);
+	}
+
 	return (0);
 }
 
@@ -4774,6 +5233,26 @@ zil_incr_blks(zilog_t *zilog, const blkptr_t *bp, void *arg, uint64_t claim_txg)
 	return (0);
 }
 
+/*
+ * Post a zevent describing a completed replay, so that administrators can
+ * see how long a dataset's mount was held up by its intent log.
+ */
+static void
+zil_replay_notify(zilog_t *zilog, zil_replay_arg_t *zr, hrtime_t delta)
+{
+	char name[ZFS_MAX_DATASET_NAME_LEN];
+	nvlist_t *aux = fnvlist_alloc();
+
+	dmu_objset_name(zilog->zl_os, name);
+	fnvlist_add_string(aux, ZFS_EV_ZIL_DSNAME, name);
+	fnvlist_add_uint64(aux, ZFS_EV_ZIL_REPLAY_RECORDS, zr->zr_records);
+	fnvlist_add_uint64(aux, ZFS_EV_ZIL_REPLAY_BYTES, zr->zr_bytes);
+	fnvlist_add_uint64(aux, ZFS_EV_ZIL_REPLAY_TIME, delta);
+	fnvlist_add_int32(aux, ZFS_EV_ZIL_REPLAY_ERROR, zr->zr_error);
+	spa_event_notify(zilog->zl_spa, NULL, aux, ESC_ZFS_ZIL_REPLAY);
+	nvlist_free(aux);
+}
+
 /*
  * If this dataset has a non-empty intent log, replay it and destroy it.
  * Return B_TRUE if there were any entries to replay.
@@ -4784,16 +5263,26 @@ zil_replay(objset_t *os, void *arg,
 {
 	zilog_t *zilog = dmu_objset_zil(os);
 	const zil_header_t *zh = zilog->zl_header;
-	zil_replay_arg_t zr;
+	zil_replay_arg_t zr = { 0 };
+	zil_replay_rec_t *zrr;
 
 	if ((zh->zh_flags & ZIL_REPLAY_NEEDED) == 0) {
 		return (zil_destroy(zilog, B_TRUE));
 	}
 
+	hrtime_t start = gethrtime();
+
 	zr.zr_replay = replay_func;
 	zr.zr_arg = arg;
 	zr.zr_byteswap = BP_SHOULD_BYTESWAP(&zh->zh_log);
 	zr.zr_lr = vmem_alloc(2 * SPA_MAXBLOCKSIZE, KM_SLEEP);
+	list_create(&zr.zr_queue, sizeof (zil_replay_rec_t),
+	    offsetof(zil_replay_rec_t, zrr_node));
+	if (zil_replay_prefetch != 0 && zil_replay_prefetch_threads != 0) {
+		zr.zr_prefetch_tq = taskq_create("z_zil_replay",
+		    zil_replay_prefetch_threads, defclsyspri, 1, INT_MAX,
+		    TASKQ_DYNAMIC);
+	}
 
 	/*
 	 * Wait for in-progress removes to sync before starting replay.
@@ -4805,12 +5294,33 @@ zil_replay(objset_t *os, void *arg,
 	ASSERT0(zilog->zl_replay_blks);
 	(void) zil_parse(zilog, zil_incr_blks, zil_replay_log_record, &zr,
 	    zh->zh_claim_txg, B_TRUE);
+
+	/*
+	 * Apply whatever is still queued, unless replay already failed.  A
+	 * parse error only ends the log; records before it are still good.
+	 */
+	while ((zrr = list_head(&zr.zr_queue)) != NULL) {
+		if (zr.zr_error == 0) {
+			(void) zil_replay_dequeue(zilog, &zr);
+		} else {
+			list_remove(&zr.zr_queue, zrr);
+			vmem_free(zrr->zrr_lr, zrr->zrr_lr->lrc_reclen);
+			kmem_free(zrr, sizeof (*zrr));
+		}
+	}
+	list_destroy(&zr.zr_queue);
+	if (zr.zr_prefetch_tq != NULL)
+		taskq_destroy(zr.zr_prefetch_tq);
 	vmem_free(zr.zr_lr, 2 * SPA_MAXBLOCKSIZE);
 
 	zil_destroy(zilog, B_FALSE);
 	txg_wait_synced(zilog->zl_dmu_pool, zilog->zl_destroy_txg);
 	zilog->zl_replay = B_FALSE;
 
+	hrtime_t delta = gethrtime() - start;
+	ZIL_STAT_INCR(zilog, zil_replay_time, delta);
+	zil_replay_notify(zilog, &zr, delta);
+
 	return (B_TRUE);
 }
 
@@ -4868,14 +5378,27 @@ EXPORT_SYMBOL(zil_set_sync);
 EXPORT_SYMBOL(zil_set_logbias);
 EXPORT_SYMBOL(zil_sums_init);
 EXPORT_SYMBOL(zil_sums_fini);
+EXPORT_SYMBOL(zil_kstat_values_init);
 EXPORT_SYMBOL(zil_kstat_values_update);
 
 ZFS_MODULE_PARAM(zfs, zfs_, commit_timeout_pct, UINT, ZMOD_RW,
 	"ZIL block open timeout percentage");
 
+ZFS_MODULE_PARAM(zfs_zil, zil_, commit_latency_us, UINT, ZMOD_RW,
+	"Target ZIL commit latency in microseconds for batching commits");
+
+ZFS_MODULE_PARAM(zfs_zil, zil_, dataset_histo, INT, ZMOD_RW,
+	"Keep a commit latency histogram per dataset");
+
 ZFS_MODULE_PARAM(zfs_zil, zil_, replay_disable, INT, ZMOD_RW,
 	"Disable intent logging replay");
 
+ZFS_MODULE_PARAM(zfs_zil, zil_, replay_prefetch, UINT, ZMOD_RW,
+	"Log records to read ahead and prefetch during replay");
+
+ZFS_MODULE_PARAM(zfs_zil, zil_, replay_prefetch_threads, UINT, ZMOD_RW,
+	"Max threads issuing prefetches during replay");
+
 ZFS_MODULE_PARAM(zfs_zil, zil_, nocacheflush, INT, ZMOD_RW,
 	"Disable ZIL cache flushes");
 
@@ -292,6 +292,7 @@ zio_init(void)
 	zio_inject_init();
 
 	lz4_init();
+	zio_compress_init();
 }
 
 void
@@ -358,6 +359,7 @@ zio_fini(void)
 
 	zio_inject_fini();
 
+	zio_compress_fini();
 	lz4_fini();
 }
 
@@ -706,6 +708,18 @@ error:
  * I/O parent/child relationships and pipeline interlocks
  * ==========================================================================
  */
+
+/*
+ * The io_children[][] counts are updated with atomics so that a completing
+ * child does not need to take its parent's io_lock, which would otherwise
+ * serialize every completion under a wide parent such as the spa_sync()
+ * root zio.  When a zio has to wait for a count to drain it sets this bit in
+ * that count instead of recording it under the lock; the child whose
+ * decrement leaves only the bit behind knows the parent is stalled on it,
+ * and so still alive, and is the one that resumes it.
+ */
+#define	ZIO_CHILDREN_STALLED	(1ULL << 63)
+
 zio_t *
 zio_walk_parents(zio_t *cio, zio_link_t **zl)
 {
@@ -760,7 +774,12 @@ zio_add_child_impl(zio_t *pio, zio_t *cio, boolean_t first)
 	    (cio->io_child_type != ZIO_CHILD_VDEV),
 	    (pio->io_pipeline & ZIO_STAGE_READY) == 0);
 
-	zio_link_t *zl = kmem_cache_alloc(zio_link_cache, KM_SLEEP);
+	/*
+	 * Most zios only ever have the parent they were created for, so
+	 * that link is embedded in the child rather than allocated.
+	 */
+	zio_link_t *zl = first ? &cio->io_parent_link :
+	    kmem_cache_alloc(zio_link_cache, KM_SLEEP);
 	zl->zl_parent = pio;
 	zl->zl_child = cio;
 
@@ -774,8 +793,10 @@ zio_add_child_impl(zio_t *pio, zio_t *cio, boolean_t first)
 	ASSERT0(pio->io_state[ZIO_WAIT_DONE]);
 
 	uint64_t *countp = pio->io_children[cio->io_child_type];
-	for (int w = 0; w < ZIO_WAIT_TYPES; w++)
-		countp[w] += !cio->io_state[w];
+	for (int w = 0; w < ZIO_WAIT_TYPES; w++) {
+		if (!cio->io_state[w])
+			atomic_inc_64(&countp[w]);
+	}
 
 	list_insert_head(&pio->io_child_list, zl);
 	list_insert_head(&cio->io_parent_list, zl);
@@ -812,31 +833,41 @@ zio_remove_child(zio_t *pio, zio_t *cio, zio_link_t *zl)
 
 	mutex_exit(&cio->io_lock);
 	mutex_exit(&pio->io_lock);
-	kmem_cache_free(zio_link_cache, zl);
+	if (zl != &cio->io_parent_link)
+		kmem_cache_free(zio_link_cache, zl);
 }
 
 static boolean_t
 zio_wait_for_children(zio_t *zio, uint8_t childbits, enum zio_wait_type wait)
 {
-	boolean_t waiting = B_FALSE;
-
-	mutex_enter(&zio->io_lock);
-	ASSERT0P(zio->io_stall);
 	for (int c = 0; c < ZIO_CHILD_TYPES; c++) {
 		if (!(ZIO_CHILD_BIT_IS_SET(childbits, c)))
 			continue;
 
 		uint64_t *countp = &zio->io_children[c][wait];
-		if (*countp != 0) {
-			zio->io_stage >>= 1;
-			ASSERT3U(zio->io_stage, !=, ZIO_STAGE_OPEN);
-			zio->io_stall = countp;
-			waiting = B_TRUE;
-			break;
-		}
+		uint64_t count = atomic_load_64(countp);
+		if (count == 0)
+			continue;
+
+		/*
+		 * Back up the stage before publishing the stall, as the
+		 * last child may resume us as soon as the bit is visible.
+		 */
+		zio->io_stage >>= 1;
+		ASSERT3U(zio->io_stage, !=, ZIO_STAGE_OPEN);
+		membar_producer();
+		do {
+			ASSERT0(count & ZIO_CHILDREN_STALLED);
+			uint64_t old = atomic_cas_64(countp, count,
+			    count | ZIO_CHILDREN_STALLED);
+			if (old == count)
+				return (B_TRUE);
+			count = old;
+		} while (count != 0);
+		zio->io_stage <<= 1;
 	}
-	mutex_exit(&zio->io_lock);
-	return (waiting);
+	membar_consumer();
+	return (B_FALSE);
 }
 
 __attribute__((always_inline))
@@ -846,21 +877,31 @@ zio_notify_parent(zio_t *pio, zio_t *zio, enum zio_wait_type wait,
 {
 	uint64_t *countp = &pio->io_children[zio->io_child_type][wait];
 	int *errorp = &pio->io_child_error[zio->io_child_type];
+	boolean_t propagate = (zio->io_error &&
+	    !(zio->io_flags & ZIO_FLAG_DONT_PROPAGATE));
 
-	mutex_enter(&pio->io_lock);
-	if (zio->io_error && !(zio->io_flags & ZIO_FLAG_DONT_PROPAGATE))
-		*errorp = zio_worst_error(*errorp, zio->io_error);
-	pio->io_post |= zio->io_post;
-	ASSERT3U(*countp, >, 0);
-
-	(*countp)--;
+	/*
+	 * Errors and post-processing requests are rare; only then is the
+	 * parent's lock needed.  Our count keeps the parent alive until
+	 * the decrement below, after which it may only be touched if we
+	 * found it stalled on that count.
+	 */
+	if (propagate || zio->io_post != 0) {
+		mutex_enter(&pio->io_lock);
+		if (propagate)
+			*errorp = zio_worst_error(*errorp, zio->io_error);
+		pio->io_post |= zio->io_post;
+		mutex_exit(&pio->io_lock);
+	}
+	ASSERT3U(atomic_load_64(countp) & ~ZIO_CHILDREN_STALLED, >, 0);
 
-	if (*countp == 0 && pio->io_stall == countp) {
+	membar_producer();
+	if (atomic_dec_64_nv(countp) == ZIO_CHILDREN_STALLED) {
+		membar_consumer();
 		zio_taskq_type_t type =
 		    pio->io_stage < ZIO_STAGE_VDEV_IO_START ? ZIO_TASKQ_ISSUE :
 		    ZIO_TASKQ_INTERRUPT;
-		pio->io_stall = NULL;
-		mutex_exit(&pio->io_lock);
+		atomic_sub_64(countp, ZIO_CHILDREN_STALLED);
 
 		/*
 		 * If we can tell the caller to execute this parent next, do
@@ -893,8 +934,6 @@ zio_notify_parent(zio_t *pio, zio_t *zio, enum zio_wait_type wait,
 		} else {
 			zio_taskq_dispatch(pio, type, B_FALSE);
 		}
-	} else {
-		mutex_exit(&pio->io_lock);
 	}
 }
 
@@ -1907,6 +1946,30 @@ zio_write_bp_init(zio_t *zio)
 	return (zio);
 }
 
+/*
+ * Compress a compression=adaptive block with whatever algorithm and level
+ * zio_compress_adaptive() picks for it.  The choice is recorded in io_prop
+ * so that the ARC header describes the block as it was actually written.
+ */
+static size_t
+zio_compress_data_adaptive(zio_t *zio, enum zio_compress *compress,
+    abd_t **cabd, uint64_t lsize)
+{
+	spa_t *spa = zio->io_spa;
+	zio_prop_t *zp = &zio->io_prop;
+	uint64_t objset = zio->io_bookmark.zb_objset;
+	size_t psize;
+
+	*compress = zio_compress_adaptive(spa, objset, &zp->zp_complevel);
+	zp->zp_compress = *compress;
+	psize = zio_compress_data(*compress, zio->io_abd, cabd, lsize,
+	    zio_get_compression_max_size(*compress, spa->spa_gcd_alloc,
+	    spa->spa_min_alloc, lsize), zp->zp_complevel);
+	zio_compress_adaptive_done(spa, objset, lsize, psize);
+
+	return (psize);
+}
+
 static zio_t *
 zio_write_compress(zio_t *zio)
 {
@@ -1976,6 +2039,10 @@ zio_write_compress(zio_t *zio)
 			psize = 0;
 		else if (compress == ZIO_COMPRESS_EMPTY)
 			psize = lsize;
+		else if (compress == ZIO_COMPRESS_ZSTD &&
+		    zp->zp_complevel == ZIO_ZSTD_LEVEL_AUTO)
+			psize = zio_compress_data_adaptive(zio, &compress,
+			    &cabd, lsize);
 		else
 			psize = zio_compress_data(compress, zio->io_abd, &cabd,
 			    lsize,
@@ -2436,7 +2503,6 @@ __zio_execute(zio_t *zio)
 
 		ASSERT(!MUTEX_HELD(&zio->io_lock));
 		ASSERT(ISP2(stage));
-		ASSERT0P(zio->io_stall);
 
 		do {
 			stage <<= 1;
@@ -2614,17 +2680,17 @@ zio_reexecute(void *arg)
 	 * active, usually because they've already been reexecuted after
 	 * resuming. Those children may be executing and may call
 	 * zio_notify_parent() at the same time as we're updating our parent's
-	 * counts. To avoid races while updating the counts, we take
-	 * gio->io_lock before each update.
+	 * counts. The counts are only ever updated atomically for this
+	 * reason.
 	 */
 	zio_link_t *zl = NULL;
 	while ((gio = zio_walk_parents(pio, &zl)) != NULL) {
-		mutex_enter(&gio->io_lock);
 		for (int w = 0; w < ZIO_WAIT_TYPES; w++) {
-			gio->io_children[pio->io_child_type][w] +=
-			    !pio->io_state[w];
+			if (!pio->io_state[w]) {
+				atomic_inc_64(
+				    &gio->io_children[pio->io_child_type][w]);
+			}
 		}
-		mutex_exit(&gio->io_lock);
 	}
 
 	for (int c = 0; c < ZIO_CHILD_TYPES; c++)
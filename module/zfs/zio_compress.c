@@ -32,6 +32,9 @@
 
 #include <sys/zfs_context.h>
 #include <sys/spa.h>
+#include <sys/spa_impl.h>
+#include <sys/dsl_pool.h>
+#include <sys/wmsum.h>
 #include <sys/zfeature.h>
 #include <sys/zio.h>
 #include <sys/zio_compress.h>
@@ -73,6 +76,262 @@ zio_compress_info_t zio_compress_table[ZIO_COMPRESS_FUNCTIONS] = {
 	    zfs_zstd_compress,	zfs_zstd_decompress, zfs_zstd_decompress_level},
 };
 
+/*
+ * compression=adaptive chooses an algorithm and level for every block as
+ * it is written, giving up compression ratio for throughput as the pool
+ * comes under pressure.  The choices, from cheapest to most thorough, are
+ *
+ *	lz4, zstd-1, zstd-3, zstd-N (zfs_compress_adaptive_level)
+ *
+ * and the rung is picked from the worse of two pressure signals, each
+ * expressed as a percentage:
+ *
+ *  - CPU: the number of other blocks being compressed right now relative
+ *    to the number of write issue threads.  Once every thread is busy
+ *    compressing, further writes queue up behind them in the taskq.
+ *
+ *  - Dirty data: the pool's outstanding dirty data relative to the point
+ *    at which the write throttle starts delaying writers.
+ *
+ * Independently of pressure, a dataset whose recent blocks barely
+ * compressed is written with lz4, whose early abort makes incompressible
+ * data cheap.  Every ZCA_PROBE_INTERVAL'th such block is still sent down
+ * the ladder so the estimate can recover when the data changes.  Ratios
+ * are kept as a decaying average in a small per-pool table hashed by
+ * objset; collisions between datasets only blur the estimate.  Each entry
+ * packs the ratio and a block count into one word, which is updated with
+ * compare-and-swap.
+ *
+ * All of these blocks are ordinary lz4 or zstd blocks on disk, so any
+ * reader which understands zstd can read them.
+ */
+static uint_t zfs_compress_adaptive_level = ZIO_ZSTD_LEVEL_6;
+
+#define	ZCA_PROBE_INTERVAL	16
+#define	ZCA_RATIO_ONE		1024	/* psize == lsize */
+#define	ZCA_RATIO_POOR		(ZCA_RATIO_ONE * 9 / 10)
+#define	ZCA_RATIO_SHIFT		3	/* new sample weighs 1/8 */
+
+/* Pressure (in percent) at or above which each cheaper rung is used. */
+#define	ZCA_PRESSURE_LZ4	80
+#define	ZCA_PRESSURE_ZSTD_1	60
+#define	ZCA_PRESSURE_ZSTD_3	40
+
+/* Ratio (psize / lsize, in 1/1024ths) in the upper half, blocks below */
+#define	ZCA_RATIO(v)		((uint32_t)((v) >> 32))
+#define	ZCA_BLOCKS(v)		((uint32_t)(v))
+#define	ZCA_PACK(r, b)		(((uint64_t)(r) << 32) | (uint32_t)(b))
+
+typedef struct zca_stats {
+	kstat_named_t zcastat_lz4;
+	kstat_named_t zcastat_zstd_1;
+	kstat_named_t zcastat_zstd_3;
+	kstat_named_t zcastat_zstd_high;
+	kstat_named_t zcastat_cpu_limited;
+	kstat_named_t zcastat_dirty_limited;
+	kstat_named_t zcastat_ratio_limited;
+	kstat_named_t zcastat_probes;
+} zca_stats_t;
+
+static zca_stats_t zca_stats = {
+	{ "lz4",			KSTAT_DATA_UINT64 },
+	{ "zstd_1",			KSTAT_DATA_UINT64 },
+	{ "zstd_3",			KSTAT_DATA_UINT64 },
+	{ "zstd_high",			KSTAT_DATA_UINT64 },
+	{ "cpu_limited",		KSTAT_DATA_UINT64 },
+	{ "dirty_limited",		KSTAT_DATA_UINT64 },
+	{ "ratio_limited",		KSTAT_DATA_UINT64 },
+	{ "probes",			KSTAT_DATA_UINT64 },
+};
+
+static struct {
+	wmsum_t zcastat_lz4;
+	wmsum_t zcastat_zstd_1;
+	wmsum_t zcastat_zstd_3;
+	wmsum_t zcastat_zstd_high;
+	wmsum_t zcastat_cpu_limited;
+	wmsum_t zcastat_dirty_limited;
+	wmsum_t zcastat_ratio_limited;
+	wmsum_t zcastat_probes;
+} zca_sums;
+
+#define	ZCASTAT_BUMP(stat)	wmsum_add(&zca_sums.stat, 1)
+
+static kstat_t *zca_ksp;
+
+static int
+zca_kstats_update(kstat_t *ksp, int rw)
+{
+	zca_stats_t *zs = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (EACCES);
+	zs->zcastat_lz4.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_lz4);
+	zs->zcastat_zstd_1.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_zstd_1);
+	zs->zcastat_zstd_3.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_zstd_3);
+	zs->zcastat_zstd_high.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_zstd_high);
+	zs->zcastat_cpu_limited.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_cpu_limited);
+	zs->zcastat_dirty_limited.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_dirty_limited);
+	zs->zcastat_ratio_limited.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_ratio_limited);
+	zs->zcastat_probes.value.ui64 =
+	    wmsum_value(&zca_sums.zcastat_probes);
+	return (0);
+}
+
+void
+zio_compress_init(void)
+{
+	wmsum_init(&zca_sums.zcastat_lz4, 0);
+	wmsum_init(&zca_sums.zcastat_zstd_1, 0);
+	wmsum_init(&zca_sums.zcastat_zstd_3, 0);
+	wmsum_init(&zca_sums.zcastat_zstd_high, 0);
+	wmsum_init(&zca_sums.zcastat_cpu_limited, 0);
+	wmsum_init(&zca_sums.zcastat_dirty_limited, 0);
+	wmsum_init(&zca_sums.zcastat_ratio_limited, 0);
+	wmsum_init(&zca_sums.zcastat_probes, 0);
+
+	zca_ksp = kstat_create("zfs", 0, "compress_adaptive", "misc",
+	    KSTAT_TYPE_NAMED, sizeof (zca_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+
+	if (zca_ksp != NULL) {
+		zca_ksp->ks_data = &zca_stats;
+		zca_ksp->ks_update = zca_kstats_update;
+		kstat_install(zca_ksp);
+	}
+}
+
+void
+zio_compress_fini(void)
+{
+	if (zca_ksp != NULL) {
+		kstat_delete(zca_ksp);
+		zca_ksp = NULL;
+	}
+
+	wmsum_fini(&zca_sums.zcastat_lz4);
+	wmsum_fini(&zca_sums.zcastat_zstd_1);
+	wmsum_fini(&zca_sums.zcastat_zstd_3);
+	wmsum_fini(&zca_sums.zcastat_zstd_high);
+	wmsum_fini(&zca_sums.zcastat_cpu_limited);
+	wmsum_fini(&zca_sums.zcastat_dirty_limited);
+	wmsum_fini(&zca_sums.zcastat_ratio_limited);
+	wmsum_fini(&zca_sums.zcastat_probes);
+}
+
+static uint64_t *
+zca_bucket(spa_t *spa, uint64_t objset)
+{
+	return (&spa->spa_compress_ratio[((objset * 0x9E3779B97F4A7C15ULL) >>
+	    32) % SPA_COMPRESS_RATIO_BUCKETS]);
+}
+
+/*
+ * Choose the algorithm and level for the next compression=adaptive block
+ * of the given dataset.  Every call must be paired with a call to
+ * zio_compress_adaptive_done() once the block has been compressed.
+ */
+enum zio_compress
+zio_compress_adaptive(spa_t *spa, uint64_t objset, uint8_t *level)
+{
+	uint64_t zcab = atomic_load_64(zca_bucket(spa, objset));
+	uint32_t ratio = ZCA_RATIO(zcab), blocks = ZCA_BLOCKS(zcab);
+	dsl_pool_t *dp = spa_get_dsl(spa);
+	uint64_t threads, busy, limit;
+	uint_t cpu, dirty, pressure;
+	enum zio_compress c = ZIO_COMPRESS_ZSTD;
+
+	threads = spa_taskq_batch_threads();
+	busy = atomic_inc_64_nv(&spa->spa_compress_inflight) - 1;
+	cpu = MIN(busy * 100 / threads, 100);
+
+	limit = zfs_dirty_data_max * zfs_delay_min_dirty_percent / 100;
+	if (dp == NULL || limit == 0)
+		dirty = 0;
+	else
+		dirty = MIN(dp->dp_dirty_total * 100 / limit, 100);
+
+	pressure = MAX(cpu, dirty);
+
+	if (ratio >= ZCA_RATIO_POOR && blocks % ZCA_PROBE_INTERVAL != 0) {
+		ZCASTAT_BUMP(zcastat_ratio_limited);
+		c = ZIO_COMPRESS_LZ4;
+	} else {
+		if (ratio >= ZCA_RATIO_POOR)
+			ZCASTAT_BUMP(zcastat_probes);
+		if (pressure >= ZCA_PRESSURE_ZSTD_3) {
+			if (cpu >= dirty)
+				ZCASTAT_BUMP(zcastat_cpu_limited);
+			else
+				ZCASTAT_BUMP(zcastat_dirty_limited);
+		}
+
+		if (pressure >= ZCA_PRESSURE_LZ4)
+			c = ZIO_COMPRESS_LZ4;
+		else if (pressure >= ZCA_PRESSURE_ZSTD_1)
+			*level = ZIO_ZSTD_LEVEL_1;
+		else if (pressure >= ZCA_PRESSURE_ZSTD_3)
+			*level = ZIO_ZSTD_LEVEL_3;
+		else
+			*level = MIN(MAX(zfs_compress_adaptive_level,
+			    ZIO_ZSTD_LEVEL_MIN), ZIO_ZSTD_LEVEL_MAX);
+	}
+
+	/* lz4 is active on any pool new enough for zstd, but be sure. */
+	if (c == ZIO_COMPRESS_LZ4 &&
+	    !spa_feature_is_active(spa, SPA_FEATURE_LZ4_COMPRESS)) {
+		c = ZIO_COMPRESS_ZSTD;
+		*level = ZIO_ZSTD_LEVEL_1;
+	}
+
+	if (c == ZIO_COMPRESS_LZ4) {
+		*level = ZIO_COMPLEVEL_INHERIT;
+		ZCASTAT_BUMP(zcastat_lz4);
+	} else if (*level == ZIO_ZSTD_LEVEL_1) {
+		ZCASTAT_BUMP(zcastat_zstd_1);
+	} else if (*level == ZIO_ZSTD_LEVEL_3) {
+		ZCASTAT_BUMP(zcastat_zstd_3);
+	} else {
+		ZCASTAT_BUMP(zcastat_zstd_high);
+	}
+
+	return (c);
+}
+
+/*
+ * Account for a block compressed as chosen by zio_compress_adaptive().
+ * A psize of 0 means the block was not compressed at all (e.g. it was
+ * all zeroes) and says nothing about the data's compressibility.
+ */
+void
+zio_compress_adaptive_done(spa_t *spa, uint64_t objset, uint64_t lsize,
+    uint64_t psize)
+{
+	uint64_t *zcab = zca_bucket(spa, objset);
+	uint64_t old, new;
+
+	atomic_dec_64(&spa->spa_compress_inflight);
+
+	if (psize == 0 || lsize == 0)
+		return;
+
+	uint32_t ratio = (uint32_t)(MIN(psize, lsize) * ZCA_RATIO_ONE / lsize);
+
+	do {
+		old = atomic_load_64(zcab);
+		new = ZCA_PACK(ZCA_RATIO(old) - (ZCA_RATIO(old) >>
+		    ZCA_RATIO_SHIFT) + (ratio >> ZCA_RATIO_SHIFT),
+		    ZCA_BLOCKS(old) + 1);
+	} while (atomic_cas_64(zcab, old, new) != old);
+}
+
 uint8_t
 zio_complevel_select(spa_t *spa, enum zio_compress compress, uint8_t child,
     uint8_t parent)
@@ -90,6 +349,24 @@ zio_complevel_select(spa_t *spa, enum zio_compress compress, uint8_t child,
 	return (result);
 }
 
+/*
+ * Ask for a zstd block to be laid out as frames (zstd_frames=on).  Only
+ * the positive levels support this; anything else is returned unchanged.
+ */
+uint8_t
+zio_complevel_frames(enum zio_compress compress, uint8_t level)
+{
+	if (compress != ZIO_COMPRESS_ZSTD)
+		return (level);
+
+	if (level == ZIO_COMPLEVEL_DEFAULT)
+		level = ZIO_ZSTD_LEVEL_DEFAULT;
+	if (level < ZIO_ZSTD_LEVEL_MIN || level > ZIO_ZSTD_LEVEL_MAX)
+		return (level);
+
+	return (level | ZIO_ZSTD_LEVEL_FRAMES);
+}
+
 enum zio_compress
 zio_compress_select(spa_t *spa, enum zio_compress child,
     enum zio_compress parent)
@@ -132,7 +409,12 @@ zio_compress_data(enum zio_compress c, abd_t *src, abd_t **dst, size_t s_len,
 		if (level == ZIO_COMPLEVEL_INHERIT)
 			return (s_len);
 
-		if (level == ZIO_COMPLEVEL_DEFAULT)
+		/*
+		 * An unresolved compression=adaptive block is written at
+		 * the default level; see zio_compress_adaptive().
+		 */
+		if (level == ZIO_COMPLEVEL_DEFAULT ||
+		    level == ZIO_ZSTD_LEVEL_AUTO)
 			complevel = ZIO_ZSTD_LEVEL_DEFAULT;
 		else
 			complevel = level;
@@ -179,3 +461,6 @@ zio_compress_to_feature(enum zio_compress comp)
 	}
 	return (SPA_FEATURE_NONE);
 }
+
+ZFS_MODULE_PARAM(zfs, zfs_, compress_adaptive_level, UINT, ZMOD_RW,
+	"zstd level used by compression=adaptive when the pool is idle");
@@ -54,6 +54,7 @@
 static uint_t zstd_earlyabort_pass = 1;
 static int zstd_cutoff_level = ZIO_ZSTD_LEVEL_3;
 static unsigned int zstd_abort_size = (128 * 1024);
+static uint_t zstd_parallel = 1;
 
 static kstat_t *zstd_ksp = NULL;
 
@@ -67,6 +68,8 @@ typedef struct zstd_stats {
 	kstat_named_t	zstd_stat_dec_header_inval;
 	kstat_named_t	zstd_stat_com_fail;
 	kstat_named_t	zstd_stat_dec_fail;
+	kstat_named_t	zstd_stat_com_frames;
+	kstat_named_t	zstd_stat_dec_frames;
 	/*
 	 * LZ4 first-pass early abort verdict
 	 */
@@ -96,6 +99,8 @@ static zstd_stats_t zstd_stats = {
 	{ "decompress_header_invalid",	KSTAT_DATA_UINT64 },
 	{ "compress_failed",		KSTAT_DATA_UINT64 },
 	{ "decompress_failed",		KSTAT_DATA_UINT64 },
+	{ "compress_frames",		KSTAT_DATA_UINT64 },
+	{ "decompress_frames",		KSTAT_DATA_UINT64 },
 	{ "lz4pass_allowed",		KSTAT_DATA_UINT64 },
 	{ "lz4pass_rejected",		KSTAT_DATA_UINT64 },
 	{ "zstdpass_allowed",		KSTAT_DATA_UINT64 },
@@ -122,6 +127,8 @@ kstat_zstd_update(kstat_t *ksp, int rw)
 		ZSTDSTAT_ZERO(zstd_stat_dec_header_inval);
 		ZSTDSTAT_ZERO(zstd_stat_com_fail);
 		ZSTDSTAT_ZERO(zstd_stat_dec_fail);
+		ZSTDSTAT_ZERO(zstd_stat_com_frames);
+		ZSTDSTAT_ZERO(zstd_stat_dec_frames);
 		ZSTDSTAT_ZERO(zstd_stat_lz4pass_allowed);
 		ZSTDSTAT_ZERO(zstd_stat_lz4pass_rejected);
 		ZSTDSTAT_ZERO(zstd_stat_zstdpass_allowed);
@@ -430,39 +437,142 @@ zstd_enum_to_level(enum zio_zstd_levels level, int16_t *zstd_level)
 	return (1);
 }
 
-/* Compress block using zstd */
-static size_t
-zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
-    int level)
+/*
+ * Large blocks as frames
+ *
+ * With zstd_frames=on, a block of at least two ZSTD_PARALLEL_FRAME sized
+ * chunks is compressed as one frame per chunk.  The frames are stored back
+ * to back, which any zstd decoder reads as a single stream, so such blocks
+ * remain readable by older releases.  Each frame records its content size,
+ * which lets us find the frame boundaries when reading the block.  When
+ * zstd_parallel is set, the frames are compressed and decompressed in
+ * parallel on the zstd taskq.
+ *
+ * The frame size is fixed, so the output only depends on the data, the
+ * level and the property, never on a tunable or on the number of threads
+ * that happened to work on a block.  The layout is reported back with the
+ * level of the block (ZIO_ZSTD_LEVEL_FRAMES) when it is read, so that the
+ * ARC recompresses blocks for the L2ARC and to authenticate encrypted
+ * blocks into the layout they were written with.  Every other block,
+ * including all blocks written before the property existed, is a single
+ * frame as before.
+ */
+#define	ZSTD_PARALLEL_FRAME		(4 * 1024 * 1024)
+#define	ZSTD_PARALLEL_MAX_PARTS		\
+	(SPA_MAXBLOCKSIZE / ZSTD_PARALLEL_FRAME)
+
+static taskq_t *zstd_taskq;
+
+typedef struct zstd_part {
+	const uint8_t	*zp_src;	/* the input */
+	size_t		zp_slen;
+	uint8_t		*zp_dst;	/* room for the output */
+	size_t		zp_dlen;
+	size_t		zp_result;	/* output length or zstd error */
+} zstd_part_t;
+
+typedef struct zstd_job zstd_job_t;
+typedef size_t zstd_part_func_t(const zstd_job_t *, const zstd_part_t *);
+
+struct zstd_job {
+	zstd_part_func_t *zj_func;
+	int16_t		zj_level;
+	uint_t		zj_nparts;
+	uint32_t	zj_next;	/* next part to claim */
+	boolean_t	zj_failed;
+	uint_t		zj_workers;	/* dispatched tasks still running */
+	kmutex_t	zj_lock;
+	kcondvar_t	zj_cv;
+	zstd_part_t	zj_parts[ZSTD_PARALLEL_MAX_PARTS];
+};
+
+/* Process parts until there are none left, or one of them failed */
+static void
+zstd_job_work(zstd_job_t *zj)
 {
-	size_t c_len;
-	int16_t zstd_level;
-	zfs_zstdhdr_t *hdr;
-	ZSTD_CCtx *cctx;
+	uint_t i;
 
-	hdr = (zfs_zstdhdr_t *)d_start;
+	while (!zj->zj_failed &&
+	    (i = atomic_inc_32_nv(&zj->zj_next) - 1) < zj->zj_nparts) {
+		zstd_part_t *zp = &zj->zj_parts[i];
 
-	/* Skip compression if the specified level is invalid */
-	if (zstd_enum_to_level(level, &zstd_level)) {
-		ZSTDSTAT_BUMP(zstd_stat_com_inval);
-		return (s_len);
+		zp->zp_result = zj->zj_func(zj, zp);
+		if (ZSTD_isError(zp->zp_result))
+			zj->zj_failed = B_TRUE;
 	}
+}
 
-	ASSERT3U(d_len, >=, sizeof (*hdr));
-	ASSERT3U(d_len, <=, s_len);
-	ASSERT3U(zstd_level, !=, 0);
+static void
+zstd_job_task(void *arg)
+{
+	zstd_job_t *zj = arg;
 
-	cctx = ZSTD_createCCtx_advanced(zstd_malloc);
+	zstd_job_work(zj);
 
-	/*
-	 * Out of kernel memory, gently fall through - this will disable
-	 * compression in zio_compress_data
-	 */
-	if (!cctx) {
-		ZSTDSTAT_BUMP(zstd_stat_com_alloc_fail);
-		return (s_len);
+	mutex_enter(&zj->zj_lock);
+	if (--zj->zj_workers == 0)
+		cv_broadcast(&zj->zj_cv);
+	mutex_exit(&zj->zj_lock);
+}
+
+/*
+ * Run all parts of a job in parallel.  The calling thread works on the job
+ * too, so it completes even if no taskq thread is available.
+ */
+static boolean_t
+zstd_job_run(zstd_job_t *zj)
+{
+	uint_t helpers = MIN(zj->zj_nparts, boot_ncpus) - 1;
+
+	mutex_init(&zj->zj_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&zj->zj_cv, NULL, CV_DEFAULT, NULL);
+	zj->zj_next = 0;
+	zj->zj_failed = B_FALSE;
+	zj->zj_workers = 0;
+	for (uint_t i = 0; i < zj->zj_nparts; i++)
+		zj->zj_parts[i].zp_result = 0;
+
+	for (uint_t i = 0; i < helpers; i++) {
+		mutex_enter(&zj->zj_lock);
+		zj->zj_workers++;
+		mutex_exit(&zj->zj_lock);
+		if (taskq_dispatch(zstd_taskq, zstd_job_task, zj,
+		    TQ_NOSLEEP) == TASKQID_INVALID) {
+			mutex_enter(&zj->zj_lock);
+			zj->zj_workers--;
+			mutex_exit(&zj->zj_lock);
+			break;
+		}
 	}
 
+	zstd_job_work(zj);
+
+	mutex_enter(&zj->zj_lock);
+	while (zj->zj_workers > 0)
+		cv_wait(&zj->zj_cv, &zj->zj_lock);
+	mutex_exit(&zj->zj_lock);
+
+	cv_destroy(&zj->zj_cv);
+	mutex_destroy(&zj->zj_lock);
+
+	return (!zj->zj_failed);
+}
+
+/*
+ * Compress src into a single magicless frame.  Returns the length of the
+ * frame, or a zstd error code.
+ */
+static size_t
+zfs_zstd_compress_frame(void *dst, size_t d_len, const void *src,
+    size_t s_len, int16_t zstd_level, boolean_t content_size)
+{
+	ZSTD_CCtx *cctx;
+	size_t c_len;
+
+	cctx = ZSTD_createCCtx_advanced(zstd_malloc);
+	if (!cctx)
+		return ((size_t)-ZSTD_error_memory_allocation);
+
 	/* Set the compression level */
 	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, zstd_level);
 
@@ -471,18 +581,260 @@ zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
 
 	/*
 	 * Disable redundant checksum calculation and content size storage since
-	 * this is already done by ZFS itself.
+	 * this is already done by ZFS itself.  The frames of a block that is
+	 * laid out as frames do record their size, which is how we tell them
+	 * apart.
 	 */
 	ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 0);
-	ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, 0);
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, content_size);
 
-	c_len = ZSTD_compress2(cctx,
-	    hdr->data,
-	    d_len - sizeof (*hdr),
-	    s_start, s_len);
+	c_len = ZSTD_compress2(cctx, dst, d_len, src, s_len);
 
 	ZSTD_freeCCtx(cctx);
 
+	return (c_len);
+}
+
+static size_t
+zstd_compress_part(const zstd_job_t *zj, const zstd_part_t *zp)
+{
+	return (zfs_zstd_compress_frame(zp->zp_dst, zp->zp_dlen, zp->zp_src,
+	    zp->zp_slen, zj->zj_level, B_TRUE));
+}
+
+/*
+ * Compress s_len bytes as ZSTD_PARALLEL_FRAME sized frames.  Returns the
+ * total length, or a zstd error code.
+ *
+ * Without zstd_parallel each frame is compressed in place, right behind the
+ * previous one.  Otherwise the first frame still goes straight into
+ * d_start, but the others need room of their own until they are packed
+ * behind it.
+ */
+static size_t
+zfs_zstd_compress_frames(const void *s_start, void *d_start, size_t s_len,
+    size_t d_len, int16_t zstd_level)
+{
+	const uint8_t *src = s_start;
+	uint8_t *dst = d_start;
+	const size_t chunk = ZSTD_PARALLEL_FRAME;
+	uint_t nparts = DIV_ROUND_UP(s_len, chunk);
+	size_t c_len = 0;
+
+	ASSERT3U(nparts, <=, ZSTD_PARALLEL_MAX_PARTS);
+
+	if (!zstd_parallel || boot_ncpus < 2) {
+		for (uint_t i = 0; i < nparts; i++) {
+			size_t soff = i * chunk;
+			size_t len = zfs_zstd_compress_frame(dst + c_len,
+			    d_len - c_len, src + soff, MIN(chunk, s_len - soff),
+			    zstd_level, B_TRUE);
+
+			if (ZSTD_isError(len))
+				return (len);
+			c_len += len;
+		}
+		return (c_len);
+	}
+
+	zstd_job_t *zj = kmem_alloc(sizeof (*zj), KM_SLEEP);
+	size_t bound = ZSTD_compressBound(chunk);
+	size_t scratch_len = (nparts - 1) * bound;
+	uint8_t *scratch = vmem_alloc(scratch_len, KM_SLEEP);
+
+	zj->zj_func = zstd_compress_part;
+	zj->zj_nparts = nparts;
+	zj->zj_level = zstd_level;
+	for (uint_t i = 0; i < nparts; i++) {
+		zstd_part_t *zp = &zj->zj_parts[i];
+
+		zp->zp_src = src + i * chunk;
+		zp->zp_slen = MIN(chunk, s_len - i * chunk);
+		zp->zp_dst = (i == 0) ? dst : scratch + (i - 1) * bound;
+		zp->zp_dlen = (i == 0) ? d_len : bound;
+	}
+
+	if (zstd_job_run(zj)) {
+		for (uint_t i = 0; i < nparts; i++) {
+			zstd_part_t *zp = &zj->zj_parts[i];
+
+			if (zp->zp_result > d_len - c_len) {
+				c_len = (size_t)-ZSTD_error_dstSize_tooSmall;
+				break;
+			}
+			if (i > 0)
+				memcpy(dst + c_len, zp->zp_dst, zp->zp_result);
+			c_len += zp->zp_result;
+		}
+	} else {
+		for (uint_t i = 0; i < nparts; i++) {
+			if (ZSTD_isError(zj->zj_parts[i].zp_result)) {
+				c_len = zj->zj_parts[i].zp_result;
+				break;
+			}
+		}
+	}
+
+	vmem_free(scratch, scratch_len);
+	kmem_free(zj, sizeof (*zj));
+
+	return (c_len);
+}
+
+static size_t
+zstd_decompress_part(const zstd_job_t *zj, const zstd_part_t *zp)
+{
+	(void) zj;
+	ZSTD_DCtx *dctx;
+	size_t result;
+
+	dctx = ZSTD_createDCtx_advanced(zstd_dctx_malloc);
+	if (!dctx)
+		return ((size_t)-ZSTD_error_memory_allocation);
+
+	ZSTD_DCtx_setParameter(dctx, ZSTD_d_format, ZSTD_f_zstd1_magicless);
+	result = ZSTD_decompressDCtx(dctx, zp->zp_dst, zp->zp_dlen,
+	    zp->zp_src, zp->zp_slen);
+	ZSTD_freeDCtx(dctx);
+
+	if (!ZSTD_isError(result) && result != zp->zp_dlen)
+		result = (size_t)-ZSTD_error_corruption_detected;
+
+	return (result);
+}
+
+/*
+ * Find the frames of a block laid out as frames, by walking the block
+ * headers of each frame.  Returns the number of frames, or 0 if the block
+ * does not consist of frames that record their content size.
+ */
+static uint_t
+zstd_find_frames(const uint8_t *src, size_t s_len, uint8_t *dst,
+    size_t d_len, zstd_part_t *parts)
+{
+	size_t soff = 0, doff = 0;
+	uint_t n = 0;
+
+	while (soff < s_len) {
+		ZSTD_frameHeader zfh;
+		size_t off;
+
+		if (n == ZSTD_PARALLEL_MAX_PARTS ||
+		    ZSTD_getFrameHeader_advanced(&zfh, src + soff, s_len - soff,
+		    ZSTD_f_zstd1_magicless) != 0 ||
+		    zfh.frameType != ZSTD_frame || zfh.dictID != 0 ||
+		    zfh.frameContentSize > d_len - doff)
+			return (0);
+
+		/* Block headers are 3 bytes: last flag, type and size */
+		off = soff + zfh.headerSize;
+		for (;;) {
+			uint32_t bh;
+
+			if (s_len - off < 3)
+				return (0);
+			bh = src[off] | (src[off + 1] << 8) |
+			    (src[off + 2] << 16);
+			switch ((bh >> 1) & 3) {
+			case 0:	/* raw */
+			case 2:	/* compressed */
+				off += 3 + (bh >> 3);
+				break;
+			case 1:	/* rle */
+				off += 3 + 1;
+				break;
+			default:
+				return (0);
+			}
+			if (off > s_len)
+				return (0);
+			if (bh & 1)
+				break;
+		}
+		if (zfh.checksumFlag)
+			off += 4;
+		if (off > s_len)
+			return (0);
+
+		parts[n].zp_src = src + soff;
+		parts[n].zp_slen = off - soff;
+		parts[n].zp_dst = dst + doff;
+		parts[n].zp_dlen = zfh.frameContentSize;
+		doff += zfh.frameContentSize;
+		soff = off;
+		n++;
+	}
+
+	return (n);
+}
+
+/*
+ * Decompress a block laid out as frames in parallel.  *framed tells whether
+ * the block is laid out as frames at all.  Returns B_FALSE if it is not, if
+ * zstd_parallel is off, or if anything went wrong, in which case the caller
+ * should decompress the block as a single stream.
+ */
+static boolean_t
+zfs_zstd_decompress_frames(const void *s_start, void *d_start,
+    size_t s_len, size_t d_len, boolean_t *framed)
+{
+	ZSTD_frameHeader zfh;
+	zstd_job_t *zj;
+	boolean_t ok = B_FALSE;
+
+	*framed = B_FALSE;
+
+	/* Cheap test for the common, single frame case first */
+	if (ZSTD_getFrameHeader_advanced(&zfh, s_start, s_len,
+	    ZSTD_f_zstd1_magicless) != 0 || zfh.frameContentSize >= d_len)
+		return (B_FALSE);
+
+	zj = kmem_alloc(sizeof (*zj), KM_SLEEP);
+	zj->zj_func = zstd_decompress_part;
+	zj->zj_nparts = zstd_find_frames(s_start, s_len, d_start, d_len,
+	    zj->zj_parts);
+	if (zj->zj_nparts > 1) {
+		*framed = B_TRUE;
+		ZSTDSTAT_BUMP(zstd_stat_dec_frames);
+		if (zstd_parallel && boot_ncpus > 1)
+			ok = zstd_job_run(zj);
+	}
+	kmem_free(zj, sizeof (*zj));
+
+	return (ok);
+}
+
+/* Compress block using zstd, optionally laid out as frames */
+static size_t
+zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
+    int level, boolean_t frames)
+{
+	size_t c_len;
+	int16_t zstd_level;
+	zfs_zstdhdr_t *hdr;
+
+	hdr = (zfs_zstdhdr_t *)d_start;
+
+	/* Skip compression if the specified level is invalid */
+	if (zstd_enum_to_level(level, &zstd_level)) {
+		ZSTDSTAT_BUMP(zstd_stat_com_inval);
+		return (s_len);
+	}
+
+	ASSERT3U(d_len, >=, sizeof (*hdr));
+	ASSERT3U(d_len, <=, s_len);
+	ASSERT3U(zstd_level, !=, 0);
+
+	if (frames && s_len >= 2 * ZSTD_PARALLEL_FRAME) {
+		c_len = zfs_zstd_compress_frames(s_start, hdr->data, s_len,
+		    d_len - sizeof (*hdr), zstd_level);
+		if (!ZSTD_isError(c_len))
+			ZSTDSTAT_BUMP(zstd_stat_com_frames);
+	} else {
+		c_len = zfs_zstd_compress_frame(hdr->data,
+		    d_len - sizeof (*hdr), s_start, s_len, zstd_level, B_FALSE);
+	}
+
 	/* Error in the compression routine, disable compression. */
 	if (ZSTD_isError(c_len)) {
 		/*
@@ -491,7 +843,13 @@ zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
 		 * failure, so increment the compression failure counter.
 		 */
 		int err = ZSTD_getErrorCode(c_len);
-		if (err != ZSTD_error_dstSize_tooSmall) {
+		if (err == ZSTD_error_memory_allocation) {
+			/*
+			 * Out of kernel memory, gently fall through - this
+			 * will disable compression in zio_compress_data
+			 */
+			ZSTDSTAT_BUMP(zstd_stat_com_alloc_fail);
+		} else if (err != ZSTD_error_dstSize_tooSmall) {
 			ZSTDSTAT_BUMP(zstd_stat_com_fail);
 			dprintf("Error: %s", ZSTD_getErrorString(err));
 		}
@@ -541,7 +899,11 @@ static size_t
 zfs_zstd_compress_buf(void *s_start, void *d_start, size_t s_len, size_t d_len,
     int level)
 {
+	boolean_t frames = ZIO_ZSTD_LEVEL_HAS_FRAMES(level);
 	int16_t zstd_level;
+
+	if (frames)
+		level &= ~ZIO_ZSTD_LEVEL_FRAMES;
 	if (zstd_enum_to_level(level, &zstd_level)) {
 		ZSTDSTAT_BUMP(zstd_stat_com_inval);
 		return (s_len);
@@ -582,7 +944,7 @@ zfs_zstd_compress_buf(void *s_start, void *d_start, size_t s_len, size_t d_len,
 		ZSTDSTAT_BUMP(zstd_stat_lz4pass_rejected);
 
 		pass_len = zfs_zstd_compress_impl(s_start, d_start, s_len,
-		    d_len, ZIO_ZSTD_LEVEL_1);
+		    d_len, ZIO_ZSTD_LEVEL_1, B_FALSE);
 		if (pass_len == s_len || pass_len <= 0 || pass_len > d_len) {
 			ZSTDSTAT_BUMP(zstd_stat_zstdpass_rejected);
 			return (s_len);
@@ -595,7 +957,8 @@ zfs_zstd_compress_buf(void *s_start, void *d_start, size_t s_len, size_t d_len,
 		}
 	}
 keep_trying:
-	return (zfs_zstd_compress_impl(s_start, d_start, s_len, d_len, level));
+	return (zfs_zstd_compress_impl(s_start, d_start, s_len, d_len, level,
+	    frames));
 
 }
 
@@ -646,6 +1009,24 @@ zfs_zstd_decompress_level_buf(void *s_start, void *d_start, size_t s_len,
 		return (1);
 	}
 
+	/*
+	 * A block laid out as frames by zfs_zstd_compress_frames() reports
+	 * that with its level, and is decompressed in parallel if possible.
+	 * Anything unexpected is left to the single stream decompression
+	 * below, which has the final say.
+	 */
+	boolean_t framed;
+	boolean_t done = zfs_zstd_decompress_frames(hdr->data, d_start,
+	    c_len, d_len, &framed);
+	if (framed && curlevel >= ZIO_ZSTD_LEVEL_MIN &&
+	    curlevel <= ZIO_ZSTD_LEVEL_MAX)
+		curlevel |= ZIO_ZSTD_LEVEL_FRAMES;
+	if (done) {
+		if (level)
+			*level = curlevel;
+		return (0);
+	}
+
 	dctx = ZSTD_createDCtx_advanced(zstd_dctx_malloc);
 	if (!dctx) {
 		ZSTDSTAT_BUMP(zstd_stat_dec_alloc_fail);
@@ -876,6 +1257,9 @@ zstd_init(void)
 	pool_count = (boot_ncpus * 4);
 	zstd_meminit();
 
+	zstd_taskq = taskq_create("z_zstd", boot_ncpus, defclsyspri,
+	    boot_ncpus, INT_MAX, TASKQ_PREPOPULATE | TASKQ_DYNAMIC);
+
 	/* Initialize kstat */
 	zstd_ksp = kstat_create("zfs", 0, "zstd", "misc",
 	    KSTAT_TYPE_NAMED, sizeof (zstd_stats) / sizeof (kstat_named_t),
@@ -900,6 +1284,9 @@ zstd_fini(void)
 		zstd_ksp = NULL;
 	}
 
+	taskq_destroy(zstd_taskq);
+	zstd_taskq = NULL;
+
 	/* Release fallback memory */
 	vmem_free(zstd_dctx_fallback.mem, zstd_dctx_fallback.mem_size);
 	mutex_destroy(&zstd_dctx_fallback.barrier);
@@ -908,8 +1295,7 @@ zstd_fini(void)
 	zstd_mempool_deinit();
 }
 
-#if defined(_KERNEL)
-#ifdef __FreeBSD__
+#if defined(_KERNEL) && defined(__FreeBSD__)
 module_init(zstd_init);
 module_exit(zstd_fini);
 #endif
@@ -918,4 +1304,5 @@ ZFS_MODULE_PARAM(zfs, zstd_, earlyabort_pass, UINT, ZMOD_RW,
 	"Enable early abort attempts when using zstd");
 ZFS_MODULE_PARAM(zfs, zstd_, abort_size, UINT, ZMOD_RW,
 	"Minimal size of block to attempt early abort");
-#endif
+ZFS_MODULE_PARAM(zfs, zstd_, parallel, UINT, ZMOD_RW,
+	"Compress and decompress the frames of large blocks in parallel");
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: CDDL-1.0
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Issue a single ZFS_IOC_PREFETCH for a list of ranges.  The ioctl is sent
+ * to the given file, and each range is given as object:offset:length,
+ * where object 0 is that file itself.  Without ranges, the whole file is
+ * prefetched.
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/fs/zfs.h>
+
+int
+main(int argc, char *argv[])
+{
+	if (argc < 2)
+		errx(EXIT_FAILURE,
+		    "usage: %s file [object:offset:length] ...", argv[0]);
+
+	int fd = open(argv[1], O_RDONLY);
+	if (fd == -1)
+		err(EXIT_FAILURE, "failed to open %s", argv[1]);
+
+	int count = argc > 2 ? argc - 2 : 1;
+	zfs_prefetch_range_t *ranges = calloc(count, sizeof (*ranges));
+	if (ranges == NULL)
+		err(EXIT_FAILURE, "calloc");
+
+	for (int i = 2; i < argc; i++) {
+		zfs_prefetch_range_t *r = &ranges[i - 2];
+		if (sscanf(argv[i], "%" SCNu64 ":%" SCNu64 ":%" SCNu64,
+		    &r->object, &r->off, &r->len) != 3)
+			errx(EXIT_FAILURE, "invalid range: %s", argv[i]);
+	}
+
+	zfs_prefetch_args_t args = {
+		.ranges = (uint64_t)(uintptr_t)ranges,
+		.count = count,
+	};
+	if (ioctl(fd, ZFS_IOC_PREFETCH, &args) == -1)
+		err(EXIT_FAILURE, "ZFS_IOC_PREFETCH");
+
+	free(ranges);
+	(void) close(fd);
+
+	return (EXIT_SUCCESS);
+}
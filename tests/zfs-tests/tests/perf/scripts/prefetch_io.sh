@@ -25,6 +25,10 @@ getstat() {
 	awk -v c="$1" '$1 == c {print $3; exit}' /proc/spl/kstat/zfs/arcstats
 }
 
+getzfstat() {
+	awk -v c="$1" '$1 == c {print $3; exit}' /proc/spl/kstat/zfs/zfetchstats
+}
+
 get_prefetch_ios() {
 	echo $(( $(getstat prefetch_data_misses) + $(getstat prefetch_metadata_misses) ))
 }
@@ -39,6 +43,8 @@ interval=$2
 prefetch_ios=$(get_prefetch_ios)
 prefetched_demand_reads=$(getstat demand_hit_predictive_prefetch)
 async_upgrade_sync=$(getstat async_upgrade_sync)
+stride_hits=$(getzfstat stride_hits)
+reverse_hits=$(getzfstat reverse_hits)
 
 while true
 do
@@ -57,5 +63,15 @@ do
 	    $(( new_async_upgrade_sync - async_upgrade_sync ))
 	async_upgrade_sync=$new_async_upgrade_sync
 
+	new_stride_hits=$(getzfstat stride_hits)
+	printf '%-24s\t%u\n' "stride_hits" \
+	    $(( new_stride_hits - stride_hits ))
+	stride_hits=$new_stride_hits
+
+	new_reverse_hits=$(getzfstat reverse_hits)
+	printf '%-24s\t%u\n' "reverse_hits" \
+	    $(( new_reverse_hits - reverse_hits ))
+	reverse_hits=$new_reverse_hits
+
 	sleep "$interval"
 done